@@ -793,6 +793,10 @@ typedef struct {
 			       * for state file) */
 	List job_list; /* list of job pointers to submitted/running
 			  jobs (DON'T PACK) */
+	void *limits_index; /* index of acct_limit_list and
+			     * user_limit_list (DON'T PACK) */
+	void (*limits_index_free) (void *); /* frees limits_index
+					     * (DON'T PACK) */
 	uint32_t grp_used_jobs;	/* count of active jobs (DON'T PACK
 				 * for state file) */
 	uint32_t grp_used_submit_jobs; /* count of jobs pending or running
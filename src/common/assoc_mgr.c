@@ -44,6 +44,7 @@
 #include <stdlib.h>
 #include <ctype.h>
 
+#include "src/common/lock_stats.h"
 #include "src/common/uid.h"
 #include "src/common/xstring.h"
 #include "src/common/slurm_priority.h"
@@ -78,6 +79,14 @@ static int *assoc_mgr_tres_old_pos = NULL;
 static pthread_mutex_t locks_mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t locks_cond = PTHREAD_COND_INITIALIZER;
 
+/*
+ * Wait and hold time by data type, lock level (read or write) and caller,
+ * protected by locks_mutex
+ */
+static lock_stats_t lock_stats[ASSOC_MGR_ENTITY_COUNT][2][LOCK_CALLER_CNT];
+/* When this thread was granted each lock, to find how long it was held */
+static __thread uint64_t thread_lock_time[ASSOC_MGR_ENTITY_COUNT];
+
 static int _get_str_inx(char *name)
 {
 	int j, index = 0;
@@ -1883,8 +1892,37 @@ static int _refresh_assoc_wckey_list(void *db_conn, int enforce)
 	return SLURM_SUCCESS;
 }
 
-/* _wr_rdlock - Issue a read lock on the specified data type */
-static void _wr_rdlock(assoc_mgr_lock_datatype_t datatype)
+/*
+ * Record the wait for a lock just granted and note when it was granted.
+ * Called with locks_mutex held.
+ */
+static void _add_wait(assoc_mgr_lock_datatype_t datatype, lock_level_t level,
+		      uint64_t *now)
+{
+	uint64_t start = *now;
+
+	*now = lock_stats_now();
+	lock_stats_add_wait(&lock_stats[datatype][level - READ_LOCK]
+					[lock_stats_get_caller()],
+			    *now - start);
+	thread_lock_time[datatype] = *now;
+}
+
+/* Record how long a lock was held. Called with locks_mutex held. */
+static void _add_hold(assoc_mgr_lock_datatype_t datatype, lock_level_t level,
+		      uint64_t now)
+{
+	uint64_t start = thread_lock_time[datatype];
+
+	lock_stats_add_hold(&lock_stats[datatype][level - READ_LOCK]
+					[lock_stats_get_caller()],
+			    (now > start) ? (now - start) : 0);
+}
+
+/* _wr_rdlock - Issue a read lock on the specified data type
+ *	IN/OUT now - time the wait started, set to the time the lock was granted
+ */
+static void _wr_rdlock(assoc_mgr_lock_datatype_t datatype, uint64_t *now)
 {
 	//info("going to read lock on %d", datatype);
 	slurm_mutex_lock(&locks_mutex);
@@ -1895,6 +1933,7 @@ static void _wr_rdlock(assoc_mgr_lock_datatype_t datatype)
 		    && (assoc_mgr_locks.entity[write_lock(datatype)] ==
 			0)) {
 			assoc_mgr_locks.entity[read_lock(datatype)]++;
+			_add_wait(datatype, READ_LOCK, now);
 			break;
 		} else {	/* wait for state change and retry */
 			slurm_cond_wait(&locks_cond, &locks_mutex);
@@ -1904,18 +1943,21 @@ static void _wr_rdlock(assoc_mgr_lock_datatype_t datatype)
 }
 
 /* _wr_rdunlock - Issue a read unlock on the specified data type */
-static void _wr_rdunlock(assoc_mgr_lock_datatype_t datatype)
+static void _wr_rdunlock(assoc_mgr_lock_datatype_t datatype, uint64_t now)
 {
 	//info("going to read unlock on %d", datatype);
 	slurm_mutex_lock(&locks_mutex);
+	_add_hold(datatype, READ_LOCK, now);
 	//info("read unlock on %d", datatype);
 	assoc_mgr_locks.entity[read_lock(datatype)]--;
 	slurm_cond_broadcast(&locks_cond);
 	slurm_mutex_unlock(&locks_mutex);
 }
 
-/* _wr_wrlock - Issue a write lock on the specified data type */
-static void _wr_wrlock(assoc_mgr_lock_datatype_t datatype)
+/* _wr_wrlock - Issue a write lock on the specified data type
+ *	IN/OUT now - time the wait started, set to the time the lock was granted
+ */
+static void _wr_wrlock(assoc_mgr_lock_datatype_t datatype, uint64_t *now)
 {
 	//info("going to write lock on %d", datatype);
 	slurm_mutex_lock(&locks_mutex);
@@ -1928,6 +1970,7 @@ static void _wr_wrlock(assoc_mgr_lock_datatype_t datatype)
 			assoc_mgr_locks.entity[write_lock(datatype)]++;
 			assoc_mgr_locks.
 				entity[write_wait_lock(datatype)]--;
+			_add_wait(datatype, WRITE_LOCK, now);
 			break;
 		} else {	/* wait for state change and retry */
 			slurm_cond_wait(&locks_cond, &locks_mutex);
@@ -1937,10 +1980,11 @@ static void _wr_wrlock(assoc_mgr_lock_datatype_t datatype)
 }
 
 /* _wr_wrunlock - Issue a write unlock on the specified data type */
-static void _wr_wrunlock(assoc_mgr_lock_datatype_t datatype)
+static void _wr_wrunlock(assoc_mgr_lock_datatype_t datatype, uint64_t now)
 {
 	//info("going to write unlock on %d", datatype);
 	slurm_mutex_lock(&locks_mutex);
+	_add_hold(datatype, WRITE_LOCK, now);
 	//info("write unlock on %d", datatype);
 	assoc_mgr_locks.entity[write_lock(datatype)]--;
 	slurm_cond_broadcast(&locks_cond);
@@ -2095,78 +2139,96 @@ extern int assoc_mgr_fini(bool save_state)
 
 extern void assoc_mgr_lock(assoc_mgr_lock_t *locks)
 {
+	uint64_t now = lock_stats_now();
+
 	if (locks->assoc == READ_LOCK)
-		_wr_rdlock(ASSOC_LOCK);
+		_wr_rdlock(ASSOC_LOCK, &now);
 	else if (locks->assoc == WRITE_LOCK)
-		_wr_wrlock(ASSOC_LOCK);
+		_wr_wrlock(ASSOC_LOCK, &now);
 
 	if (locks->file == READ_LOCK)
-		_wr_rdlock(FILE_LOCK);
+		_wr_rdlock(FILE_LOCK, &now);
 	else if (locks->file == WRITE_LOCK)
-		_wr_wrlock(FILE_LOCK);
+		_wr_wrlock(FILE_LOCK, &now);
 
 	if (locks->qos == READ_LOCK)
-		_wr_rdlock(QOS_LOCK);
+		_wr_rdlock(QOS_LOCK, &now);
 	else if (locks->qos == WRITE_LOCK)
-		_wr_wrlock(QOS_LOCK);
+		_wr_wrlock(QOS_LOCK, &now);
 
 	if (locks->res == READ_LOCK)
-		_wr_rdlock(RES_LOCK);
+		_wr_rdlock(RES_LOCK, &now);
 	else if (locks->res == WRITE_LOCK)
-		_wr_wrlock(RES_LOCK);
+		_wr_wrlock(RES_LOCK, &now);
 
 	if (locks->tres == READ_LOCK)
-		_wr_rdlock(TRES_LOCK);
+		_wr_rdlock(TRES_LOCK, &now);
 	else if (locks->tres == WRITE_LOCK)
-		_wr_wrlock(TRES_LOCK);
+		_wr_wrlock(TRES_LOCK, &now);
 
 	if (locks->user == READ_LOCK)
-		_wr_rdlock(USER_LOCK);
+		_wr_rdlock(USER_LOCK, &now);
 	else if (locks->user == WRITE_LOCK)
-		_wr_wrlock(USER_LOCK);
+		_wr_wrlock(USER_LOCK, &now);
 
 	if (locks->wckey == READ_LOCK)
-		_wr_rdlock(WCKEY_LOCK);
+		_wr_rdlock(WCKEY_LOCK, &now);
 	else if (locks->wckey == WRITE_LOCK)
-		_wr_wrlock(WCKEY_LOCK);
+		_wr_wrlock(WCKEY_LOCK, &now);
 }
 
 extern void assoc_mgr_unlock(assoc_mgr_lock_t *locks)
 {
+	uint64_t now = lock_stats_now();
+
 	if (locks->wckey == READ_LOCK)
-		_wr_rdunlock(WCKEY_LOCK);
+		_wr_rdunlock(WCKEY_LOCK, now);
 	else if (locks->wckey == WRITE_LOCK)
-		_wr_wrunlock(WCKEY_LOCK);
+		_wr_wrunlock(WCKEY_LOCK, now);
 
 	if (locks->user == READ_LOCK)
-		_wr_rdunlock(USER_LOCK);
+		_wr_rdunlock(USER_LOCK, now);
 	else if (locks->user == WRITE_LOCK)
-		_wr_wrunlock(USER_LOCK);
+		_wr_wrunlock(USER_LOCK, now);
 
 	if (locks->tres == READ_LOCK)
-		_wr_rdunlock(TRES_LOCK);
+		_wr_rdunlock(TRES_LOCK, now);
 	else if (locks->tres == WRITE_LOCK)
-		_wr_wrunlock(TRES_LOCK);
+		_wr_wrunlock(TRES_LOCK, now);
 
 	if (locks->res == READ_LOCK)
-		_wr_rdunlock(RES_LOCK);
+		_wr_rdunlock(RES_LOCK, now);
 	else if (locks->res == WRITE_LOCK)
-		_wr_wrunlock(RES_LOCK);
+		_wr_wrunlock(RES_LOCK, now);
 
 	if (locks->qos == READ_LOCK)
-		_wr_rdunlock(QOS_LOCK);
+		_wr_rdunlock(QOS_LOCK, now);
 	else if (locks->qos == WRITE_LOCK)
-		_wr_wrunlock(QOS_LOCK);
+		_wr_wrunlock(QOS_LOCK, now);
 
 	if (locks->file == READ_LOCK)
-		_wr_rdunlock(FILE_LOCK);
+		_wr_rdunlock(FILE_LOCK, now);
 	else if (locks->file == WRITE_LOCK)
-		_wr_wrunlock(FILE_LOCK);
+		_wr_wrunlock(FILE_LOCK, now);
 
 	if (locks->assoc == READ_LOCK)
-		_wr_rdunlock(ASSOC_LOCK);
+		_wr_rdunlock(ASSOC_LOCK, now);
 	else if (locks->assoc == WRITE_LOCK)
-		_wr_wrunlock(ASSOC_LOCK);
+		_wr_wrunlock(ASSOC_LOCK, now);
+}
+
+extern void assoc_mgr_get_lock_stats(lock_stats_t *stats)
+{
+	slurm_mutex_lock(&locks_mutex);
+	memcpy(stats, lock_stats, sizeof(lock_stats));
+	slurm_mutex_unlock(&locks_mutex);
+}
+
+extern void assoc_mgr_reset_lock_stats(void)
+{
+	slurm_mutex_lock(&locks_mutex);
+	memset(lock_stats, 0, sizeof(lock_stats));
+	slurm_mutex_unlock(&locks_mutex);
 }
 
 /* Since the returned assoc_list is full of pointers from the
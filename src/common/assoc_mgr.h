@@ -45,6 +45,7 @@
 #define _SLURM_ASSOC_MGR_H
 
 #include "src/common/list.h"
+#include "src/common/lock_stats.h"
 #include "src/common/slurm_accounting_storage.h"
 #include "src/common/slurmdbd_defs.h"
 #include "src/slurmctld/slurmctld.h"
@@ -134,6 +135,15 @@ extern int assoc_mgr_fini(bool save_state);
 extern void assoc_mgr_lock(assoc_mgr_lock_t *locks);
 extern void assoc_mgr_unlock(assoc_mgr_lock_t *locks);
 
+/*
+ * Copy lock statistics into stats, an array of
+ * ASSOC_MGR_ENTITY_COUNT * 2 * LOCK_CALLER_CNT records ordered by data type,
+ * lock level (read then write) and caller
+ */
+extern void assoc_mgr_get_lock_stats(lock_stats_t *stats);
+/* Clear lock statistics */
+extern void assoc_mgr_reset_lock_stats(void);
+
 /*
  * get info from the storage
  * IN:  assoc - slurmdb_assoc_rec_t with at least cluster and
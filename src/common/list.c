@@ -108,6 +108,15 @@ strong_alias(list_install_fork_handlers, slurm_list_install_fork_handlers);
 #endif
 #define LIST_MAGIC 0xDEADBEEF
 
+/*
+ * Each thread keeps its own cache of free objects of each type, so most
+ * allocations and frees take no lock. Objects move between a thread's cache
+ * and the shared freelist LIST_CACHE_BATCH at a time, and a thread never
+ * caches more than twice that many of each type. A thread's cache is returned
+ * to the shared freelist when the thread exits.
+ */
+#define LIST_CACHE_BATCH 32
+
 
 /****************
  *  Data Types  *
@@ -142,6 +151,20 @@ struct xlist {
 
 typedef struct listNode * ListNode;
 
+/* Types of object kept on freelists */
+typedef enum {
+	LIST_OBJ_LIST,
+	LIST_OBJ_NODE,
+	LIST_OBJ_ITERATOR,
+	LIST_OBJ_TYPES
+} list_obj_t;
+
+/* A thread's free objects of each type, each a chain linked by first word */
+typedef struct {
+	void *head[LIST_OBJ_TYPES];
+	int count[LIST_OBJ_TYPES];
+} list_cache_t;
+
 
 /****************
  *  Prototypes  *
@@ -155,8 +178,8 @@ static ListNode list_node_alloc (void);
 static void list_node_free (ListNode p);
 static ListIterator list_iterator_alloc (void);
 static void list_iterator_free (ListIterator i);
-static void * list_alloc_aux (int size, void *pfreelist);
-static void list_free_aux (void *x, void *pfreelist);
+static void * list_alloc_aux (list_obj_t type);
+static void list_free_aux (void *x, list_obj_t type);
 static void *_list_pop_locked(List l);
 static void *_list_append_locked(List l, void *x);
 
@@ -168,12 +191,23 @@ static int _list_mutex_is_locked (pthread_mutex_t *mutex);
  *  Variables  *
  ***************/
 
-static List list_free_lists = NULL;
-static ListNode list_free_nodes = NULL;
-static ListIterator list_free_iterators = NULL;
+static const int list_obj_size[LIST_OBJ_TYPES] = {
+	sizeof(struct xlist),
+	sizeof(struct listNode),
+	sizeof(struct listIterator)
+};
+
+/* Shared freelists, protected by list_free_lock */
+static void *list_free_objs[LIST_OBJ_TYPES];
 
 static pthread_mutex_t list_free_lock = PTHREAD_MUTEX_INITIALIZER;
 
+#ifndef MEMORY_LEAK_DEBUG
+static pthread_once_t list_cache_once = PTHREAD_ONCE_INIT;
+static pthread_key_t list_cache_key;
+static __thread list_cache_t *list_cache = NULL;
+#endif
+
 /***************
  *  Functions  *
  ***************/
@@ -861,7 +895,7 @@ list_node_destroy (List l, ListNode *pp)
 static List
 list_alloc (void)
 {
-	return(list_alloc_aux(sizeof(struct xlist), &list_free_lists));
+	return(list_alloc_aux(LIST_OBJ_LIST));
 }
 
 /* list_free()
@@ -869,7 +903,7 @@ list_alloc (void)
 static void
 list_free (List l)
 {
-	list_free_aux(l, &list_free_lists);
+	list_free_aux(l, LIST_OBJ_LIST);
 }
 
 /* list_node_alloc()
@@ -877,7 +911,7 @@ list_free (List l)
 static ListNode
 list_node_alloc (void)
 {
-	return(list_alloc_aux(sizeof(struct listNode), &list_free_nodes));
+	return(list_alloc_aux(LIST_OBJ_NODE));
 }
 
 /* list_node_free()
@@ -885,7 +919,7 @@ list_node_alloc (void)
 static void
 list_node_free (ListNode p)
 {
-	list_free_aux(p, &list_free_nodes);
+	list_free_aux(p, LIST_OBJ_NODE);
 }
 
 /* list_iterator_alloc()
@@ -893,7 +927,7 @@ list_node_free (ListNode p)
 static ListIterator
 list_iterator_alloc (void)
 {
-	return(list_alloc_aux(sizeof(struct listIterator), &list_free_iterators));
+	return(list_alloc_aux(LIST_OBJ_ITERATOR));
 }
 
 /* list_iterator_free()
@@ -901,40 +935,115 @@ list_iterator_alloc (void)
 static void
 list_iterator_free (ListIterator i)
 {
-	list_free_aux(i, &list_free_iterators);
+	list_free_aux(i, LIST_OBJ_ITERATOR);
+}
+
+#ifndef MEMORY_LEAK_DEBUG
+/* list_cache_flush()
+ */
+static void
+list_cache_flush (void *arg)
+{
+/*  Returns all objects in the exiting thread's cache [arg] to the shared
+ *  freelists.
+ */
+	list_cache_t *cache = arg;
+	void **px;
+	int type;
+
+	slurm_mutex_lock(&list_free_lock);
+	for (type = 0; type < LIST_OBJ_TYPES; type++) {
+		if (!(px = cache->head[type]))
+			continue;
+		while (*px)
+			px = *px;
+		*px = list_free_objs[type];
+		list_free_objs[type] = cache->head[type];
+	}
+	slurm_mutex_unlock(&list_free_lock);
+
+	xfree(cache);
+	list_cache = NULL;
+}
+
+/* list_cache_key_create()
+ */
+static void
+list_cache_key_create (void)
+{
+	if (pthread_key_create(&list_cache_key, list_cache_flush))
+		fatal("cannot create list cache key");
 }
 
+/* list_cache_get()
+ */
+static list_cache_t *
+list_cache_get (void)
+{
+/*  Returns the calling thread's cache, creating it on first use.
+ */
+	if (!list_cache) {
+		pthread_once(&list_cache_once, list_cache_key_create);
+		list_cache = xmalloc(sizeof(list_cache_t));
+		pthread_setspecific(list_cache_key, list_cache);
+	}
+	return list_cache;
+}
+#endif
+
 /* list_alloc_aux()
  */
 static void *
-list_alloc_aux (int size, void *pfreelist)
+list_alloc_aux (list_obj_t type)
 {
-/*  Allocates an object of [size] bytes from the freelist [*pfreelist].
- *  Memory is added to the freelist in chunks of size LIST_ALLOC.
+/*  Allocates an object of [type], from the calling thread's cache when
+ *  possible, otherwise moving a batch of objects from the shared freelist.
+ *  Memory is added to the shared freelist in chunks of size LIST_ALLOC.
  *  Returns a ptr to the object, or NULL if the memory request fails.
  */
+	int size = list_obj_size[type];
 	void **px;
-	void **pfree = pfreelist;
 	void **plast;
+#ifndef MEMORY_LEAK_DEBUG
+	list_cache_t *cache = list_cache_get();
+	int cnt;
+
+	if ((px = cache->head[type])) {
+		cache->head[type] = *px;
+		cache->count[type]--;
+		return px;
+	}
+#endif
 
 	assert(sizeof(char) == 1);
 	assert(size >= sizeof(void *));
-	assert(pfreelist != NULL);
 	assert(LIST_ALLOC > 0);
 	slurm_mutex_lock(&list_free_lock);
 
-	if (!*pfree) {
-		if ((*pfree = xmalloc(LIST_ALLOC * size))) {
-			px = *pfree;
-			plast = (void **) ((char *) *pfree + ((LIST_ALLOC - 1) * size));
+	if (!list_free_objs[type]) {
+		if ((list_free_objs[type] = xmalloc(LIST_ALLOC * size))) {
+			px = list_free_objs[type];
+			plast = (void **) ((char *) list_free_objs[type] +
+					   ((LIST_ALLOC - 1) * size));
 			while (px < plast)
 				*px = (char *) px + size, px = *px;
 			*plast = NULL;
 		}
 	}
-	if ((px = *pfree))
-		*pfree = *px;
-	else
+	if ((px = list_free_objs[type])) {
+		list_free_objs[type] = *px;
+#ifndef MEMORY_LEAK_DEBUG
+		/* Move up to a batch more into this thread's cache */
+		if ((plast = list_free_objs[type])) {
+			for (cnt = 1; (cnt < LIST_CACHE_BATCH) && *plast; cnt++)
+				plast = *plast;
+			cache->head[type] = list_free_objs[type];
+			cache->count[type] = cnt;
+			list_free_objs[type] = *plast;
+			*plast = NULL;
+		}
+#endif
+	} else
 		errno = ENOMEM;
 	slurm_mutex_unlock(&list_free_lock);
 
@@ -944,23 +1053,42 @@ list_alloc_aux (int size, void *pfreelist)
 /* list_free_aux()
  */
 static void
-list_free_aux (void *x, void *pfreelist)
+list_free_aux (void *x, list_obj_t type)
 {
-/*  Frees the object [x], returning it to the freelist [*pfreelist].
+/*  Frees the object [x] of [type], returning it to the calling thread's
+ *  cache. If the cache is full, a batch of objects is returned to the
+ *  shared freelist.
  */
 #ifdef MEMORY_LEAK_DEBUG
 	xfree(x);
 #else
+	list_cache_t *cache = list_cache_get();
 	void **px = x;
-	void **pfree = pfreelist;
+	void **plast;
+	int cnt;
 
 	assert(x != NULL);
-	assert(pfreelist != NULL);
-	slurm_mutex_lock(&list_free_lock);
 
-	*px = *pfree;
-	*pfree = px;
+	*px = cache->head[type];
+	cache->head[type] = px;
+	if (++cache->count[type] <= (2 * LIST_CACHE_BATCH))
+		return;
+
+	/* Return all but the most recently freed batch */
+	plast = cache->head[type];
+	for (cnt = 1; cnt < LIST_CACHE_BATCH; cnt++)
+		plast = *plast;
+	px = *plast;
+	*plast = NULL;
+	cache->count[type] = LIST_CACHE_BATCH;
 
+	plast = px;
+	while (*plast)
+		plast = *plast;
+
+	slurm_mutex_lock(&list_free_lock);
+	*plast = list_free_objs[type];
+	list_free_objs[type] = px;
 	slurm_mutex_unlock(&list_free_lock);
 #endif
 }
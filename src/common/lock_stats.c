@@ -0,0 +1,119 @@
+/*****************************************************************************\
+ *  lock_stats.c - lock wait and hold time statistics
+ *****************************************************************************
+ *  Copyright (C) 2018 SchedMD LLC.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include "config.h"
+
+#include <time.h>
+
+#include "src/common/lock_stats.h"
+
+/*
+ * Caller type and lock wait time of this thread. Lock statistics are always
+ * collected, so avoid a pthread key lookup on every lock.
+ */
+static __thread lock_caller_t thread_caller = LOCK_CALLER_OTHER;
+static __thread uint64_t thread_wait = 0;
+
+static const char *caller_str[LOCK_CALLER_CNT] = {
+	"other", "rpc", "backfill", "sched", "background"
+};
+
+static inline int _hist_inx(uint64_t usec)
+{
+	int inx = 0;
+
+	for (usec /= 10; usec && (inx < (LOCK_STATS_HIST_CNT - 1)); usec /= 10)
+		inx++;
+
+	return inx;
+}
+
+extern uint64_t lock_stats_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ((uint64_t) ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+}
+
+extern lock_caller_t lock_stats_set_caller(lock_caller_t caller)
+{
+	lock_caller_t old_caller = thread_caller;
+
+	thread_caller = caller;
+
+	return old_caller;
+}
+
+extern lock_caller_t lock_stats_get_caller(void)
+{
+	return thread_caller;
+}
+
+extern const char *lock_stats_caller_str(lock_caller_t caller)
+{
+	if (caller >= LOCK_CALLER_CNT)
+		return "unknown";
+	return caller_str[caller];
+}
+
+extern void lock_stats_add_wait(lock_stats_t *stats, uint64_t usec)
+{
+	stats->count++;
+	stats->wait_time += usec;
+	if (usec > stats->wait_max)
+		stats->wait_max = usec;
+	stats->wait_hist[_hist_inx(usec)]++;
+
+	thread_wait += usec;
+}
+
+extern void lock_stats_add_hold(lock_stats_t *stats, uint64_t usec)
+{
+	stats->hold_time += usec;
+	if (usec > stats->hold_max)
+		stats->hold_max = usec;
+	stats->hold_hist[_hist_inx(usec)]++;
+}
+
+extern uint64_t lock_stats_thread_wait(void)
+{
+	uint64_t usec = thread_wait;
+
+	thread_wait = 0;
+
+	return usec;
+}
@@ -0,0 +1,98 @@
+/*****************************************************************************\
+ *  lock_stats.h - lock wait and hold time statistics
+ *****************************************************************************
+ *  Copyright (C) 2018 SchedMD LLC.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _SLURM_LOCK_STATS_H
+#define _SLURM_LOCK_STATS_H
+
+#include <inttypes.h>
+
+/*
+ * Kinds of thread recorded separately in lock statistics. A thread is
+ * LOCK_CALLER_OTHER until it calls lock_stats_set_caller().
+ */
+typedef enum {
+	LOCK_CALLER_OTHER,
+	LOCK_CALLER_RPC,
+	LOCK_CALLER_BACKFILL,
+	LOCK_CALLER_SCHED,
+	LOCK_CALLER_BACKGROUND,
+	LOCK_CALLER_CNT
+} lock_caller_t;
+
+/*
+ * Histogram buckets, one per decade of microseconds:
+ * <10us, <100us, <1ms, <10ms, <100ms, <1s, >=1s
+ */
+#define LOCK_STATS_HIST_CNT	7
+
+/*
+ * Statistics for one lock, lock level and caller. Updates must be serialized
+ * by the caller, normally with the mutex protecting the lock itself.
+ */
+typedef struct {
+	uint64_t count;		/* locks granted */
+	uint64_t wait_time;	/* usec spent waiting for the lock */
+	uint64_t wait_max;
+	uint64_t hold_time;	/* usec the lock was held */
+	uint64_t hold_max;
+	uint32_t wait_hist[LOCK_STATS_HIST_CNT];
+	uint32_t hold_hist[LOCK_STATS_HIST_CNT];
+} lock_stats_t;
+
+/* Return a monotonic time in microseconds */
+extern uint64_t lock_stats_now(void);
+
+/* Set the calling thread's caller type, return the previous type */
+extern lock_caller_t lock_stats_set_caller(lock_caller_t caller);
+
+/* Return the calling thread's caller type */
+extern lock_caller_t lock_stats_get_caller(void);
+
+/* Return the name of a caller type */
+extern const char *lock_stats_caller_str(lock_caller_t caller);
+
+/*
+ * Record a lock granted after waiting "usec" microseconds. The time is also
+ * added to the calling thread's total, see lock_stats_thread_wait().
+ */
+extern void lock_stats_add_wait(lock_stats_t *stats, uint64_t usec);
+
+/* Record a lock released after being held "usec" microseconds */
+extern void lock_stats_add_hold(lock_stats_t *stats, uint64_t usec);
+
+/* Return the microseconds the calling thread waited for locks, then clear */
+extern uint64_t lock_stats_thread_wait(void);
+
+#endif
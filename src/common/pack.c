@@ -128,6 +128,31 @@ void free_buf(Buf my_buf)
 	xfree(my_buf);
 }
 
+/*
+ * Make room for at least size bytes beyond the buffer's offset. The buffer
+ * grows geometrically so that packing a large amount of data does not
+ * repeatedly reallocate and copy everything packed so far.
+ * RET false if the buffer would exceed MAX_BUF_SIZE
+ */
+static bool _grow_buf_min(Buf buffer, uint32_t size, const char *caller)
+{
+	uint64_t need = (uint64_t) buffer->processed + size;
+	uint64_t new_size;
+
+	if (need > MAX_BUF_SIZE) {
+		error("%s: Buffer size limit exceeded (%"PRIu64" > %u)",
+		      caller, need, MAX_BUF_SIZE);
+		return false;
+	}
+
+	new_size = (uint64_t) buffer->size + (buffer->size / 2);
+	new_size = MAX(new_size, need + BUF_SIZE);
+	buffer->size = MIN(new_size, MAX_BUF_SIZE);
+	xrealloc_nz(buffer->head, buffer->size);
+
+	return true;
+}
+
 /* Grow a buffer by the specified amount */
 void grow_buf (Buf buffer, uint32_t size)
 {
@@ -181,16 +206,9 @@ void pack_time(time_t val, Buf buffer)
 {
 	int64_t n64 = HTON_int64((int64_t) val);
 
-	if (remaining_buf(buffer) < sizeof(n64)) {
-		if ((buffer->size + BUF_SIZE) > MAX_BUF_SIZE) {
-			error("%s: Buffer size limit exceeded (%u > %u)",
-			      __func__, (buffer->size + BUF_SIZE),
-			      MAX_BUF_SIZE);
-			return;
-		}
-		buffer->size += BUF_SIZE;
-		xrealloc_nz(buffer->head, buffer->size);
-	}
+	if ((remaining_buf(buffer) < sizeof(n64)) &&
+	    !_grow_buf_min(buffer, sizeof(n64), __func__))
+		return;
 
 	memcpy(&buffer->head[buffer->processed], &n64, sizeof(n64));
 	buffer->processed += sizeof(n64);
@@ -230,16 +248,9 @@ void 	packdouble(double val, Buf buffer)
 	 */
 	uval.d =  (val * FLOAT_MULT);
 	nl =  HTON_uint64(uval.u);
-	if (remaining_buf(buffer) < sizeof(nl)) {
-		if ((buffer->size + BUF_SIZE) > MAX_BUF_SIZE) {
-			error("%s: Buffer size limit exceeded (%u > %u)",
-			      __func__, (buffer->size + BUF_SIZE),
-			      MAX_BUF_SIZE);
-			return;
-		}
-		buffer->size += BUF_SIZE;
-		xrealloc_nz(buffer->head, buffer->size);
-	}
+	if ((remaining_buf(buffer) < sizeof(nl)) &&
+	    !_grow_buf_min(buffer, sizeof(nl), __func__))
+		return;
 
 	memcpy(&buffer->head[buffer->processed], &nl, sizeof(nl));
 	buffer->processed += sizeof(nl);
@@ -311,16 +322,9 @@ void pack64(uint64_t val, Buf buffer)
 {
 	uint64_t nl =  HTON_uint64(val);
 
-	if (remaining_buf(buffer) < sizeof(nl)) {
-		if ((buffer->size + BUF_SIZE) > MAX_BUF_SIZE) {
-			error("%s: Buffer size limit exceeded (%u > %u)",
-			      __func__, (buffer->size + BUF_SIZE),
-			      MAX_BUF_SIZE);
-			return;
-		}
-		buffer->size += BUF_SIZE;
-		xrealloc_nz(buffer->head, buffer->size);
-	}
+	if ((remaining_buf(buffer) < sizeof(nl)) &&
+	    !_grow_buf_min(buffer, sizeof(nl), __func__))
+		return;
 
 	memcpy(&buffer->head[buffer->processed], &nl, sizeof(nl));
 	buffer->processed += sizeof(nl);
@@ -350,16 +354,9 @@ void pack32(uint32_t val, Buf buffer)
 {
 	uint32_t nl = htonl(val);
 
-	if (remaining_buf(buffer) < sizeof(nl)) {
-		if ((buffer->size + BUF_SIZE) > MAX_BUF_SIZE) {
-			error("%s: Buffer size limit exceeded (%u > %u)",
-			      __func__, (buffer->size + BUF_SIZE),
-			      MAX_BUF_SIZE);
-			return;
-		}
-		buffer->size += BUF_SIZE;
-		xrealloc_nz(buffer->head, buffer->size);
-	}
+	if ((remaining_buf(buffer) < sizeof(nl)) &&
+	    !_grow_buf_min(buffer, sizeof(nl), __func__))
+		return;
 
 	memcpy(&buffer->head[buffer->processed], &nl, sizeof(nl));
 	buffer->processed += sizeof(nl);
@@ -597,16 +594,9 @@ void pack16(uint16_t val, Buf buffer)
 {
 	uint16_t ns = htons(val);
 
-	if (remaining_buf(buffer) < sizeof(ns)) {
-		if ((buffer->size + BUF_SIZE) > MAX_BUF_SIZE) {
-			error("%s: Buffer size limit exceeded (%u > %u)",
-			      __func__, (buffer->size + BUF_SIZE),
-			      MAX_BUF_SIZE);
-			return;
-		}
-		buffer->size += BUF_SIZE;
-		xrealloc_nz(buffer->head, buffer->size);
-	}
+	if ((remaining_buf(buffer) < sizeof(ns)) &&
+	    !_grow_buf_min(buffer, sizeof(ns), __func__))
+		return;
 
 	memcpy(&buffer->head[buffer->processed], &ns, sizeof(ns));
 	buffer->processed += sizeof(ns);
@@ -635,16 +625,9 @@ int unpack16(uint16_t * valp, Buf buffer)
  */
 void pack8(uint8_t val, Buf buffer)
 {
-	if (remaining_buf(buffer) < sizeof(uint8_t)) {
-		if ((buffer->size + BUF_SIZE) > MAX_BUF_SIZE) {
-			error("%s: Buffer size limit exceeded (%u > %u)",
-			      __func__, (buffer->size + BUF_SIZE),
-			      MAX_BUF_SIZE);
-			return;
-		}
-		buffer->size += BUF_SIZE;
-		xrealloc_nz(buffer->head, buffer->size);
-	}
+	if ((remaining_buf(buffer) < sizeof(uint8_t)) &&
+	    !_grow_buf_min(buffer, sizeof(uint8_t), __func__))
+		return;
 
 	memcpy(&buffer->head[buffer->processed], &val, sizeof(uint8_t));
 	buffer->processed += sizeof(uint8_t);
@@ -678,16 +661,9 @@ void packmem(char *valp, uint32_t size_val, Buf buffer)
 		      __func__, size_val, MAX_PACK_MEM_LEN);
 		return;
 	}
-	if (remaining_buf(buffer) < (sizeof(ns) + size_val)) {
-		if ((buffer->size + size_val + BUF_SIZE) > MAX_BUF_SIZE) {
-			error("%s: Buffer size limit exceeded (%u > %u)",
-			      __func__, (buffer->size + size_val + BUF_SIZE),
-			      MAX_BUF_SIZE);
-			return;
-		}
-		buffer->size += (size_val + BUF_SIZE);
-		xrealloc_nz(buffer->head, buffer->size);
-	}
+	if ((remaining_buf(buffer) < (sizeof(ns) + size_val)) &&
+	    !_grow_buf_min(buffer, (sizeof(ns) + size_val), __func__))
+		return;
 
 	memcpy(&buffer->head[buffer->processed], &ns, sizeof(ns));
 	buffer->processed += sizeof(ns);
@@ -855,16 +831,9 @@ void packstr_array(char **valp, uint32_t size_val, Buf buffer)
 	int i;
 	uint32_t ns = htonl(size_val);
 
-	if (remaining_buf(buffer) < sizeof(ns)) {
-		if ((buffer->size + BUF_SIZE) > MAX_BUF_SIZE) {
-			error("%s: Buffer size limit exceeded (%u > %u)",
-			      __func__, (buffer->size + BUF_SIZE),
-			      MAX_BUF_SIZE);
-			return;
-		}
-		buffer->size += BUF_SIZE;
-		xrealloc_nz(buffer->head, buffer->size);
-	}
+	if ((remaining_buf(buffer) < sizeof(ns)) &&
+	    !_grow_buf_min(buffer, sizeof(ns), __func__))
+		return;
 
 	memcpy(&buffer->head[buffer->processed], &ns, sizeof(ns));
 	buffer->processed += sizeof(ns);
@@ -922,16 +891,9 @@ int unpackstr_array(char ***valp, uint32_t * size_valp, Buf buffer)
  */
 void packmem_array(char *valp, uint32_t size_val, Buf buffer)
 {
-	if (remaining_buf(buffer) < size_val) {
-		if ((buffer->size + size_val + BUF_SIZE) > MAX_BUF_SIZE) {
-			error("%s: Buffer size limit exceeded (%u > %u)",
-			      __func__, (buffer->size + size_val + BUF_SIZE),
-			      MAX_BUF_SIZE);
-			return;
-		}
-		buffer->size += (size_val + BUF_SIZE);
-		xrealloc_nz(buffer->head, buffer->size);
-	}
+	if ((remaining_buf(buffer) < size_val) &&
+	    !_grow_buf_min(buffer, size_val, __func__))
+		return;
 
 	memcpy(&buffer->head[buffer->processed], valp, size_val);
 	buffer->processed += size_val;
@@ -53,6 +53,7 @@
 #include "src/common/group_cache.h"
 #include "src/common/job_resources.h"
 #include "src/common/list.h"
+#include "src/common/lock_stats.h"
 #include "src/common/log.h"
 #include "src/common/macros.h"
 #include "src/common/plugin.h"
@@ -60,7 +61,9 @@
 #include "src/common/slurm_cred.h"
 #include "src/common/slurm_protocol_api.h"
 #include "src/common/slurm_time.h"
+#include "src/common/vector.h"
 #include "src/common/xassert.h"
+#include "src/common/xhash.h"
 #include "src/common/xmalloc.h"
 #include "src/common/xstring.h"
 
@@ -84,6 +87,18 @@ typedef struct sbcast_cred sbcast_cred_t;		/* opaque data type */
 #define EXTREME_DEBUG   0
 #define MAX_TIME 0x7fffffff
 
+/* Lengths of the "jobid.stepid.ctime" and "jobid" hash keys */
+#define CRED_KEY_LEN	48
+#define JOB_KEY_LEN	12
+
+/*
+ * Expiration timer wheel slot count and seconds covered by each slot.
+ * One turn should exceed the usual expiration window so that most entries
+ * are only looked at once.
+ */
+#define CRED_WHEEL_SLOTS 512
+#define CRED_WHEEL_TICK  4
+
 /*
  * slurm job credential state
  *
@@ -93,6 +108,7 @@ typedef struct {
 	time_t   expiration;    /* Time at which cred is no longer good	*/
 	uint32_t jobid;		/* SLURM job id for this credential	*/
 	uint32_t stepid;	/* SLURM step id for this credential	*/
+	char     key[CRED_KEY_LEN]; /* state_hash key			*/
 } cred_state_t;
 
 /*
@@ -105,8 +121,27 @@ typedef struct {
 	time_t   expiration;    /* Time at which credentials can be purged  */
 	uint32_t jobid;         /* SLURM job id for this credential	*/
 	time_t   revoked;       /* Time at which credentials were revoked   */
+	char     key[JOB_KEY_LEN]; /* job_hash key				*/
 } job_state_t;
 
+/*
+ * Expiration timer wheel. Entries are filed in the slot of the tick in which
+ * they expire, so a sweep only visits the slots of the ticks that ended
+ * since the previous sweep instead of every state. Entries hold a copy of the
+ * state's key, states removed by other means are skipped when they come due.
+ */
+typedef struct {
+	time_t   expiration;
+	uint32_t jobid;
+	uint32_t stepid;
+	time_t   ctime;
+} cred_wheel_entry_t;
+
+typedef struct {
+	vector_t *slot[CRED_WHEEL_SLOTS];
+	time_t   next_tick;	/* First tick not swept yet		*/
+} cred_wheel_t;
+
 
 /*
  * Completion of slurm credential context
@@ -147,13 +182,17 @@ struct slurm_cred_context {
 	pthread_mutex_t mutex;
 	enum ctx_type type;	/* context type (creator or verifier)	*/
 	void *key;		/* private or public key		*/
-	List job_list;		/* List of used jobids (for verifier)	*/
-	List state_list;	/* List of cred states (for verifier)	*/
+	xhash_t *job_hash;	/* Used jobids (for verifier)		*/
+	xhash_t *state_hash;	/* Cred states (for verifier)		*/
+	cred_wheel_t job_wheel;	/* Revoked job state expirations	*/
+	cred_wheel_t state_wheel; /* Cred state expirations		*/
 
 	int expiry_window;	/* expiration window for cached creds	*/
 
 	void *exkey;		/* Old public key if key is updated	*/
 	time_t exkey_exp;	/* Old key expiration time		*/
+
+	slurm_cred_sign_stats_t sign_stats; /* for creator		*/
 };
 
 
@@ -198,6 +237,7 @@ struct slurm_job_credential {
 	time_t    ctime;	/* time of credential creation		*/
 	char     *step_hostlist;/* hostnames for which the cred is ok	*/
 	uint16_t  x11;		/* x11 flags set on job allocation	*/
+	uint16_t  sign_protocol_version; /* to sign unsigned cred with	*/
 
 	char     *signature; 	/* credential signature			*/
 	unsigned int siglen;	/* signature length in bytes		*/
@@ -267,12 +307,19 @@ static void           _job_state_destroy(job_state_t   *js);
 
 static job_state_t  * _find_job_state(slurm_cred_ctx_t ctx, uint32_t jobid);
 static job_state_t  * _insert_job_state(slurm_cred_ctx_t ctx,  uint32_t jobid);
-static int            _find_cred_state(cred_state_t *c, slurm_cred_t *cred);
+static void _queue_job_state_expiration(slurm_cred_ctx_t ctx, job_state_t *j);
 
 static void _insert_cred_state(slurm_cred_ctx_t ctx, slurm_cred_t *cred);
+static void _cred_state_key(char *key, uint32_t jobid, uint32_t stepid,
+			    time_t ctime);
+static const char *_cred_state_id(void *x);
+static void _job_state_key(char *key, uint32_t jobid);
+static const char *_job_state_id(void *x);
 static void _clear_expired_job_states(slurm_cred_ctx_t ctx);
 static void _clear_expired_credential_states(slurm_cred_ctx_t ctx);
 static void _verifier_ctx_init(slurm_cred_ctx_t ctx);
+static void _wheel_init(cred_wheel_t *wheel);
+static void _wheel_destroy(cred_wheel_t *wheel);
 
 static bool _credential_replayed(slurm_cred_ctx_t ctx, slurm_cred_t *cred);
 static bool _credential_revoked(slurm_cred_ctx_t ctx, slurm_cred_t *cred);
@@ -452,8 +499,10 @@ slurm_cred_ctx_destroy(slurm_cred_ctx_t ctx)
 		(*(ops.crypto_destroy_key))(ctx->exkey);
 	if (ctx->key)
 		(*(ops.crypto_destroy_key))(ctx->key);
-	FREE_NULL_LIST(ctx->job_list);
-	FREE_NULL_LIST(ctx->state_list);
+	xhash_free(ctx->job_hash);
+	xhash_free(ctx->state_hash);
+	_wheel_destroy(&ctx->job_wheel);
+	_wheel_destroy(&ctx->state_wheel);
 
 	xassert((ctx->magic = ~CRED_CTX_MAGIC));
 
@@ -539,10 +588,36 @@ slurm_cred_ctx_key_update(slurm_cred_ctx_t ctx, const char *path)
 		return _ctx_update_public_key(ctx, path);
 }
 
+void
+slurm_cred_get_sign_stats(slurm_cred_ctx_t ctx, slurm_cred_sign_stats_t *stats)
+{
+	if (!ctx) {
+		memset(stats, 0, sizeof(*stats));
+		return;
+	}
+
+	slurm_mutex_lock(&ctx->mutex);
+	xassert(ctx->magic == CRED_CTX_MAGIC);
+	*stats = ctx->sign_stats;
+	slurm_mutex_unlock(&ctx->mutex);
+}
+
+void
+slurm_cred_reset_sign_stats(slurm_cred_ctx_t ctx)
+{
+	if (!ctx)
+		return;
+
+	slurm_mutex_lock(&ctx->mutex);
+	xassert(ctx->magic == CRED_CTX_MAGIC);
+	memset(&ctx->sign_stats, 0, sizeof(ctx->sign_stats));
+	slurm_mutex_unlock(&ctx->mutex);
+}
+
 
 slurm_cred_t *
-slurm_cred_create(slurm_cred_ctx_t ctx, slurm_cred_arg_t *arg,
-		  uint16_t protocol_version)
+slurm_cred_create_unsigned(slurm_cred_ctx_t ctx, slurm_cred_arg_t *arg,
+			   uint16_t protocol_version)
 {
 	slurm_cred_t *cred = NULL;
 
@@ -607,23 +682,89 @@ slurm_cred_create(slurm_cred_ctx_t ctx, slurm_cred_arg_t *arg,
 	}
 #endif
 	cred->ctime  = time(NULL);
+	cred->sign_protocol_version = protocol_version;
+
+	slurm_mutex_unlock(&cred->mutex);
+
+	return cred;
+}
+
+slurm_cred_t *
+slurm_cred_create(slurm_cred_ctx_t ctx, slurm_cred_arg_t *arg,
+		  uint16_t protocol_version)
+{
+	slurm_cred_t *cred;
+
+	if (!(cred = slurm_cred_create_unsigned(ctx, arg, protocol_version)))
+		return NULL;
+
+	if (slurm_cred_sign_batch(ctx, &cred, 1) != SLURM_SUCCESS) {
+		slurm_cred_destroy(cred);
+		return NULL;
+	}
+
+	return cred;
+}
+
+int
+slurm_cred_sign_batch(slurm_cred_ctx_t ctx, slurm_cred_t **creds, int cnt)
+{
+	slurm_cred_sign_stats_t *stats;
+	slurm_cred_t *cred;
+	uint64_t start, usec;
+	int i, rc = SLURM_SUCCESS;
+
+	xassert(ctx != NULL);
+	if (_slurm_crypto_init() < 0)
+		return SLURM_ERROR;
 
 	slurm_mutex_lock(&ctx->mutex);
 	xassert(ctx->magic == CRED_CTX_MAGIC);
 	xassert(ctx->type == SLURM_CRED_CREATOR);
-	if (_slurm_cred_sign(ctx, cred, protocol_version) < 0)
-		goto fail;
+
+	stats = &ctx->sign_stats;
+	stats->batch_cnt++;
+	for (i = 0; i < cnt; i++) {
+		if (!(cred = creds[i]))
+			continue;
+		slurm_mutex_lock(&cred->mutex);
+		xassert(cred->magic == CRED_MAGIC);
+		if (!cred->signature) {
+			/* Start the expiry window when the cred is signed */
+			cred->ctime = time(NULL);
+			start = lock_stats_now();
+			if (_slurm_cred_sign(ctx, cred,
+					     cred->sign_protocol_version) < 0) {
+				stats->fail_cnt++;
+				rc = SLURM_ERROR;
+			} else {
+				usec = lock_stats_now() - start;
+				stats->sign_cnt++;
+				stats->sign_time += usec;
+				if (usec > stats->sign_max)
+					stats->sign_max = usec;
+			}
+		}
+		slurm_mutex_unlock(&cred->mutex);
+	}
 
 	slurm_mutex_unlock(&ctx->mutex);
-	slurm_mutex_unlock(&cred->mutex);
 
-	return cred;
+	return rc;
+}
 
-fail:
-	slurm_mutex_unlock(&ctx->mutex);
+bool
+slurm_cred_signed(slurm_cred_t *cred)
+{
+	bool rc;
+
+	xassert(cred != NULL);
+
+	slurm_mutex_lock(&cred->mutex);
+	rc = (cred->signature != NULL);
 	slurm_mutex_unlock(&cred->mutex);
-	slurm_cred_destroy(cred);
-	return NULL;
+
+	return rc;
 }
 
 slurm_cred_t *
@@ -674,6 +815,7 @@ slurm_cred_copy(slurm_cred_t *cred)
 	rcred->job_hostlist    = xstrdup(cred->job_hostlist);
 #endif
 	rcred->ctime  = cred->ctime;
+	rcred->sign_protocol_version = cred->sign_protocol_version;
 	rcred->siglen = cred->siglen;
 	/* Assumes signature is a string,
 	 * otherwise use xmalloc and strcpy here */
@@ -1013,6 +1155,7 @@ slurm_cred_insert_jobid(slurm_cred_ctx_t ctx, uint32_t jobid)
 int
 slurm_cred_rewind(slurm_cred_ctx_t ctx, slurm_cred_t *cred)
 {
+	char key[CRED_KEY_LEN];
 	int rc = 0;
 
 	xassert(ctx != NULL);
@@ -1022,8 +1165,11 @@ slurm_cred_rewind(slurm_cred_ctx_t ctx, slurm_cred_t *cred)
 	xassert(ctx->magic == CRED_CTX_MAGIC);
 	xassert(ctx->type  == SLURM_CRED_VERIFIER);
 
-	rc = list_delete_all(ctx->state_list,
-			     (ListFindF) _find_cred_state, cred);
+	_cred_state_key(key, cred->jobid, cred->stepid, cred->ctime);
+	if (xhash_get(ctx->state_hash, key)) {
+		xhash_delete(ctx->state_hash, key);
+		rc = 1;
+	}
 
 	slurm_mutex_unlock(&ctx->mutex);
 
@@ -1064,6 +1210,7 @@ slurm_cred_revoke(slurm_cred_ctx_t ctx, uint32_t jobid, time_t time,
 	}
 
 	j->revoked = time;
+	_queue_job_state_expiration(ctx, j);
 
 	slurm_mutex_unlock(&ctx->mutex);
 	return SLURM_SUCCESS;
@@ -1098,6 +1245,7 @@ slurm_cred_begin_expiration(slurm_cred_ctx_t ctx, uint32_t jobid)
 	}
 
 	j->expiration  = time(NULL) + ctx->expiry_window;
+	_queue_job_state_expiration(ctx, j);
 #if DEBUG_TIME
 	{
 		char buf[64];
@@ -1499,7 +1647,7 @@ slurm_cred_ctx_unpack(slurm_cred_ctx_t ctx, Buf buffer)
 
 	/*
 	 * Unpack job state list and cred state list from buffer
-	 * appening them onto ctx->state_list and ctx->job_list.
+	 * adding them to ctx->state_hash and ctx->job_hash.
 	 */
 	_job_state_unpack(ctx, buffer);
 	_cred_state_unpack(ctx, buffer);
@@ -1572,8 +1720,14 @@ _verifier_ctx_init(slurm_cred_ctx_t ctx)
 	xassert(ctx->magic == CRED_CTX_MAGIC);
 	xassert(ctx->type == SLURM_CRED_VERIFIER);
 
-	ctx->job_list   = list_create((ListDelF) _job_state_destroy);
-	ctx->state_list = list_create((ListDelF) _cred_state_destroy);
+	ctx->job_hash   = xhash_init(_job_state_id,
+				 (xhash_freefunc_t) _job_state_destroy,
+				 NULL, 0);
+	ctx->state_hash = xhash_init(_cred_state_id,
+				 (xhash_freefunc_t) _cred_state_destroy,
+				 NULL, 0);
+	_wheel_init(&ctx->job_wheel);
+	_wheel_init(&ctx->state_wheel);
 
 	return;
 }
@@ -1855,26 +2009,16 @@ _pack_cred(slurm_cred_t *cred, Buf buffer, uint16_t protocol_version)
 	}
 }
 
-static int _list_find_cred_state(void *x, void *key)
-{
-	cred_state_t *s = (cred_state_t *) x;
-	slurm_cred_t *cred = (slurm_cred_t *) key;
-	if ((s->jobid  == cred->jobid)  &&
-	    (s->stepid == cred->stepid) &&
-	    (s->ctime  == cred->ctime))
-		return 1;
-	return 0;
-}
-
-
 static bool
 _credential_replayed(slurm_cred_ctx_t ctx, slurm_cred_t *cred)
 {
 	cred_state_t *s = NULL;
+	char key[CRED_KEY_LEN];
 
 	_clear_expired_credential_states(ctx);
 
-	s = list_find_first(ctx->state_list, _list_find_cred_state, cred);
+	_cred_state_key(key, cred->jobid, cred->stepid, cred->ctime);
+	s = xhash_get(ctx->state_hash, key);
 
 	/*
 	 * If we found a match, this credential is being replayed.
@@ -1911,11 +2055,7 @@ slurm_cred_handle_reissue(slurm_cred_ctx_t ctx, slurm_cred_t *cred)
 		 * credential to any ensuing commands. */
 		info("reissued job credential for job %u", j->jobid);
 
-		/* Setting j->expiration to zero will make
-		 * _clear_expired_job_states() remove this
-		 * job credential from the cred context. */
-		j->expiration = 0;
-		_clear_expired_job_states(ctx);
+		xhash_delete(ctx->job_hash, j->key);
 	}
 }
 
@@ -1960,38 +2100,34 @@ _credential_revoked(slurm_cred_ctx_t ctx, slurm_cred_t *cred)
 	return false;
 }
 
-static int _list_find_job_state(void *x, void *key)
+static void
+_job_state_key(char *key, uint32_t jobid)
 {
-	job_state_t *j = (job_state_t *) x;
-	uint32_t jobid = *(uint32_t *) key;
-	if (j->jobid == jobid)
-		return 1;
-	return 0;
+	snprintf(key, JOB_KEY_LEN, "%u", jobid);
 }
 
-static job_state_t *
-_find_job_state(slurm_cred_ctx_t ctx, uint32_t jobid)
+static const char *
+_job_state_id(void *x)
 {
-	job_state_t *j =
-		list_find_first(ctx->job_list, _list_find_job_state, &jobid);
-	return j;
+	return ((job_state_t *) x)->key;
 }
 
-static int
-_find_cred_state(cred_state_t *c, slurm_cred_t *cred)
+static job_state_t *
+_find_job_state(slurm_cred_ctx_t ctx, uint32_t jobid)
 {
-	return ((c->jobid == cred->jobid) && (c->stepid == cred->stepid) &&
-		(c->ctime == cred->ctime));
+	char key[JOB_KEY_LEN];
+
+	_job_state_key(key, jobid);
+	return xhash_get(ctx->job_hash, key);
 }
 
 static job_state_t *
 _insert_job_state(slurm_cred_ctx_t ctx, uint32_t jobid)
 {
-	job_state_t *j = list_find_first(
-		ctx->job_list, _list_find_job_state, &jobid);;
+	job_state_t *j = _find_job_state(ctx, jobid);
 	if (!j) {
 		j = _job_state_create(jobid);
-		list_append(ctx->job_list, j);
+		xhash_add(ctx->job_hash, j);
 	} else
 		debug2("%s: we already have a job state for job %u.  No big deal, just an FYI.",
 		       __func__, jobid);
@@ -2008,6 +2144,7 @@ _job_state_create(uint32_t jobid)
 	j->revoked    = (time_t) 0;
 	j->ctime      = time(NULL);
 	j->expiration = (time_t) MAX_TIME;
+	_job_state_key(j->key, jobid);
 
 	return j;
 }
@@ -2021,78 +2158,161 @@ _job_state_destroy(job_state_t *j)
 
 
 static void
-_clear_expired_job_states(slurm_cred_ctx_t ctx)
+_wheel_init(cred_wheel_t *wheel)
 {
-	static time_t last_scan = 0;
-	time_t        now = time(NULL);
-	ListIterator  i   = NULL;
-	job_state_t  *j   = NULL;
+	wheel->next_tick = time(NULL) / CRED_WHEEL_TICK;
+}
 
-	if ((now - last_scan) < 2)	/* Reduces slurmd overhead */
-		return;
-	last_scan = now;
+static void
+_wheel_destroy(cred_wheel_t *wheel)
+{
+	int i;
 
-	i = list_iterator_create(ctx->job_list);
-	while ((j = list_next(i))) {
-#if DEBUG_TIME
-		char t1[64], t2[64], t3[64];
-		if (j->revoked) {
-			strcpy(t2, " revoked:");
-			timestr(&j->revoked, (t2+9), (64-9));
-		} else {
-			t2[0] = '\0';
-		}
-		if (j->expiration) {
-			strcpy(t3, " expires:");
-			timestr(&j->expiration, (t3+9), (64-9));
-		} else {
-			t3[0] = '\0';
-		}
-		debug3("state for jobid %u: ctime:%s%s%s",
-		       j->jobid, timestr(&j->ctime, t1, 64), t2, t3);
-#else
-		debug3("state for jobid %u: ctime:%"PRIu64" revoked:%"PRIu64" "
-		       "expires:%"PRIu64"",
-		       j->jobid, (uint64_t)j->ctime, (uint64_t)j->revoked,
-		       (uint64_t)j->expiration);
-#endif
-		if (j->revoked && (now > j->expiration)) {
-			list_delete_item(i);
-		}
+	for (i = 0; i < CRED_WHEEL_SLOTS; i++)
+		FREE_NULL_VECTOR(wheel->slot[i]);
+}
+
+static void
+_wheel_add(cred_wheel_t *wheel, uint32_t jobid, uint32_t stepid,
+	   time_t ctime, time_t expiration)
+{
+	time_t tick = expiration / CRED_WHEEL_TICK;
+	vector_t **slot;
+	cred_wheel_entry_t *e;
+
+	/* Entries for ticks already swept are looked at by the next sweep */
+	if (tick < wheel->next_tick)
+		tick = wheel->next_tick;
+
+	slot = &wheel->slot[tick % CRED_WHEEL_SLOTS];
+	if (!*slot)
+		*slot = vector_create(sizeof(cred_wheel_entry_t), 0);
+	e = vector_append(*slot);
+	e->expiration = expiration;
+	e->jobid      = jobid;
+	e->stepid     = stepid;
+	e->ctime      = ctime;
+}
+
+/*
+ * Call f for the entries of every tick that ended before now. f returns 1
+ * once done with an entry, 0 to keep it for the next turn of the wheel.
+ * After a long idle period every slot is visited once.
+ */
+static void
+_wheel_sweep(cred_wheel_t *wheel, time_t now, VectorFindF f, void *arg)
+{
+	time_t end_tick = now / CRED_WHEEL_TICK;
+	vector_t *slot;
+	int i;
+
+	for (i = 0; (i < CRED_WHEEL_SLOTS) && (wheel->next_tick < end_tick);
+	     i++, wheel->next_tick++) {
+		slot = wheel->slot[wheel->next_tick % CRED_WHEEL_SLOTS];
+		if (slot && vector_count(slot))
+			vector_delete_all(slot, f, arg);
 	}
+	if (wheel->next_tick < end_tick)
+		wheel->next_tick = end_tick;
+}
+
+typedef struct {
+	slurm_cred_ctx_t ctx;
+	time_t now;
+} wheel_sweep_arg_t;
 
-	list_iterator_destroy(i);
+static int _expire_job_state(void *x, void *arg)
+{
+	cred_wheel_entry_t *e = (cred_wheel_entry_t *) x;
+	wheel_sweep_arg_t *sweep = (wheel_sweep_arg_t *) arg;
+	job_state_t *j;
+
+	/* Expires beyond one turn of the wheel */
+	if (sweep->now <= e->expiration)
+		return 0;
+
+	/*
+	 * The state may be gone, or have a new expiration with its own entry
+	 * if the job was requeued
+	 */
+	j = _find_job_state(sweep->ctx, e->jobid);
+	if (j && j->revoked && (sweep->now > j->expiration))
+		xhash_delete(sweep->ctx->job_hash, j->key);
+
+	return 1;
 }
 
-static int _list_find_expired(void *x, void *key)
+/* File a revoked job state for removal once its expiration has passed */
+static void
+_queue_job_state_expiration(slurm_cred_ctx_t ctx, job_state_t *j)
 {
-	cred_state_t *s = (cred_state_t *)x;
-	time_t curr_time = *(time_t *)key;
+	if (j->revoked && (j->expiration < (time_t) MAX_TIME))
+		_wheel_add(&ctx->job_wheel, j->jobid, 0, 0, j->expiration);
+}
 
-	if (curr_time > s->expiration)
-		return 1;
-	return 0;
+static void
+_clear_expired_job_states(slurm_cred_ctx_t ctx)
+{
+	wheel_sweep_arg_t sweep = { .ctx = ctx, .now = time(NULL) };
+
+	_wheel_sweep(&ctx->job_wheel, sweep.now, _expire_job_state, &sweep);
+}
+
+static int _expire_cred_state(void *x, void *arg)
+{
+	cred_wheel_entry_t *e = (cred_wheel_entry_t *) x;
+	wheel_sweep_arg_t *sweep = (wheel_sweep_arg_t *) arg;
+	cred_state_t *s;
+	char key[CRED_KEY_LEN];
+
+	/* Expires beyond one turn of the wheel */
+	if (sweep->now <= e->expiration)
+		return 0;
+
+	/* The state may have been rewound, or rewound and inserted again */
+	_cred_state_key(key, e->jobid, e->stepid, e->ctime);
+	s = xhash_get(sweep->ctx->state_hash, key);
+	if (s && (sweep->now > s->expiration))
+		xhash_delete(sweep->ctx->state_hash, key);
+
+	return 1;
 }
 
 static void
 _clear_expired_credential_states(slurm_cred_ctx_t ctx)
 {
-	static time_t last_scan = 0;
-	time_t        now = time(NULL);
+	wheel_sweep_arg_t sweep = { .ctx = ctx, .now = time(NULL) };
 
-	if ((now - last_scan) < 2)	/* Reduces slurmd overhead */
-		return;
-	last_scan = now;
+	_wheel_sweep(&ctx->state_wheel, sweep.now, _expire_cred_state, &sweep);
+}
+
+
+static void
+_cred_state_key(char *key, uint32_t jobid, uint32_t stepid, time_t ctime)
+{
+	snprintf(key, CRED_KEY_LEN, "%u.%u.%"PRId64, jobid, stepid,
+		 (int64_t) ctime);
+}
 
-	list_delete_all(ctx->state_list, _list_find_expired, &now);
+static const char *
+_cred_state_id(void *x)
+{
+	return ((cred_state_t *) x)->key;
 }
 
+static void
+_add_cred_state(slurm_cred_ctx_t ctx, cred_state_t *s)
+{
+	xhash_add(ctx->state_hash, s);
+	_wheel_add(&ctx->state_wheel, s->jobid, s->stepid, s->ctime,
+		   s->expiration);
+}
 
 static void
 _insert_cred_state(slurm_cred_ctx_t ctx, slurm_cred_t *cred)
 {
 	cred_state_t *s = _cred_state_create(ctx, cred);
-	list_append(ctx->state_list, s);
+	_add_cred_state(ctx, s);
 }
 
 
@@ -2105,6 +2325,7 @@ _cred_state_create(slurm_cred_ctx_t ctx, slurm_cred_t *cred)
 	s->stepid     = cred->stepid;
 	s->ctime      = cred->ctime;
 	s->expiration = cred->ctime + ctx->expiry_window;
+	_cred_state_key(s->key, s->jobid, s->stepid, s->ctime);
 
 	return s;
 }
@@ -2135,6 +2356,7 @@ _cred_state_unpack_one(Buf buffer)
 	safe_unpack32(&s->stepid, buffer);
 	safe_unpack_time(&s->ctime, buffer);
 	safe_unpack_time(&s->expiration, buffer);
+	_cred_state_key(s->key, s->jobid, s->stepid, s->ctime);
 	return s;
 
 unpack_error:
@@ -2163,6 +2385,7 @@ _job_state_unpack_one(Buf buffer)
 	safe_unpack_time( &j->revoked,    buffer);
 	safe_unpack_time( &j->ctime,      buffer);
 	safe_unpack_time( &j->expiration, buffer);
+	_job_state_key(j->key, j->jobid);
 
 	if (j->revoked) {
 		strcpy(t2, " revoked:");
@@ -2194,17 +2417,16 @@ unpack_error:
 
 
 static void
-_cred_state_pack(slurm_cred_ctx_t ctx, Buf buffer)
+_cred_state_pack_walk(void *x, void *arg)
 {
-	ListIterator  i = NULL;
-	cred_state_t *s = NULL;
-
-	pack32(list_count(ctx->state_list), buffer);
+	_cred_state_pack_one((cred_state_t *) x, (Buf) arg);
+}
 
-	i = list_iterator_create(ctx->state_list);
-	while ((s = list_next(i)))
-		_cred_state_pack_one(s, buffer);
-	list_iterator_destroy(i);
+static void
+_cred_state_pack(slurm_cred_ctx_t ctx, Buf buffer)
+{
+	pack32(xhash_count(ctx->state_hash), buffer);
+	xhash_walk(ctx->state_hash, _cred_state_pack_walk, buffer);
 }
 
 
@@ -2223,8 +2445,9 @@ _cred_state_unpack(slurm_cred_ctx_t ctx, Buf buffer)
 		if (!(s = _cred_state_unpack_one(buffer)))
 			goto unpack_error;
 
-		if (now < s->expiration)
-			list_append(ctx->state_list, s);
+		if ((now < s->expiration) &&
+		    !xhash_get(ctx->state_hash, s->key))
+			_add_cred_state(ctx, s);
 		else
 			_cred_state_destroy(s);
 	}
@@ -2238,18 +2461,16 @@ unpack_error:
 
 
 static void
-_job_state_pack(slurm_cred_ctx_t ctx, Buf buffer)
+_job_state_pack_walk(void *x, void *arg)
 {
-	ListIterator  i = NULL;
-	job_state_t  *j = NULL;
-
-	pack32((uint32_t) list_count(ctx->job_list), buffer);
-
+	_job_state_pack_one((job_state_t *) x, (Buf) arg);
+}
 
-	i = list_iterator_create(ctx->job_list);
-	while ((j = list_next(i)))
-		_job_state_pack_one(j, buffer);
-	list_iterator_destroy(i);
+static void
+_job_state_pack(slurm_cred_ctx_t ctx, Buf buffer)
+{
+	pack32(xhash_count(ctx->job_hash), buffer);
+	xhash_walk(ctx->job_hash, _job_state_pack_walk, buffer);
 }
 
 
@@ -2268,9 +2489,15 @@ _job_state_unpack(slurm_cred_ctx_t ctx, Buf buffer)
 		if (!(j = _job_state_unpack_one(buffer)))
 			goto unpack_error;
 
-		if (!j->revoked || (j->revoked && (now < j->expiration)))
-			list_append(ctx->job_list, j);
-		else {
+		if (_find_job_state(ctx, j->jobid)) {
+			debug3("not appending duplicate job %u state",
+			       j->jobid);
+			_job_state_destroy(j);
+		} else if (!j->revoked ||
+			   (j->revoked && (now < j->expiration))) {
+			xhash_add(ctx->job_hash, j);
+			_queue_job_state_expiration(ctx, j);
+		} else {
 			debug3 ("not appending expired job %u state",
 			        j->jobid);
 			_job_state_destroy(j);
@@ -109,6 +109,24 @@ int slurm_cred_ctx_get(slurm_cred_ctx_t ctx, slurm_cred_opt_t opt, ...);
  */
 int slurm_cred_ctx_key_update(slurm_cred_ctx_t ctx, const char *keypath);
 
+/*
+ * Credential signing statistics of a creator context, times in microseconds
+ */
+typedef struct {
+	uint64_t batch_cnt;	/* calls to slurm_cred_sign_batch()	*/
+	uint64_t fail_cnt;	/* credentials which failed to sign	*/
+	uint64_t sign_cnt;	/* credentials signed			*/
+	uint64_t sign_max;	/* longest time to sign a credential	*/
+	uint64_t sign_time;	/* total time spent signing		*/
+} slurm_cred_sign_stats_t;
+
+/*
+ * Get or clear the context's credential signing statistics.
+ */
+void slurm_cred_get_sign_stats(slurm_cred_ctx_t ctx,
+			       slurm_cred_sign_stats_t *stats);
+void slurm_cred_reset_sign_stats(slurm_cred_ctx_t ctx);
+
 
 /*
  * Destroy a credential context, freeing associated memory.
@@ -189,6 +207,36 @@ int slurm_crypto_fini(void);
 slurm_cred_t *slurm_cred_create(slurm_cred_ctx_t ctx, slurm_cred_arg_t *arg,
 				uint16_t protocol_version);
 
+/*
+ * Create a slurm credential as slurm_cred_create() does, but leave it
+ * unsigned. This lets the caller copy the arguments while holding its own
+ * locks and sign later. The credential must be signed with
+ * slurm_cred_sign_batch() before it is packed.
+ *
+ * Returns NULL on failure.
+ */
+slurm_cred_t *slurm_cred_create_unsigned(slurm_cred_ctx_t ctx,
+					 slurm_cred_arg_t *arg,
+					 uint16_t protocol_version);
+
+/*
+ * Sign the unsigned credentials among the `cnt' entries of `creds' with the
+ * protocol version given at creation. NULL entries and credentials already
+ * signed are skipped. The context is locked once for the whole batch.
+ * The creation time of each credential is reset to the time it is signed,
+ * so slurmd's expiry window starts then rather than at creation.
+ *
+ * Returns SLURM_SUCCESS, or SLURM_ERROR if any credential could not be signed.
+ * Those credentials are left unsigned and may be passed again later.
+ */
+int slurm_cred_sign_batch(slurm_cred_ctx_t ctx, slurm_cred_t **creds,
+			  int cnt);
+
+/*
+ * Return true if the credential has a signature.
+ */
+bool slurm_cred_signed(slurm_cred_t *cred);
+
 /*
  * Copy a slurm credential.
  * Returns NULL on failure.
@@ -3774,13 +3774,9 @@ total_return:
  *  and hdr into buffer
  */
 static void
-_pack_msg(slurm_msg_t *msg, header_t *hdr, Buf buffer)
+_repack_header(header_t *hdr, uint32_t msglen, Buf buffer)
 {
-	unsigned int tmplen, msglen;
-
-	tmplen = get_buf_offset(buffer);
-	pack_msg(msg, buffer);
-	msglen = get_buf_offset(buffer) - tmplen;
+	unsigned int tmplen;
 
 	/* update header with correct cred and msg lengths */
 	update_header(hdr, msglen);
@@ -3792,6 +3788,18 @@ _pack_msg(slurm_msg_t *msg, header_t *hdr, Buf buffer)
 	set_buf_offset(buffer, tmplen);
 }
 
+static void
+_pack_msg(slurm_msg_t *msg, header_t *hdr, Buf buffer)
+{
+	unsigned int tmplen, msglen;
+
+	tmplen = get_buf_offset(buffer);
+	pack_msg(msg, buffer);
+	msglen = get_buf_offset(buffer) - tmplen;
+
+	_repack_header(hdr, msglen, buffer);
+}
+
 /*
  *  Send a slurm message over an open file descriptor `fd'
  *    Returns the size of the message sent in bytes, or -1 on failure.
@@ -3899,20 +3907,37 @@ int slurm_send_node_msg(int fd, slurm_msg_t * msg)
 		slurm_seterrno_ret(SLURM_PROTOCOL_AUTHENTICATION_ERROR);
 	}
 
-	/*
-	 * Pack message into buffer
-	 */
-	_pack_msg(msg, &header, buffer);
+	if (pack_msg_is_buffer(msg->msg_type)) {
+		struct iovec iov[2];
+
+		/*
+		 * Message body is already packed (e.g. job or node
+		 * information), send it from where it is rather than
+		 * copying it into the buffer after the header
+		 */
+		_repack_header(&header, msg->data_size, buffer);
+		iov[0].iov_base = get_buf_data(buffer);
+		iov[0].iov_len  = get_buf_offset(buffer);
+		iov[1].iov_base = msg->data;
+		iov[1].iov_len  = msg->data_size;
+		rc = slurm_msg_sendv(fd, iov, 2,
+				     SLURM_PROTOCOL_NO_SEND_RECV_FLAGS);
+	} else {
+		/*
+		 * Pack message into buffer
+		 */
+		_pack_msg(msg, &header, buffer);
 
 #if	_DEBUG
-	_print_data (get_buf_data(buffer),get_buf_offset(buffer));
+		_print_data (get_buf_data(buffer),get_buf_offset(buffer));
 #endif
-	/*
-	 * Send message
-	 */
-	rc = slurm_msg_sendto( fd, get_buf_data(buffer),
-			       get_buf_offset(buffer),
-			       SLURM_PROTOCOL_NO_SEND_RECV_FLAGS );
+		/*
+		 * Send message
+		 */
+		rc = slurm_msg_sendto( fd, get_buf_data(buffer),
+				       get_buf_offset(buffer),
+				       SLURM_PROTOCOL_NO_SEND_RECV_FLAGS );
+	}
 
 	if ((rc < 0) && (errno == ENOTCONN)) {
 		debug3("slurm_msg_sendto: peer has disappeared for msg_type=%u",
@@ -1495,10 +1495,34 @@ extern void slurm_free_suspend_int_msg(suspend_int_msg_t *msg)
 
 extern void slurm_free_stats_response_msg(stats_info_response_msg_t *msg)
 {
+	int i;
+
 	if (msg) {
+		for (i = 0; msg->job_hash_name && (i < msg->job_hash_cnt); i++)
+			xfree(msg->job_hash_name[i]);
+		xfree(msg->job_hash_name);
+		xfree(msg->job_hash_size);
+		xfree(msg->job_hash_records);
+		xfree(msg->job_hash_lookups);
+		xfree(msg->job_hash_probes);
+		xfree(msg->job_hash_probe_max);
+		xfree(msg->job_hash_resizes);
+		for (i = 0; msg->lock_stat_name && (i < msg->lock_stat_cnt);
+		     i++)
+			xfree(msg->lock_stat_name[i]);
+		xfree(msg->lock_stat_name);
+		xfree(msg->lock_stat_count);
+		xfree(msg->lock_stat_wait_time);
+		xfree(msg->lock_stat_wait_max);
+		xfree(msg->lock_stat_hold_time);
+		xfree(msg->lock_stat_hold_max);
+		xfree(msg->lock_stat_wait_hist);
+		xfree(msg->lock_stat_hold_hist);
+		xfree(msg->dbd_agent_latency_hist);
 		xfree(msg->rpc_type_id);
 		xfree(msg->rpc_type_cnt);
 		xfree(msg->rpc_type_time);
+		xfree(msg->rpc_type_lock_wait);
 		xfree(msg->rpc_user_id);
 		xfree(msg->rpc_user_cnt);
 		xfree(msg->rpc_user_time);
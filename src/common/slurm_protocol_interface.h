@@ -48,6 +48,7 @@
 #include <sys/socket.h>
 #include <sys/time.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include "src/common/macros.h"
@@ -106,6 +107,20 @@ extern ssize_t slurm_msg_sendto_timeout(int open_fd,
 					size_t size,
 					uint32_t flags,
 					int timeout);
+/* slurm_msg_sendv
+ * Send message made up of several segments over the given connection,
+ *	default timeout value. Segments are written in order without first
+ *	being copied into a single buffer.
+ * IN open_fd - an open file descriptor
+ * IN iov - segments to transmit
+ * IN iov_cnt - number of segments
+ * IN flags - communication specific flags
+ * RET number of bytes written
+ */
+extern ssize_t slurm_msg_sendv(int open_fd,
+			       struct iovec *iov,
+			       int iov_cnt,
+			       uint32_t flags);
 
 /********************/
 /* stream functions */
@@ -1593,6 +1593,30 @@ pack_msg(slurm_msg_t const *msg, Buf buffer)
 	return SLURM_SUCCESS;
 }
 
+/* pack_msg_is_buffer
+ * RET true if pack_msg() packs bodies of this message type by copying the
+ *	already packed msg->data_size bytes at msg->data
+ */
+extern bool pack_msg_is_buffer(uint16_t msg_type)
+{
+	switch (msg_type) {
+	case RESPONSE_ASSOC_MGR_INFO:
+	case RESPONSE_BLOCK_INFO:
+	case RESPONSE_BURST_BUFFER_INFO:
+	case RESPONSE_FRONT_END_INFO:
+	case RESPONSE_JOB_INFO:
+	case RESPONSE_JOB_STEP_INFO:
+	case RESPONSE_LAYOUT_INFO:
+	case RESPONSE_NODE_INFO:
+	case RESPONSE_PARTITION_INFO:
+	case RESPONSE_RESERVATION_INFO:
+	case RESPONSE_STATS_INFO:
+		return true;
+	default:
+		return false;
+	}
+}
+
 /* unpack_msg
  * unpacks a generic slurm protocol message body
  * OUT msg - the body structure to unpack (note: includes message type)
@@ -14221,12 +14245,71 @@ static int  _unpack_stats_response_msg(stats_info_response_msg_t **msg_ptr,
 
 			safe_unpack32(&msg->bf_active,		buffer);
 			safe_unpack32(&msg->bf_backfilled_pack_jobs, buffer);
+
+			safe_unpack32(&msg->job_hash_cnt,	buffer);
+			safe_unpackstr_array(&msg->job_hash_name, &uint32_tmp,
+					     buffer);
+			safe_unpack32_array(&msg->job_hash_size, &uint32_tmp,
+					    buffer);
+			safe_unpack32_array(&msg->job_hash_records, &uint32_tmp,
+					    buffer);
+			safe_unpack64_array(&msg->job_hash_lookups, &uint32_tmp,
+					    buffer);
+			safe_unpack64_array(&msg->job_hash_probes, &uint32_tmp,
+					    buffer);
+			safe_unpack32_array(&msg->job_hash_probe_max,
+					    &uint32_tmp, buffer);
+			safe_unpack32_array(&msg->job_hash_resizes, &uint32_tmp,
+					    buffer);
+
+			safe_unpack32(&msg->lock_stat_cnt,	buffer);
+			safe_unpack32(&msg->lock_stat_hist_cnt,	buffer);
+			safe_unpackstr_array(&msg->lock_stat_name, &uint32_tmp,
+					     buffer);
+			safe_unpack64_array(&msg->lock_stat_count, &uint32_tmp,
+					    buffer);
+			safe_unpack64_array(&msg->lock_stat_wait_time,
+					    &uint32_tmp, buffer);
+			safe_unpack64_array(&msg->lock_stat_wait_max,
+					    &uint32_tmp, buffer);
+			safe_unpack64_array(&msg->lock_stat_hold_time,
+					    &uint32_tmp, buffer);
+			safe_unpack64_array(&msg->lock_stat_hold_max,
+					    &uint32_tmp, buffer);
+			safe_unpack32_array(&msg->lock_stat_wait_hist,
+					    &uint32_tmp, buffer);
+			if (uint32_tmp !=
+			    (msg->lock_stat_cnt * msg->lock_stat_hist_cnt))
+				goto unpack_error;
+			safe_unpack32_array(&msg->lock_stat_hold_hist,
+					    &uint32_tmp, buffer);
+			if (uint32_tmp !=
+			    (msg->lock_stat_cnt * msg->lock_stat_hist_cnt))
+				goto unpack_error;
+
+			safe_unpack64(&msg->cred_sign_cnt,	buffer);
+			safe_unpack64(&msg->cred_sign_batch_cnt, buffer);
+			safe_unpack64(&msg->cred_sign_fail_cnt,	buffer);
+			safe_unpack64(&msg->cred_sign_time,	buffer);
+			safe_unpack64(&msg->cred_sign_max,	buffer);
+			safe_unpack32(&msg->cred_sign_queue,	buffer);
+
+			safe_unpack32(&msg->dbd_agent_queue_max, buffer);
+			safe_unpack64(&msg->dbd_agent_sent_cnt,	buffer);
+			safe_unpack64(&msg->dbd_agent_batch_cnt, buffer);
+			safe_unpack64(&msg->dbd_agent_coalesced_cnt, buffer);
+			safe_unpack64(&msg->dbd_agent_latency_time, buffer);
+			safe_unpack64(&msg->dbd_agent_latency_max, buffer);
+			safe_unpack32_array(&msg->dbd_agent_latency_hist,
+					    &msg->dbd_agent_hist_cnt, buffer);
 		}
 
 		safe_unpack32(&msg->rpc_type_size,		buffer);
 		safe_unpack16_array(&msg->rpc_type_id,   &uint32_tmp, buffer);
 		safe_unpack32_array(&msg->rpc_type_cnt,  &uint32_tmp, buffer);
 		safe_unpack64_array(&msg->rpc_type_time, &uint32_tmp, buffer);
+		safe_unpack64_array(&msg->rpc_type_lock_wait, &uint32_tmp,
+				    buffer);
 
 		safe_unpack32(&msg->rpc_user_size,		buffer);
 		safe_unpack32_array(&msg->rpc_user_id,   &uint32_tmp, buffer);
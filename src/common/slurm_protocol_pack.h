@@ -89,6 +89,12 @@ extern int pack_msg ( slurm_msg_t const * msg , Buf buffer );
  */
 extern int unpack_msg ( slurm_msg_t * msg , Buf buffer );
 
+/* pack_msg_is_buffer
+ * RET true if pack_msg() packs bodies of this message type by copying the
+ *	already packed msg->data_size bytes at msg->data
+ */
+extern bool pack_msg_is_buffer(uint16_t msg_type);
+
 /***************************************************************************/
 /* specific case statement Pack / Unpack methods for slurm protocol bodies */
 /***************************************************************************/
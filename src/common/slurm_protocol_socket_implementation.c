@@ -52,6 +52,7 @@
 #include <sys/socket.h>
 #include <sys/time.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include "slurm/slurm_errno.h"
@@ -197,6 +198,54 @@ ssize_t slurm_msg_sendto_timeout(int fd, char *buffer, size_t size,
 	return len;
 }
 
+ssize_t slurm_msg_sendv(int fd, struct iovec *iov, int iov_cnt,
+			uint32_t flags)
+{
+	int timeout = slurm_get_msg_timeout() * 1000;
+	ssize_t len = 0, size = 0;
+	uint32_t usize;
+	SigFunc *ohandler;
+	int i, rc;
+
+	for (i = 0; i < iov_cnt; i++)
+		size += iov[i].iov_len;
+	if (size > 0xffffffff) {
+		error("%s: message too large (%zd bytes)", __func__, size);
+		slurm_seterrno(SLURM_PROTOCOL_INSANE_MSG_LENGTH);
+		return SLURM_ERROR;
+	}
+
+	/*
+	 *  Ignore SIGPIPE so that send can return a error code if the
+	 *    other side closes the socket
+	 */
+	ohandler = xsignal(SIGPIPE, SIG_IGN);
+
+	usize = htonl(size);
+
+	if ((rc = slurm_send_timeout(fd, (char *)&usize, sizeof(usize), 0,
+				     timeout)) < 0) {
+		len = rc;
+		goto done;
+	}
+
+	for (i = 0; i < iov_cnt; i++) {
+		if (iov[i].iov_len == 0)
+			continue;
+		if ((rc = slurm_send_timeout(fd, iov[i].iov_base,
+					     iov[i].iov_len, 0,
+					     timeout)) < 0) {
+			len = rc;
+			goto done;
+		}
+		len += rc;
+	}
+
+     done:
+	xsignal(SIGPIPE, ohandler);
+	return len;
+}
+
 /* Send slurm message with timeout
  * RET message size (as specified in argument) or SLURM_ERROR on error */
 extern int slurm_send_timeout(int fd, char *buf, size_t size,
@@ -666,6 +666,8 @@ extern void slurmdb_destroy_qos_usage(void *object)
 		(slurmdb_qos_usage_t *)object;
 
 	if (usage) {
+		if (usage->limits_index_free)
+			(usage->limits_index_free)(usage->limits_index);
 		FREE_NULL_LIST(usage->acct_limit_list);
 		FREE_NULL_LIST(usage->job_list);
 		FREE_NULL_LIST(usage->user_limit_list);
@@ -44,6 +44,8 @@
 #include <poll.h>
 #include <pthread.h>
 #include <stdio.h>
+#include <sys/file.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -55,6 +57,7 @@
 #include "src/common/fd.h"
 #include "src/common/pack.h"
 #include "src/common/assoc_mgr.h"
+#include "src/common/lock_stats.h"
 #include "src/common/slurm_auth.h"
 #include "src/common/slurm_accounting_storage.h"
 #include "src/common/slurm_jobacct_gather.h"
@@ -62,6 +65,7 @@
 #include "src/common/slurm_protocol_defs.h"
 #include "src/common/slurmdbd_defs.h"
 #include "src/common/xmalloc.h"
+#include "src/common/xhash.h"
 #include "src/common/xsignal.h"
 #include "src/common/xstring.h"
 
@@ -79,6 +83,77 @@ strong_alias(slurmdbd_free_id_rc_msg,	slurm_slurmdbd_free_id_rc_msg);
 #define MAX_AGENT_QUEUE		10000
 #define MAX_DBD_MSG_LEN		16384
 #define SLURMDBD_TIMEOUT	900	/* Seconds SlurmDBD for response */
+#define DBD_AGENT_BATCH_MAX	1000	/* Messages per DBD_SEND_MULT_MSG */
+#define DBD_AGENT_PIPELINE	4	/* DBD_SEND_MULT_MSG sent before waiting
+					 * for the first reply */
+#define DBD_JOB_KEY_LEN		32
+#define DBD_AGENT_WINDOW	(DBD_AGENT_BATCH_MAX * DBD_AGENT_PIPELINE * 2)
+					/* Messages of a backlog kept in memory,
+					 * the others wait in the spool */
+#define DBD_SPOOL_MAGIC		0xDB5B0013
+#define DBD_SPOOL_DEAD		0xDB5BDEAD	/* magic of a record no longer
+						 * queued */
+#define DBD_SPOOL_VERSION	1
+#define DBD_SPOOL_MIN_SIZE	((uint64_t) 16 * 1024 * 1024)
+#define DBD_SPOOL_MAX_SIZE	((uint64_t) 4 * 1024 * 1024 * 1024)
+
+/* A message in the agent queue */
+typedef struct {
+	Buf buffer;
+	uint16_t msg_type;
+	uint64_t queue_time;		/* lock_stats_now() when queued */
+	uint64_t spool_seq;		/* of its spool record, 0 if none */
+	uint64_t spool_pos;		/* offset of its spool record plus
+					 * agent_spool.shift, never reused */
+	char job_key[DBD_JOB_KEY_LEN];	/* "<job_id>@<submit_time>" of job
+					 * and step messages, else empty */
+} dbd_agent_msg_t;
+
+/* Messages taken off the agent queue to be sent together */
+typedef struct {
+	List msgs;	/* dbd_agent_msg_t in queue order, removed when
+			 * acknowledged, requeued otherwise */
+	Buf buffer;	/* DBD_SEND_MULT_MSG or NULL to send one message */
+} dbd_agent_batch_t;
+
+/* Start of the agent spool file, records follow up to tail */
+typedef struct {
+	uint32_t magic;		/* DBD_SPOOL_MAGIC */
+	uint32_t version;	/* DBD_SPOOL_VERSION */
+	uint64_t size;		/* of the file */
+	uint64_t head;		/* offset of the oldest record still queued */
+	uint64_t tail;		/* offset after the last record */
+} dbd_spool_hdr_t;
+
+/* A spooled message, followed by its packed data padded to 8 bytes */
+typedef struct {
+	uint32_t magic;		/* DBD_MAGIC or DBD_SPOOL_DEAD */
+	uint32_t size;		/* of the packed data */
+	uint64_t seq;		/* increasing from record to record */
+	uint64_t queue_time;
+	uint16_t rpc_version;	/* the data was packed for */
+	uint16_t reserved[3];
+} dbd_spool_rec_t;
+
+/*
+ * Every queued message is appended to the spool, a file mapped in memory.
+ * Once a backlog outgrows DBD_AGENT_WINDOW messages, new ones are only
+ * kept there and read back as the agent sends the older ones. Records are
+ * released from the head once their messages left the queue.
+ */
+typedef struct {
+	int fd;
+	char *fname;
+	dbd_spool_hdr_t *hdr;	/* mapped file, NULL if not open */
+	uint64_t read;		/* offset of the first record not read into
+				 * agent_list */
+	uint32_t unread_cnt;	/* records from read to tail */
+	uint32_t recover_cnt;	/* of them left by an earlier slurmctld */
+	uint64_t seq;		/* of the next record */
+	uint64_t shift;		/* bytes records were moved back by,
+				 * see _spool_pos_rec() */
+	bool full;		/* last write failed */
+} dbd_spool_t;
 
 uint16_t running_cache = 0;
 pthread_mutex_t assoc_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
@@ -88,6 +163,10 @@ static pthread_mutex_t agent_lock = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t  agent_cond = PTHREAD_COND_INITIALIZER;
 static List      agent_list     = (List) NULL;
 static pthread_t agent_tid      = 0;
+static xhash_t  *agent_job_hash = NULL;	/* last queued message of a job */
+static int       agent_inflight = 0;	/* messages off agent_list being sent */
+static slurmdbd_agent_stats_t agent_stats;
+static dbd_spool_t agent_spool = { .fd = -1 };
 
 static pthread_mutex_t slurmdbd_lock = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t  slurmdbd_cond = PTHREAD_COND_INITIALIZER;
@@ -102,11 +181,16 @@ static time_t    slurmdbd_shutdown   = 0;
 
 
 static void * _agent(void *x);
+static bool   _coalesce_agent_msg(dbd_agent_msg_t *msg);
 static void   _create_agent(void);
+static void   _free_agent_msg(void *x);
+static void   _index_agent_msg(dbd_agent_msg_t *msg);
+static dbd_agent_msg_t *_make_agent_msg(Buf buffer, uint16_t msg_type);
+static void   _set_job_key(dbd_agent_msg_t *msg, slurmdbd_msg_t *req);
 static int _unpack_config_name(char **object, uint16_t rpc_version, Buf buffer);
-static int    _get_return_code(void);
 static Buf    _load_dbd_rec(int fd);
 static void   _load_dbd_state(void);
+static Buf    _repack_dbd_rec(Buf buffer, uint16_t rpc_version);
 static void   _open_slurmdbd_conn(bool db_needed);
 static int    _purge_step_req(void);
 static int    _purge_job_start_req(void);
@@ -115,6 +199,13 @@ static void   _save_dbd_state(void);
 static int    _send_fini_msg(void);
 static void   _sig_handler(int signal);
 static void   _shutdown_agent(void);
+static void   _spool_close(void);
+static void   _spool_drop(dbd_agent_msg_t *msg);
+static void   _spool_open(void);
+static void   _spool_read(void);
+static void   _spool_replace(dbd_agent_msg_t *msg);
+static void   _spool_release(void);
+static int    _spool_write(dbd_agent_msg_t *msg);
 static void   _slurmdbd_packstr(void *str, uint16_t rpc_version, Buf buffer);
 static int    _slurmdbd_unpackstr(void **str, uint16_t rpc_version, Buf buffer);
 
@@ -331,7 +422,9 @@ end_it:
 extern int slurm_send_slurmdbd_msg(uint16_t rpc_version, slurmdbd_msg_t *req)
 {
 	Buf buffer;
+	dbd_agent_msg_t *msg;
 	int cnt, rc = SLURM_SUCCESS;
+	bool spooled, behind_spool = false;
 	static time_t syslog_time = 0;
 	static int max_agent_queue = 0;
 
@@ -349,17 +442,19 @@ extern int slurm_send_slurmdbd_msg(uint16_t rpc_version, slurmdbd_msg_t *req)
 		slurmdbd_conn, (persist_msg_t *)req);
 	if (!buffer)	/* pack error */
 		return SLURM_ERROR;
+	msg = _make_agent_msg(buffer, req->msg_type);
+	_set_job_key(msg, req);
 
 	slurm_mutex_lock(&agent_lock);
 	if ((agent_tid == 0) || (agent_list == NULL)) {
 		_create_agent();
 		if ((agent_tid == 0) || (agent_list == NULL)) {
 			slurm_mutex_unlock(&agent_lock);
-			free_buf(buffer);
+			_free_agent_msg(msg);
 			return SLURM_ERROR;
 		}
 	}
-	cnt = list_count(agent_list);
+	cnt = list_count(agent_list) + agent_inflight + agent_spool.unread_cnt;
 	if ((cnt >= (max_agent_queue / 2)) &&
 	    (difftime(time(NULL), syslog_time) > 120)) {
 		/* Record critical error every 120 seconds */
@@ -370,21 +465,63 @@ extern int slurm_send_slurmdbd_msg(uint16_t rpc_version, slurmdbd_msg_t *req)
 		if (slurmdbd_conn->trigger_callbacks.dbd_fail)
 			(slurmdbd_conn->trigger_callbacks.dbd_fail)();
 	}
-	if (cnt == (max_agent_queue - 1))
+
+	if (_coalesce_agent_msg(msg)) {
+		slurm_mutex_unlock(&agent_lock);
+		_free_agent_msg(msg);
+		return rc;
+	}
+
+	/* Spooled messages are only limited by the spool size */
+	spooled = (_spool_write(msg) == SLURM_SUCCESS);
+	if (spooled && (agent_spool.unread_cnt ||
+			(list_count(agent_list) >= DBD_AGENT_WINDOW))) {
+		/*
+		 * Read back after the messages waiting in the spool. None
+		 * queued later may be merged into those in memory.
+		 */
+		xhash_clear(agent_job_hash);
+		agent_spool.unread_cnt++;
+		_free_agent_msg(msg);
+		msg = NULL;
+	} else if (spooled) {
+		agent_spool.read = agent_spool.hdr->tail;
+	} else if (agent_spool.hdr &&
+		   (agent_spool.hdr->head < agent_spool.hdr->tail)) {
+		/*
+		 * Queued in memory, or saved to dbd.messages on shutdown, it
+		 * would be sent before the messages still in the spool.
+		 */
+		behind_spool = true;
+	}
+
+	if (!spooled && (cnt == (max_agent_queue - 1)))
 		cnt -= _purge_step_req();
-	if (cnt == (max_agent_queue - 1))
+	if (!spooled && (cnt == (max_agent_queue - 1)))
 		cnt -= _purge_job_start_req();
-	if (cnt < max_agent_queue) {
-		if (list_enqueue(agent_list, buffer) == NULL)
-			fatal("list_enqueue: memory allocation failure");
+	if (spooled || (!behind_spool && (cnt < max_agent_queue))) {
+		if (msg) {
+			if (list_enqueue(agent_list, msg) == NULL)
+				fatal("list_enqueue: memory allocation failure");
+			_index_agent_msg(msg);
+		}
+		if (++cnt > agent_stats.queue_max)
+			agent_stats.queue_max = cnt;
 	} else {
-		error("slurmdbd: agent queue is full (%u), discarding %s:%u request",
-		      cnt,
-		      slurmdbd_msg_type_2_str(req->msg_type, 1),
-		      req->msg_type);
+		if (behind_spool) {
+			error("slurmdbd: spool file %s is full, discarding %s:%u request",
+			      agent_spool.fname,
+			      slurmdbd_msg_type_2_str(req->msg_type, 1),
+			      req->msg_type);
+		} else {
+			error("slurmdbd: agent queue is full (%u), discarding %s:%u request",
+			      cnt,
+			      slurmdbd_msg_type_2_str(req->msg_type, 1),
+			      req->msg_type);
+		}
 		if (slurmdbd_conn->trigger_callbacks.acct_full)
 			(slurmdbd_conn->trigger_callbacks.acct_full)();
-		free_buf(buffer);
+		_free_agent_msg(msg);
 		rc = SLURM_ERROR;
 	}
 
@@ -1769,31 +1906,42 @@ unpack_error:
 }
 
 
-static int _get_return_code(void)
+/* Record the acknowledgment of msg and free it, agent_lock must be held */
+static void _agent_msg_done(dbd_agent_msg_t *msg, uint64_t now)
 {
-	int rc = SLURM_ERROR;
-	Buf buffer = slurm_persist_recv_msg(slurmdbd_conn);
-	if (buffer == NULL)
-		return rc;
+	uint64_t latency = (now > msg->queue_time) ?
+			   (now - msg->queue_time) : 0;
+	uint64_t bound = 10000;
+	int i;
 
-	rc = _unpack_return_code(slurmdbd_conn->version, buffer);
+	_spool_drop(msg);
+	agent_stats.sent_cnt++;
+	agent_stats.latency_time += latency;
+	if (latency > agent_stats.latency_max)
+		agent_stats.latency_max = latency;
+	for (i = 0; i < (DBD_AGENT_HIST_CNT - 1); i++, bound *= 10) {
+		if (latency < bound)
+			break;
+	}
+	agent_stats.latency_hist[i]++;
 
-	free_buf(buffer);
-	return rc;
+	_free_agent_msg(msg);
 }
 
-static int _handle_mult_rc_ret(void)
+/*
+ * Handle the reply to a DBD_SEND_MULT_MSG, freeing the messages of batch
+ * acknowledged. The SlurmDBD stops processing a batch at the first failure.
+ */
+static int _handle_mult_rc_ret(Buf buffer, dbd_agent_batch_t *batch)
 {
-	Buf buffer;
 	uint16_t msg_type;
 	persist_rc_msg_t *msg = NULL;
 	dbd_list_msg_t *list_msg = NULL;
+	dbd_agent_msg_t *agent_msg;
+	ListIterator itr;
 	int rc = SLURM_ERROR;
 	Buf out_buf = NULL;
-
-	buffer = slurm_persist_recv_msg(slurmdbd_conn);
-	if (buffer == NULL)
-		return rc;
+	uint64_t now = lock_stats_now();
 
 	safe_unpack16(&msg_type, buffer);
 	switch (msg_type) {
@@ -1807,25 +1955,22 @@ static int _handle_mult_rc_ret(void)
 		}
 
 		slurm_mutex_lock(&agent_lock);
-		if (agent_list) {
-			ListIterator itr =
-				list_iterator_create(list_msg->my_list);
-			while ((out_buf = list_next(itr))) {
-				Buf b;
-				if ((rc = _unpack_return_code(
-					    slurmdbd_conn->version, out_buf))
-				    != SLURM_SUCCESS)
-					break;
-
-				if ((b = list_dequeue(agent_list))) {
-					free_buf(b);
-				} else {
-					error("slurmdbd: DBD_GOT_MULT_MSG "
-					      "unpack message error");
-				}
+		itr = list_iterator_create(list_msg->my_list);
+		while ((out_buf = list_next(itr))) {
+			if ((rc = _unpack_return_code(
+				     slurmdbd_conn->version, out_buf))
+			    != SLURM_SUCCESS)
+				break;
+
+			if ((agent_msg = list_dequeue(batch->msgs))) {
+				_agent_msg_done(agent_msg, now);
+				agent_inflight--;
+			} else {
+				error("slurmdbd: DBD_GOT_MULT_MSG "
+				      "unpack message error");
 			}
-			list_iterator_destroy(itr);
 		}
+		list_iterator_destroy(itr);
 		slurm_mutex_unlock(&agent_lock);
 		slurmdbd_free_list_msg(list_msg);
 		break;
@@ -1868,13 +2013,664 @@ static int _handle_mult_rc_ret(void)
 	}
 
 unpack_error:
-	free_buf(buffer);
 	return rc;
 }
 
 /****************************************************************************
  * Functions for agent to manage queue of pending message for the Slurm DBD
  ****************************************************************************/
+static dbd_agent_msg_t *_make_agent_msg(Buf buffer, uint16_t msg_type)
+{
+	dbd_agent_msg_t *msg = xmalloc(sizeof(dbd_agent_msg_t));
+
+	msg->buffer = buffer;
+	msg->msg_type = msg_type;
+	msg->queue_time = lock_stats_now();
+
+	return msg;
+}
+
+static void _free_agent_msg(void *x)
+{
+	dbd_agent_msg_t *msg = (dbd_agent_msg_t *) x;
+
+	if (msg) {
+		free_buf(msg->buffer);
+		xfree(msg);
+	}
+}
+
+static const char *_agent_msg_id(void *x)
+{
+	return ((dbd_agent_msg_t *) x)->job_key;
+}
+
+/* Record which job a job or step message is about */
+static void _set_job_key(dbd_agent_msg_t *msg, slurmdbd_msg_t *req)
+{
+	uint32_t job_id;
+	time_t submit_time;
+
+	switch (req->msg_type) {
+	case DBD_JOB_COMPLETE:
+		job_id = ((dbd_job_comp_msg_t *) req->data)->job_id;
+		submit_time = ((dbd_job_comp_msg_t *) req->data)->submit_time;
+		break;
+	case DBD_JOB_START:
+		job_id = ((dbd_job_start_msg_t *) req->data)->job_id;
+		submit_time = ((dbd_job_start_msg_t *) req->data)->submit_time;
+		break;
+	case DBD_JOB_SUSPEND:
+		job_id = ((dbd_job_suspend_msg_t *) req->data)->job_id;
+		submit_time =
+			((dbd_job_suspend_msg_t *) req->data)->submit_time;
+		break;
+	case DBD_STEP_COMPLETE:
+		job_id = ((dbd_step_comp_msg_t *) req->data)->job_id;
+		submit_time =
+			((dbd_step_comp_msg_t *) req->data)->job_submit_time;
+		break;
+	case DBD_STEP_START:
+		job_id = ((dbd_step_start_msg_t *) req->data)->job_id;
+		submit_time =
+			((dbd_step_start_msg_t *) req->data)->job_submit_time;
+		break;
+	default:
+		return;
+	}
+
+	snprintf(msg->job_key, sizeof(msg->job_key), "%u@%"PRIu64,
+		 job_id, (uint64_t) submit_time);
+}
+
+/*
+ * A job start message holds the whole job record, so it replaces a job
+ * start message still queued for the same job provided no other message
+ * about the job was queued since. The earlier message keeps its place in
+ * the queue. agent_lock must be held.
+ * RET true if msg was merged into a queued message, its buffer is then the
+ * replaced one and msg must be freed
+ */
+static bool _coalesce_agent_msg(dbd_agent_msg_t *msg)
+{
+	dbd_agent_msg_t *last;
+	Buf buffer;
+
+	if ((msg->msg_type != DBD_JOB_START) || !agent_job_hash ||
+	    !(last = xhash_get(agent_job_hash, msg->job_key)) ||
+	    (last->msg_type != DBD_JOB_START) ||
+	    (last->spool_seq && agent_spool.unread_cnt))
+		return false;
+
+	buffer = last->buffer;
+	last->buffer = msg->buffer;
+	msg->buffer = buffer;
+	if (last->spool_seq)
+		_spool_replace(last);
+	agent_stats.coalesced_cnt++;
+
+	return true;
+}
+
+/* Record msg as the last queued message of its job, agent_lock must be held */
+static void _index_agent_msg(dbd_agent_msg_t *msg)
+{
+	if (!agent_job_hash)
+		agent_job_hash = xhash_init(_agent_msg_id, NULL, NULL, 0);
+
+	if (msg->job_key[0]) {
+		(void) xhash_pop(agent_job_hash, msg->job_key);
+		xhash_add(agent_job_hash, msg);
+	} else if (msg->msg_type != DBD_NODE_STATE) {
+		/*
+		 * Other messages may affect jobs (e.g. DBD_FLUSH_JOBS), no
+		 * job message queued before them may be changed.
+		 */
+		xhash_clear(agent_job_hash);
+	}
+}
+
+/* Forget msg when it leaves the agent queue, agent_lock must be held */
+static void _unindex_agent_msg(dbd_agent_msg_t *msg)
+{
+	if (msg->job_key[0] && agent_job_hash &&
+	    (xhash_get(agent_job_hash, msg->job_key) == msg))
+		(void) xhash_pop(agent_job_hash, msg->job_key);
+}
+
+/*
+ * Take messages off the agent queue to be sent: one message alone if it is
+ * the only one queued, else up to DBD_AGENT_PIPELINE batches of up to
+ * DBD_AGENT_BATCH_MAX messages. agent_lock must be held.
+ * RET count of batches filled
+ */
+static int _take_agent_batches(dbd_agent_batch_t *batches)
+{
+	slurmdbd_msg_t list_req;
+	dbd_list_msg_t list_msg;
+	dbd_agent_msg_t *msg;
+	int i, j;
+
+	list_req.msg_type = DBD_SEND_MULT_MSG;
+	list_req.data = &list_msg;
+	memset(&list_msg, 0, sizeof(dbd_list_msg_t));
+
+	for (i = 0; (i < DBD_AGENT_PIPELINE) && list_count(agent_list); i++) {
+		batches[i].msgs = list_create(_free_agent_msg);
+		batches[i].buffer = NULL;
+		if ((i == 0) && (list_count(agent_list) == 1)) {
+			msg = list_dequeue(agent_list);
+			_unindex_agent_msg(msg);
+			list_append(batches[i].msgs, msg);
+			agent_inflight++;
+			return 1;
+		}
+
+		list_msg.my_list = list_create(NULL);
+		for (j = 0; (j < DBD_AGENT_BATCH_MAX) &&
+			    (msg = list_dequeue(agent_list)); j++) {
+			_unindex_agent_msg(msg);
+			list_append(batches[i].msgs, msg);
+			list_append(list_msg.my_list, msg->buffer);
+		}
+		agent_inflight += j;
+		batches[i].buffer = pack_slurmdbd_msg(&list_req,
+						      SLURM_PROTOCOL_VERSION);
+		FREE_NULL_LIST(list_msg.my_list);
+	}
+
+	return i;
+}
+
+/*
+ * Put the messages of batches not acknowledged back at the head of the
+ * agent queue in their original order and free the batches.
+ * agent_lock must be held.
+ */
+static void _requeue_agent_batches(dbd_agent_batch_t *batches, int batch_cnt)
+{
+	List requeue = NULL;
+	int i;
+
+	for (i = 0; i < batch_cnt; i++) {
+		if (list_count(batches[i].msgs)) {
+			if (!requeue)
+				requeue = list_create(_free_agent_msg);
+			agent_inflight -= list_transfer(requeue,
+							batches[i].msgs);
+		}
+		FREE_NULL_LIST(batches[i].msgs);
+		if (batches[i].buffer)
+			free_buf(batches[i].buffer);
+	}
+
+	if (requeue) {
+		if (agent_list) {
+			list_transfer(requeue, agent_list);
+			list_transfer(agent_list, requeue);
+		}
+		FREE_NULL_LIST(requeue);
+	}
+}
+
+/*
+ * Send the batches, then read their replies in order. Replies are read for
+ * all batches sent so the connection stays in step with the SlurmDBD.
+ * The SlurmDBD goes on with the batches after one that failed, but nothing
+ * after the first failure is acknowledged, so that the messages are resent
+ * in their original order. Messages of a job must never be reordered.
+ * slurmdbd_lock must be held.
+ * RET SLURM_SUCCESS if all messages were acknowledged
+ */
+static int _send_agent_batches(dbd_agent_batch_t *batches, int batch_cnt)
+{
+	dbd_agent_msg_t *msg;
+	Buf buffer;
+	uint16_t reconnect = slurmdbd_conn->flags & PERSIST_FLAG_RECONNECT;
+	bool failed = false;
+	int i, sent, rc = SLURM_SUCCESS, rc2;
+
+	for (sent = 0; sent < batch_cnt; sent++) {
+		if (batches[sent].buffer)
+			buffer = batches[sent].buffer;
+		else
+			buffer = ((dbd_agent_msg_t *)
+				  list_peek(batches[sent].msgs))->buffer;
+		rc = slurm_persist_send_msg(slurmdbd_conn, buffer);
+		if (rc != SLURM_SUCCESS) {
+			if (!*slurmdbd_conn->shutdown)
+				error("slurmdbd: Failure sending message: %d: %m",
+				      rc);
+			break;
+		}
+		if (batches[sent].buffer) {
+			slurm_mutex_lock(&agent_lock);
+			agent_stats.batch_cnt++;
+			slurm_mutex_unlock(&agent_lock);
+		}
+		/*
+		 * Replies are matched to batches by their order, so the
+		 * connection must not be silently reopened once a batch is
+		 * in flight. It is closed on failure instead, and reopened by
+		 * the agent.
+		 */
+		slurmdbd_conn->flags &= ~PERSIST_FLAG_RECONNECT;
+	}
+
+	for (i = 0; i < sent; i++) {
+		if (!(buffer = slurm_persist_recv_msg(slurmdbd_conn))) {
+			rc = SLURM_ERROR;
+			break;
+		}
+		if (failed) {
+			/* Requeued behind the failed batch */
+			free_buf(buffer);
+			continue;
+		}
+		if (batches[i].buffer) {
+			rc2 = _handle_mult_rc_ret(buffer, &batches[i]);
+		} else {
+			rc2 = _unpack_return_code(slurmdbd_conn->version,
+						  buffer);
+			if (rc2 == SLURM_SUCCESS) {
+				slurm_mutex_lock(&agent_lock);
+				msg = list_dequeue(batches[i].msgs);
+				_agent_msg_done(msg, lock_stats_now());
+				agent_inflight--;
+				slurm_mutex_unlock(&agent_lock);
+			} else if ((rc2 == EAGAIN) &&
+				   !*slurmdbd_conn->shutdown) {
+				error("slurmdbd: Failure with "
+				      "message need to resend: %d: %m", rc2);
+			}
+		}
+		free_buf(buffer);
+		if (rc2 != SLURM_SUCCESS)
+			rc = rc2;
+		if ((rc2 != SLURM_SUCCESS) || list_count(batches[i].msgs))
+			failed = true;
+	}
+
+	/*
+	 * Messages whose reply was not read will be resent, the SlurmDBD may
+	 * have processed some of them already.
+	 */
+	if (sent && ((i < sent) || (sent < batch_cnt)))
+		slurm_persist_conn_close(slurmdbd_conn);
+	slurmdbd_conn->flags |= reconnect;
+
+	return rc;
+}
+
+static inline dbd_spool_rec_t *_spool_rec(uint64_t offset)
+{
+	return (dbd_spool_rec_t *) ((char *) agent_spool.hdr + offset);
+}
+
+static inline uint64_t _spool_rec_len(uint32_t size)
+{
+	return sizeof(dbd_spool_rec_t) + (((uint64_t) size + 7) & ~7);
+}
+
+/*
+ * Positions are offsets in a file that never moves records back: whenever
+ * records move back, shift grows by as much. Positions of released records
+ * thus fall before the head.
+ * RET the record at a position, NULL if it was released
+ */
+static dbd_spool_rec_t *_spool_pos_rec(uint64_t pos)
+{
+	uint64_t offset = pos - agent_spool.shift;
+
+	if (!agent_spool.hdr || (pos < agent_spool.shift) ||
+	    (offset < agent_spool.hdr->head) ||
+	    (offset >= agent_spool.hdr->tail))
+		return NULL;
+
+	return _spool_rec(offset);
+}
+
+/* Grow or shrink the spool file and map it again */
+static int _spool_resize(uint64_t size)
+{
+	uint64_t old_size = agent_spool.hdr->size;
+	void *addr;
+	int rc;
+
+	/* Allocate blocks now, so writing to the map can not fail */
+	if ((size > old_size) &&
+	    (rc = posix_fallocate(agent_spool.fd, old_size, size - old_size))) {
+		error("slurmdbd: unable to grow spool file %s to %"PRIu64
+		      " bytes: %s", agent_spool.fname, size, strerror(rc));
+		return SLURM_ERROR;
+	}
+
+	addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+		    agent_spool.fd, 0);
+	if (addr == MAP_FAILED) {
+		error("slurmdbd: unable to map spool file %s: %m",
+		      agent_spool.fname);
+		return SLURM_ERROR;
+	}
+	(void) munmap(agent_spool.hdr, old_size);
+	agent_spool.hdr = addr;
+
+	if ((size < old_size) && ftruncate(agent_spool.fd, size))
+		error("slurmdbd: unable to truncate spool file %s: %m",
+		      agent_spool.fname);
+	agent_spool.hdr->size = size;
+
+	return SLURM_SUCCESS;
+}
+
+/*
+ * Open the spool file and count the records left in it, those are read into
+ * agent_list after any message already there. agent_lock must be held.
+ */
+static void _spool_open(void)
+{
+	dbd_spool_hdr_t *hdr;
+	dbd_spool_rec_t *rec;
+	struct stat stat_buf;
+	uint64_t offset, size;
+	bool init = false;
+	int rc;
+
+	if (agent_spool.hdr)
+		return;
+
+	agent_spool.fname = slurm_get_state_save_location();
+	xstrcat(agent_spool.fname, "/dbd.spool");
+	agent_spool.fd = open(agent_spool.fname, O_RDWR | O_CREAT | O_CLOEXEC,
+			      0600);
+	if (agent_spool.fd < 0) {
+		error("slurmdbd: Opening spool file %s: %m", agent_spool.fname);
+		goto fail;
+	}
+	if (flock(agent_spool.fd, LOCK_EX | LOCK_NB)) {
+		error("slurmdbd: Locking spool file %s: %m", agent_spool.fname);
+		goto fail;
+	}
+	if (fstat(agent_spool.fd, &stat_buf)) {
+		error("slurmdbd: Checking spool file %s: %m",
+		      agent_spool.fname);
+		goto fail;
+	}
+
+	size = stat_buf.st_size;
+	if (size < DBD_SPOOL_MIN_SIZE) {
+		if ((rc = posix_fallocate(agent_spool.fd, 0,
+					  DBD_SPOOL_MIN_SIZE))) {
+			error("slurmdbd: unable to allocate spool file %s: %s",
+			      agent_spool.fname, strerror(rc));
+			goto fail;
+		}
+		size = DBD_SPOOL_MIN_SIZE;
+		init = true;
+	}
+	hdr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+		   agent_spool.fd, 0);
+	if (hdr == MAP_FAILED) {
+		error("slurmdbd: unable to map spool file %s: %m",
+		      agent_spool.fname);
+		goto fail;
+	}
+
+	if (!init &&
+	    ((hdr->magic != DBD_SPOOL_MAGIC) ||
+	     (hdr->version != DBD_SPOOL_VERSION) || (hdr->size != size) ||
+	     (hdr->head < sizeof(dbd_spool_hdr_t)) ||
+	     (hdr->head > hdr->tail) || (hdr->tail > size))) {
+		error("slurmdbd: spool file %s is invalid, discarding it",
+		      agent_spool.fname);
+		init = true;
+	}
+	if (init) {
+		hdr->magic = DBD_SPOOL_MAGIC;
+		hdr->version = DBD_SPOOL_VERSION;
+		hdr->size = size;
+		hdr->head = hdr->tail = sizeof(dbd_spool_hdr_t);
+	}
+	agent_spool.hdr = hdr;
+	agent_spool.read = hdr->head;
+	agent_spool.unread_cnt = 0;
+	agent_spool.seq = 1;
+
+	for (offset = hdr->head; offset < hdr->tail;
+	     offset += _spool_rec_len(rec->size)) {
+		rec = _spool_rec(offset);
+		if (((hdr->tail - offset) < sizeof(dbd_spool_rec_t)) ||
+		    ((rec->magic != DBD_MAGIC) &&
+		     (rec->magic != DBD_SPOOL_DEAD)) || (rec->size < 2) ||
+		    (_spool_rec_len(rec->size) > (hdr->tail - offset)) ||
+		    (rec->seq < agent_spool.seq)) {
+			error("slurmdbd: spool file %s is corrupted at offset %"
+			      PRIu64", discarding the rest",
+			      agent_spool.fname, offset);
+			hdr->tail = offset;
+			break;
+		}
+		agent_spool.seq = rec->seq + 1;
+		if (rec->magic == DBD_MAGIC)
+			agent_spool.unread_cnt++;
+	}
+	agent_spool.recover_cnt = agent_spool.unread_cnt;
+	if (agent_spool.unread_cnt)
+		verbose("slurmdbd: recovered %u spooled RPCs",
+			agent_spool.unread_cnt);
+	return;
+
+fail:
+	if (agent_spool.fd >= 0)
+		(void) close(agent_spool.fd);
+	agent_spool.fd = -1;
+	xfree(agent_spool.fname);
+}
+
+/* Release the records not needed any more and close the spool file */
+static void _spool_close(void)
+{
+	if (agent_spool.hdr) {
+		_spool_release();
+		if (msync(agent_spool.hdr, agent_spool.hdr->size, MS_SYNC))
+			error("slurmdbd: unable to sync spool file %s: %m",
+			      agent_spool.fname);
+		(void) munmap(agent_spool.hdr, agent_spool.hdr->size);
+	}
+	if (agent_spool.fd >= 0)
+		(void) close(agent_spool.fd);
+	xfree(agent_spool.fname);
+	memset(&agent_spool, 0, sizeof(dbd_spool_t));
+	agent_spool.fd = -1;
+}
+
+/*
+ * Append a record of msg to the spool and set its spool_seq. Space released
+ * at the head is reused by moving the records to the start of the file if
+ * they are not more than it, else the file grows. agent_lock must be held.
+ * RET SLURM_SUCCESS or SLURM_ERROR if the spool is not open or full
+ */
+static int _spool_write(dbd_agent_msg_t *msg)
+{
+	dbd_spool_hdr_t *hdr = agent_spool.hdr;
+	dbd_spool_rec_t *rec;
+	uint32_t size = get_buf_offset(msg->buffer);
+	uint64_t len = _spool_rec_len(size), used, new_size;
+
+	if (!hdr || (size < 2))
+		return SLURM_ERROR;
+
+	if ((hdr->tail + len) > hdr->size) {
+		used = hdr->tail - hdr->head;
+		if ((hdr->head - sizeof(dbd_spool_hdr_t)) >= (used + len)) {
+			memmove(_spool_rec(sizeof(dbd_spool_hdr_t)),
+				_spool_rec(hdr->head), used);
+			agent_spool.read -= hdr->head -
+					    sizeof(dbd_spool_hdr_t);
+			agent_spool.shift += hdr->head -
+					     sizeof(dbd_spool_hdr_t);
+			hdr->head = sizeof(dbd_spool_hdr_t);
+			hdr->tail = hdr->head + used;
+		} else {
+			new_size = hdr->size;
+			while (new_size < (hdr->tail + len))
+				new_size *= 2;
+			if ((new_size > DBD_SPOOL_MAX_SIZE) ||
+			    (_spool_resize(new_size) != SLURM_SUCCESS)) {
+				if (!agent_spool.full)
+					error("slurmdbd: spool file %s is full",
+					      agent_spool.fname);
+				agent_spool.full = true;
+				return SLURM_ERROR;
+			}
+			hdr = agent_spool.hdr;
+		}
+	}
+	agent_spool.full = false;
+
+	rec = _spool_rec(hdr->tail);
+	rec->magic = DBD_MAGIC;
+	rec->size = size;
+	rec->seq = agent_spool.seq++;
+	rec->queue_time = msg->queue_time;
+	rec->rpc_version = SLURM_PROTOCOL_VERSION;
+	memcpy(rec + 1, get_buf_data(msg->buffer), size);
+	/* Only a complete record becomes part of the spool */
+	msg->spool_pos = hdr->tail + agent_spool.shift;
+	hdr->tail += len;
+
+	msg->spool_seq = rec->seq;
+
+	return SLURM_SUCCESS;
+}
+
+/*
+ * Spool a queued message again after its buffer was replaced. The new record
+ * is appended and the old one marked dead. The message keeps its spool_seq,
+ * which orders it in the queue for _spool_release(). No spooled message may
+ * be unread, so the new record is not read back. agent_lock must be held.
+ */
+static void _spool_replace(dbd_agent_msg_t *msg)
+{
+	uint64_t seq = msg->spool_seq, pos = msg->spool_pos;
+	dbd_spool_rec_t *rec;
+
+	xassert(!agent_spool.unread_cnt);
+
+	/* A crash in between leaves both records, never neither */
+	if (_spool_write(msg) == SLURM_SUCCESS) {
+		msg->spool_seq = seq;
+		agent_spool.read = agent_spool.hdr->tail;
+	} else
+		msg->spool_seq = 0;	/* kept in memory only */
+	if ((rec = _spool_pos_rec(pos)))
+		rec->magic = DBD_SPOOL_DEAD;
+}
+
+/*
+ * Mark the record of an acknowledged message dead so it is not sent again
+ * after a restart. Its space is released with the records before it.
+ * agent_lock must be held.
+ */
+static void _spool_drop(dbd_agent_msg_t *msg)
+{
+	dbd_spool_rec_t *rec;
+
+	if (msg->spool_seq && (rec = _spool_pos_rec(msg->spool_pos)))
+		rec->magic = DBD_SPOOL_DEAD;
+}
+
+/*
+ * Read spooled messages into agent_list until it holds DBD_AGENT_WINDOW
+ * messages. agent_lock must be held.
+ */
+static void _spool_read(void)
+{
+	dbd_spool_rec_t *rec;
+	dbd_agent_msg_t *msg;
+	Buf buffer;
+	uint16_t msg_type;
+	uint32_t offset;
+	uint64_t pos;
+	bool recovered;
+
+	while (agent_spool.unread_cnt &&
+	       (list_count(agent_list) < DBD_AGENT_WINDOW)) {
+		pos = agent_spool.read + agent_spool.shift;
+		rec = _spool_rec(agent_spool.read);
+		agent_spool.read += _spool_rec_len(rec->size);
+		if (rec->magic == DBD_SPOOL_DEAD)
+			continue;
+		agent_spool.unread_cnt--;
+		if ((recovered = (agent_spool.recover_cnt != 0)))
+			agent_spool.recover_cnt--;
+
+		buffer = init_buf(rec->size);
+		memcpy(get_buf_data(buffer), rec + 1, rec->size);
+		set_buf_offset(buffer, rec->size);
+		if (recovered && (rec->rpc_version != SLURM_PROTOCOL_VERSION) &&
+		    !(buffer = _repack_dbd_rec(buffer, rec->rpc_version)))
+			continue;
+
+		offset = get_buf_offset(buffer);
+		set_buf_offset(buffer, 0);
+		(void) unpack16(&msg_type, buffer);
+		set_buf_offset(buffer, offset);
+		/* Registrations are not resent, see _save_dbd_state() */
+		if (recovered && (msg_type == DBD_REGISTER_CTLD)) {
+			free_buf(buffer);
+			continue;
+		}
+
+		msg = _make_agent_msg(buffer, msg_type);
+		if (!recovered)
+			msg->queue_time = rec->queue_time;
+		msg->spool_seq = rec->seq;
+		msg->spool_pos = pos;
+		if (!list_enqueue(agent_list, msg))
+			fatal("slurmdbd: list_enqueue, no memory");
+	}
+}
+
+static int _find_spooled_msg(void *x, void *key)
+{
+	return (((dbd_agent_msg_t *) x)->spool_seq != 0);
+}
+
+/*
+ * Release the records of messages which left the agent queue, those ahead
+ * of the first spooled message in agent_list. An empty spool starts over
+ * at the start of the file. agent_lock must be held with no message in
+ * flight.
+ */
+static void _spool_release(void)
+{
+	dbd_spool_hdr_t *hdr = agent_spool.hdr;
+	dbd_agent_msg_t *msg;
+	dbd_spool_rec_t *rec;
+	uint64_t seq;
+
+	if (!hdr || !agent_list)
+		return;
+
+	msg = list_find_first(agent_list, _find_spooled_msg, NULL);
+	seq = msg ? msg->spool_seq : agent_spool.seq;
+	while (hdr->head < agent_spool.read) {
+		rec = _spool_rec(hdr->head);
+		if (rec->seq >= seq)
+			break;
+		hdr->head += _spool_rec_len(rec->size);
+	}
+
+	if (hdr->head == hdr->tail) {
+		agent_spool.shift += hdr->tail - sizeof(dbd_spool_hdr_t);
+		hdr->head = hdr->tail = sizeof(dbd_spool_hdr_t);
+		agent_spool.read = hdr->head;
+		if (hdr->size > DBD_SPOOL_MIN_SIZE)
+			(void) _spool_resize(DBD_SPOOL_MIN_SIZE);
+	}
+}
+
 static void _create_agent(void)
 {
 	/* this needs to be set because the agent thread will do
@@ -1882,8 +2678,9 @@ static void _create_agent(void)
 	slurmdbd_shutdown = 0;
 
 	if (agent_list == NULL) {
-		agent_list = list_create(slurmdbd_free_buffer);
+		agent_list = list_create(_free_agent_msg);
 		_load_dbd_state();
+		_spool_open();
 	}
 
 	if (agent_tid == 0) {
@@ -1934,17 +2731,11 @@ unpack_error:
 
 static void *_agent(void *x)
 {
-	int cnt, rc;
-	Buf buffer;
+	int cnt, rc, batch_cnt;
 	struct timespec abs_time;
 	static time_t fail_time = 0;
 	int sigarray[] = {SIGUSR1, 0};
-	slurmdbd_msg_t list_req;
-	dbd_list_msg_t list_msg;
-
-	list_req.msg_type = DBD_SEND_MULT_MSG;
-	list_req.data = &list_msg;
-	memset(&list_msg, 0, sizeof(dbd_list_msg_t));
+	dbd_agent_batch_t batches[DBD_AGENT_PIPELINE];
 	/* DEF_TIMERS; */
 
 	/* Prepare to catch SIGUSR1 to interrupt pending
@@ -1967,6 +2758,7 @@ static void *_agent(void *x)
 		}
 
 		slurm_mutex_lock(&agent_lock);
+		_spool_read();
 		if (agent_list && slurmdbd_conn->fd)
 			cnt = list_count(agent_list);
 		else
@@ -1982,66 +2774,18 @@ static void *_agent(void *x)
 			continue;
 		} else if ((cnt > 0) && ((cnt % 100) == 0))
 			info("slurmdbd: agent queue size %u", cnt);
-		/* Leave item on the queue until processing complete */
-		if (agent_list) {
-			int handle_agent_count = 1000;
-			if (cnt > handle_agent_count) {
-				int agent_count = 0;
-				ListIterator agent_itr =
-					list_iterator_create(agent_list);
-				list_msg.my_list = list_create(NULL);
-				while ((buffer = list_next(agent_itr))) {
-					list_enqueue(list_msg.my_list, buffer);
-					agent_count++;
-					if (agent_count > handle_agent_count)
-						break;
-				}
-				list_iterator_destroy(agent_itr);
-				buffer = pack_slurmdbd_msg(
-					&list_req, SLURM_PROTOCOL_VERSION);
-			} else if (cnt > 1) {
-				list_msg.my_list = agent_list;
-				buffer = pack_slurmdbd_msg(
-					&list_req, SLURM_PROTOCOL_VERSION);
-			} else
-				buffer = (Buf) list_peek(agent_list);
-		} else
-			buffer = NULL;
+		/*
+		 * Messages being sent are taken off the queue, so they can
+		 * not be purged meanwhile, and put back at its head unless
+		 * acknowledged.
+		 */
+		batch_cnt = _take_agent_batches(batches);
 		slurm_mutex_unlock(&agent_lock);
-		if (buffer == NULL) {
-			slurm_mutex_unlock(&slurmdbd_lock);
-
-			slurm_mutex_lock(&assoc_cache_mutex);
-			if (slurmdbd_conn->fd >= 0 && running_cache)
-				slurm_cond_signal(&assoc_cache_cond);
-			slurm_mutex_unlock(&assoc_cache_mutex);
-
-			continue;
-		}
 
 		/* NOTE: agent_lock is clear here, so we can add more
 		 * requests to the queue while waiting for this RPC to
 		 * complete. */
-		rc = slurm_persist_send_msg(slurmdbd_conn, buffer);
-		if (rc != SLURM_SUCCESS) {
-			if (*slurmdbd_conn->shutdown) {
-				slurm_mutex_unlock(&slurmdbd_lock);
-				break;
-			}
-			error("slurmdbd: Failure sending message: %d: %m", rc);
-		} else if (list_msg.my_list) {
-			rc = _handle_mult_rc_ret();
-		} else {
-			rc = _get_return_code();
-			if (rc == EAGAIN) {
-				if (*slurmdbd_conn->shutdown) {
-					slurm_mutex_unlock(&slurmdbd_lock);
-					break;
-				}
-				error("slurmdbd: Failure with "
-				      "message need to resend: %d: %m", rc);
-			}
-		}
+		rc = _send_agent_batches(batches, batch_cnt);
 		slurm_mutex_unlock(&slurmdbd_lock);
 		slurm_mutex_lock(&assoc_cache_mutex);
 		if (slurmdbd_conn->fd >= 0 && running_cache)
@@ -2049,32 +2793,12 @@ static void *_agent(void *x)
 		slurm_mutex_unlock(&assoc_cache_mutex);
 
 		slurm_mutex_lock(&agent_lock);
-		if (agent_list && (rc == SLURM_SUCCESS)) {
-			/*
-			 * If we sent a mult_msg we just need to free buffer,
-			 * we don't need to requeue, just mark list_msg.my_list
-			 * as NULL as that is the sign we sent a mult_msg.
-			 */
-			if (list_msg.my_list) {
-				if (list_msg.my_list != agent_list)
-					FREE_NULL_LIST(list_msg.my_list);
-				list_msg.my_list = NULL;
-			} else
-				buffer = (Buf) list_dequeue(agent_list);
-
-			free_buf(buffer);
+		_requeue_agent_batches(batches, batch_cnt);
+		_spool_release();
+		if (rc == SLURM_SUCCESS)
 			fail_time = 0;
-		} else {
-			/* We need to free a mult_msg even on failure */
-			if (list_msg.my_list) {
-				if (list_msg.my_list != agent_list)
-					FREE_NULL_LIST(list_msg.my_list);
-				list_msg.my_list = NULL;
-				free_buf(buffer);
-			}
-
+		else if (!*slurmdbd_conn->shutdown)
 			fail_time = time(NULL);
-		}
 		slurm_mutex_unlock(&agent_lock);
 		/* END_TIMER; */
 		/* info("at the end with %s", TIME_STR); */
@@ -2090,8 +2814,10 @@ static void *_agent(void *x)
 	}
 
 	slurm_mutex_lock(&agent_lock);
+	_spool_close();
 	_save_dbd_state();
 	FREE_NULL_LIST(agent_list);
+	xhash_free(agent_job_hash);
 	slurm_mutex_unlock(&agent_lock);
 	return NULL;
 }
@@ -2100,9 +2826,8 @@ static void _save_dbd_state(void)
 {
 	char *dbd_fname;
 	Buf buffer;
+	dbd_agent_msg_t *msg;
 	int fd, rc, wrote = 0;
-	uint16_t msg_type;
-	uint32_t offset;
 
 	dbd_fname = slurm_get_state_save_location();
 	xstrcat(dbd_fname, "/dbd.messages");
@@ -2121,28 +2846,24 @@ static void _save_dbd_state(void)
 		if (rc != SLURM_SUCCESS)
 			goto end_it;
 
-		while ((buffer = list_dequeue(agent_list))) {
+		xhash_clear(agent_job_hash);
+		while ((msg = list_dequeue(agent_list))) {
 			/*
 			 * We do not want to store registration messages. If an
 			 * admin puts in an incorrect cluster name we can get a
 			 * deadlock unless they add the bogus cluster name to
-			 * the accounting system.
+			 * the accounting system. Spooled messages are
+			 * recovered from the spool file.
 			 */
-			offset = get_buf_offset(buffer);
-			if (offset < 2) {
-				free_buf(buffer);
-				continue;
-			}
-			set_buf_offset(buffer, 0);
-			(void) unpack16(&msg_type, buffer);  /* checked by offset */
-			set_buf_offset(buffer, offset);
-			if (msg_type == DBD_REGISTER_CTLD) {
-				free_buf(buffer);
+			if ((get_buf_offset(msg->buffer) < 2) ||
+			    (msg->msg_type == DBD_REGISTER_CTLD) ||
+			    msg->spool_seq) {
+				_free_agent_msg(msg);
 				continue;
 			}
 
-			rc = _save_dbd_rec(fd, buffer);
-			free_buf(buffer);
+			rc = _save_dbd_rec(fd, msg->buffer);
+			_free_agent_msg(msg);
 			if (rc != SLURM_SUCCESS)
 				break;
 			wrote++;
@@ -2157,12 +2878,35 @@ end_it:
 	xfree(dbd_fname);
 }
 
+/*
+ * Unpack and repack a saved message with the current protocol version just
+ * so we keep things up to date. buffer is freed.
+ * RET the new buffer or NULL on error
+ */
+static Buf _repack_dbd_rec(Buf buffer, uint16_t rpc_version)
+{
+	slurmdbd_msg_t msg;
+	int rc;
+
+	set_buf_offset(buffer, 0);
+	rc = unpack_slurmdbd_msg(&msg, rpc_version, buffer);
+	free_buf(buffer);
+	if (rc != SLURM_SUCCESS)
+		return NULL;
+
+	buffer = pack_slurmdbd_msg(&msg, SLURM_PROTOCOL_VERSION);
+	slurmdbd_free_msg(&msg);
+
+	return buffer;
+}
+
 static void _load_dbd_state(void)
 {
 	char *dbd_fname;
 	Buf buffer;
 	int fd, recovered = 0;
-	uint16_t rpc_version = 0;
+	uint16_t rpc_version = 0, msg_type;
+	uint32_t offset;
 
 	dbd_fname = slurm_get_state_save_location();
 	xstrcat(dbd_fname, "/dbd.messages");
@@ -2196,6 +2940,11 @@ static void _load_dbd_state(void)
 			xfree(ver_str);
 		}
 
+		/*
+		 * Recovered messages are queued after any already queued,
+		 * which must not be merged with later ones any more.
+		 */
+		xhash_clear(agent_job_hash);
 		while (1) {
 			/* If the buffer was not the VER%d string it
 			   was an actual message so we don't want to
@@ -2205,28 +2954,23 @@ static void _load_dbd_state(void)
 				buffer = _load_dbd_rec(fd);
 			if (buffer == NULL)
 				break;
-			if (rpc_version != SLURM_PROTOCOL_VERSION) {
-				/* unpack and repack with new
-				 * PROTOCOL_VERSION just so we keep
-				 * things up to date.
-				 */
-				slurmdbd_msg_t msg;
-				int rc;
-				set_buf_offset(buffer, 0);
-				rc = unpack_slurmdbd_msg(
-					&msg, rpc_version, buffer);
-				free_buf(buffer);
-				if (rc == SLURM_SUCCESS)
-					buffer = pack_slurmdbd_msg(
-						&msg, SLURM_PROTOCOL_VERSION);
-				else
-					buffer = NULL;
-			}
+			if (rpc_version != SLURM_PROTOCOL_VERSION)
+				buffer = _repack_dbd_rec(buffer, rpc_version);
 			if (!buffer) {
 				error("no buffer given");
 				continue;
 			}
-			if (!list_enqueue(agent_list, buffer))
+			offset = get_buf_offset(buffer);
+			if (offset < 2) {
+				free_buf(buffer);
+				buffer = NULL;
+				continue;
+			}
+			set_buf_offset(buffer, 0);
+			(void) unpack16(&msg_type, buffer); /* checked above */
+			set_buf_offset(buffer, offset);
+			if (!list_enqueue(agent_list,
+					  _make_agent_msg(buffer, msg_type)))
 				fatal("slurmdbd: list_enqueue, no memory");
 			recovered++;
 			buffer = NULL;
@@ -2336,21 +3080,14 @@ static int _purge_step_req(void)
 {
 	int purged = 0;
 	ListIterator iter;
-	uint16_t msg_type;
-	uint32_t offset;
-	Buf buffer;
+	dbd_agent_msg_t *msg;
 
 	iter = list_iterator_create(agent_list);
-	while ((buffer = list_next(iter))) {
-		offset = get_buf_offset(buffer);
-		if (offset < 2)
-			continue;
-		set_buf_offset(buffer, 0);
-		(void) unpack16(&msg_type, buffer);	/* checked by offset */
-		set_buf_offset(buffer, offset);
-		if ((msg_type == DBD_STEP_START) ||
-		    (msg_type == DBD_STEP_COMPLETE)) {
-			list_remove(iter);
+	while ((msg = list_next(iter))) {
+		if ((msg->msg_type == DBD_STEP_START) ||
+		    (msg->msg_type == DBD_STEP_COMPLETE)) {
+			_unindex_agent_msg(msg);
+			list_delete_item(iter);
 			purged++;
 		}
 	}
@@ -2365,20 +3102,13 @@ static int _purge_job_start_req(void)
 {
 	int purged = 0;
 	ListIterator iter;
-	uint16_t msg_type;
-	uint32_t offset;
-	Buf buffer;
+	dbd_agent_msg_t *msg;
 
 	iter = list_iterator_create(agent_list);
-	while ((buffer = list_next(iter))) {
-		offset = get_buf_offset(buffer);
-		if (offset < 2)
-			continue;
-		set_buf_offset(buffer, 0);
-		(void) unpack16(&msg_type, buffer);	/* checked by offset */
-		set_buf_offset(buffer, offset);
-		if (msg_type == DBD_JOB_START) {
-			list_remove(iter);
+	while ((msg = list_next(iter))) {
+		if (msg->msg_type == DBD_JOB_START) {
+			_unindex_agent_msg(msg);
+			list_delete_item(iter);
 			purged++;
 		}
 	}
@@ -3655,7 +4385,7 @@ extern void slurmdbd_pack_list_msg(dbd_list_msg_t *msg,
 		itr = list_iterator_create(msg->my_list);
 		while ((object = list_next(itr))) {
 			(*(my_function))(object, rpc_version, buffer);
-			if (size_buf(buffer) > REASONABLE_BUF_SIZE) {
+			if (get_buf_offset(buffer) > REASONABLE_BUF_SIZE) {
 				error("%s: size limit exceeded", __func__);
 				/* rewind buffer, pack NO_VAL as count instead */
 				set_buf_offset(buffer, header_position);
@@ -4319,7 +5049,27 @@ unpack_error:
 
 extern int slurmdbd_agent_queue_count()
 {
-	if (!agent_list)
-		return 0;
-	return list_count(agent_list);
+	int cnt = 0;
+
+	slurm_mutex_lock(&agent_lock);
+	if (agent_list)
+		cnt = list_count(agent_list) + agent_inflight +
+		      agent_spool.unread_cnt;
+	slurm_mutex_unlock(&agent_lock);
+
+	return cnt;
+}
+
+extern void slurmdbd_agent_get_stats(slurmdbd_agent_stats_t *stats)
+{
+	slurm_mutex_lock(&agent_lock);
+	memcpy(stats, &agent_stats, sizeof(slurmdbd_agent_stats_t));
+	slurm_mutex_unlock(&agent_lock);
+}
+
+extern void slurmdbd_agent_reset_stats(void)
+{
+	slurm_mutex_lock(&agent_lock);
+	memset(&agent_stats, 0, sizeof(slurmdbd_agent_stats_t));
+	slurm_mutex_unlock(&agent_lock);
 }
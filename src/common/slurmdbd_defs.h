@@ -602,4 +602,24 @@ extern int slurmdbd_unpack_buffer(void **in,
 				  Buf buffer);
 
 extern int slurmdbd_agent_queue_count();
+
+/*
+ * Latency histogram buckets of the slurmdbd agent, one per decade of
+ * milliseconds: <10ms, <100ms, <1s, <10s, <100s, >=100s
+ */
+#define DBD_AGENT_HIST_CNT	6
+
+/* Statistics of the slurmdbd agent since the last reset */
+typedef struct {
+	uint32_t queue_max;	/* highest count of queued messages */
+	uint64_t sent_cnt;	/* messages acknowledged by the SlurmDBD */
+	uint64_t batch_cnt;	/* DBD_SEND_MULT_MSG sent */
+	uint64_t coalesced_cnt;	/* job start messages merged into one queued */
+	uint64_t latency_time;	/* usec from queueing to acknowledgment */
+	uint64_t latency_max;
+	uint32_t latency_hist[DBD_AGENT_HIST_CNT];
+} slurmdbd_agent_stats_t;
+
+extern void slurmdbd_agent_get_stats(slurmdbd_agent_stats_t *stats);
+extern void slurmdbd_agent_reset_stats(void);
 #endif	/* !_SLURMDBD_DEFS_H */
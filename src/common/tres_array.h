@@ -0,0 +1,136 @@
+/*****************************************************************************\
+ *  tres_array.h - arithmetic on arrays of TRES counts
+ *****************************************************************************
+ *  Copyright (C) 2018 SchedMD LLC.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _SLURM_TRES_ARRAY_H
+#define _SLURM_TRES_ARRAY_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#include "slurm/slurm.h"
+
+/*
+ * Operations on the uint64_t arrays of TRES counts, usage and limits indexed
+ * by TRES position (tres_cnt elements). Limits of INFINITE64 are not set.
+ *
+ * These are inline so they cost no more than the loops they replace in the
+ * usage and limit code, where arrays are short and the calls frequent.
+ * Arrays passed to one call must not overlap.
+ */
+
+/* dst[i] += src[i] */
+static inline void tres_array_add(uint64_t *restrict dst,
+				  const uint64_t *restrict src, int cnt)
+{
+	int i;
+
+	for (i = 0; i < cnt; i++)
+		dst[i] += src[i];
+}
+
+/*
+ * dst[i] += src[i] * mult
+ * With a zeroed dst this sets dst to src scaled by mult.
+ */
+static inline void tres_array_add_scaled(uint64_t *restrict dst,
+					 const uint64_t *restrict src,
+					 uint64_t mult, int cnt)
+{
+	int i;
+
+	for (i = 0; i < cnt; i++)
+		dst[i] += src[i] * mult;
+}
+
+/*
+ * dst[i] -= src[i], elements that would underflow are set to zero
+ * RET true if any element underflowed
+ */
+static inline bool tres_array_sub(uint64_t *restrict dst,
+				  const uint64_t *restrict src, int cnt)
+{
+	bool underflow = false;
+	int i;
+
+	for (i = 0; i < cnt; i++) {
+		if (src[i] > dst[i]) {
+			dst[i] = 0;
+			underflow = true;
+		} else
+			dst[i] -= src[i];
+	}
+
+	return underflow;
+}
+
+/*
+ * Find a count exceeding its limit
+ * IN val - counts to test
+ * IN add - optional counts added to val before testing, may be NULL
+ * IN limit - limits, INFINITE64 for none
+ * RET position of the first element with val[i] + add[i] > limit[i] or -1
+ */
+static inline int tres_array_exceeds(const uint64_t *restrict val,
+				     const uint64_t *restrict add,
+				     const uint64_t *restrict limit, int cnt)
+{
+	int i;
+
+	for (i = 0; i < cnt; i++) {
+		if (limit[i] == INFINITE64)
+			continue;
+		/* Written not to overflow on val[i] + add[i] */
+		if ((val[i] > limit[i]) ||
+		    (add && (add[i] > (limit[i] - val[i]))))
+			return i;
+	}
+
+	return -1;
+}
+
+/* RET position of the first limit that is not INFINITE64 or -1 if none */
+static inline int tres_array_first_limit(const uint64_t *limit, int cnt)
+{
+	int i;
+
+	for (i = 0; i < cnt; i++) {
+		if (limit[i] != INFINITE64)
+			return i;
+	}
+
+	return -1;
+}
+
+#endif /* !_SLURM_TRES_ARRAY_H */
@@ -0,0 +1,251 @@
+/*****************************************************************************\
+ *  vector.c - growable array of fixed size elements
+ *****************************************************************************
+ *  Copyright (C) 2018 SchedMD LLC.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include "config.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "src/common/log.h"
+#include "src/common/macros.h"
+#include "src/common/vector.h"
+#include "src/common/xmalloc.h"
+
+#define VECTOR_MIN_SIZE		16
+/* Fewer elements than this per thread are not worth starting a thread for */
+#define VECTOR_MIN_PER_THREAD	1024
+
+typedef struct {
+	vector_t *vec;
+	VectorForF f;
+	void *arg;
+	uint32_t begin;
+	uint32_t end;
+} vector_range_t;
+
+typedef struct {
+	vector_t *vec;
+	VectorForF f;
+	void *arg;
+	pthread_mutex_t mutex;
+	uint32_t next;		/* next element to hand out */
+} vector_queue_t;
+
+extern vector_t *vector_create(size_t elem_size, uint32_t size)
+{
+	vector_t *vec = xmalloc(sizeof(vector_t));
+
+	xassert(elem_size);
+
+	vec->elem_size = elem_size;
+	if (size) {
+		vec->size = size;
+		vec->data = xmalloc_nz(elem_size * size);
+	}
+
+	return vec;
+}
+
+extern void vector_destroy(vector_t *vec)
+{
+	if (!vec)
+		return;
+
+	xfree(vec->data);
+	xfree(vec);
+}
+
+extern void *vector_append(vector_t *vec)
+{
+	void *elem;
+
+	if (vec->count == vec->size) {
+		vec->size = MAX(vec->size * 2, VECTOR_MIN_SIZE);
+		xrealloc_nz(vec->data, vec->elem_size * vec->size);
+	}
+
+	elem = (char *) vec->data + (vec->count * vec->elem_size);
+	memset(elem, 0, vec->elem_size);
+	vec->count++;
+
+	return elem;
+}
+
+extern void vector_sort(vector_t *vec,
+			int (*cmp) (const void *x, const void *y))
+{
+	if (vec->count > 1)
+		qsort(vec->data, vec->count, vec->elem_size, cmp);
+}
+
+extern uint32_t vector_delete_all(vector_t *vec, VectorFindF f, void *key)
+{
+	char *src = vec->data, *dst = vec->data;
+	uint32_t i, kept = 0, removed;
+
+	for (i = 0; i < vec->count; i++, src += vec->elem_size) {
+		if (f(src, key))
+			continue;
+		if (dst != src)
+			memcpy(dst, src, vec->elem_size);
+		dst += vec->elem_size;
+		kept++;
+	}
+
+	removed = vec->count - kept;
+	vec->count = kept;
+
+	return removed;
+}
+
+extern int vector_for_each(vector_t *vec, VectorForF f, void *arg)
+{
+	char *elem = vec->data;
+	uint32_t i;
+
+	for (i = 0; i < vec->count; i++, elem += vec->elem_size) {
+		if (f(elem, arg) < 0)
+			return -((int) i + 1);
+	}
+
+	return (int) i;
+}
+
+static void *_for_each_range(void *x)
+{
+	vector_range_t *range = x;
+	char *elem = vector_get(range->vec, range->begin);
+	uint32_t i;
+
+	for (i = range->begin; i < range->end; i++) {
+		(void) range->f(elem, range->arg);
+		elem += range->vec->elem_size;
+	}
+
+	return NULL;
+}
+
+extern void vector_for_each_parallel(vector_t *vec, VectorForF f, void *arg,
+				     int thread_cnt)
+{
+	vector_range_t *ranges;
+	pthread_t *threads;
+	uint32_t per_thread;
+	int i;
+
+	if (!vec->count)
+		return;
+
+	thread_cnt = MIN(thread_cnt,
+			 (vec->count + VECTOR_MIN_PER_THREAD - 1) /
+			 VECTOR_MIN_PER_THREAD);
+	if (thread_cnt <= 1) {
+		(void) vector_for_each(vec, f, arg);
+		return;
+	}
+
+	ranges = xmalloc(sizeof(vector_range_t) * thread_cnt);
+	threads = xmalloc(sizeof(pthread_t) * thread_cnt);
+	per_thread = (vec->count + thread_cnt - 1) / thread_cnt;
+	for (i = 0; i < thread_cnt; i++) {
+		ranges[i].vec = vec;
+		ranges[i].f = f;
+		ranges[i].arg = arg;
+		ranges[i].begin = MIN(i * per_thread, vec->count);
+		ranges[i].end = MIN((i + 1) * per_thread, vec->count);
+	}
+
+	for (i = 1; i < thread_cnt; i++) {
+		if (ranges[i].begin < ranges[i].end)
+			slurm_thread_create(&threads[i], _for_each_range,
+					    &ranges[i]);
+	}
+	_for_each_range(&ranges[0]);
+	for (i = 1; i < thread_cnt; i++) {
+		if (ranges[i].begin < ranges[i].end)
+			pthread_join(threads[i], NULL);
+	}
+
+	xfree(ranges);
+	xfree(threads);
+}
+
+static void *_for_each_queued(void *x)
+{
+	vector_queue_t *queue = x;
+	uint32_t i;
+
+	while (1) {
+		slurm_mutex_lock(&queue->mutex);
+		i = queue->next++;
+		slurm_mutex_unlock(&queue->mutex);
+		if (i >= queue->vec->count)
+			break;
+		(void) queue->f(vector_get(queue->vec, i), queue->arg);
+	}
+
+	return NULL;
+}
+
+extern void vector_for_each_balanced(vector_t *vec, VectorForF f, void *arg,
+				     int thread_cnt)
+{
+	vector_queue_t queue;
+	pthread_t *threads;
+	int i;
+
+	thread_cnt = MIN(thread_cnt, vec->count);
+	if (thread_cnt <= 1) {
+		(void) vector_for_each(vec, f, arg);
+		return;
+	}
+
+	queue.vec = vec;
+	queue.f = f;
+	queue.arg = arg;
+	queue.next = 0;
+	slurm_mutex_init(&queue.mutex);
+
+	threads = xmalloc(sizeof(pthread_t) * thread_cnt);
+	for (i = 1; i < thread_cnt; i++)
+		slurm_thread_create(&threads[i], _for_each_queued, &queue);
+	_for_each_queued(&queue);
+	for (i = 1; i < thread_cnt; i++)
+		pthread_join(threads[i], NULL);
+
+	slurm_mutex_destroy(&queue.mutex);
+	xfree(threads);
+}
@@ -0,0 +1,150 @@
+/*****************************************************************************\
+ *  vector.h - growable array of fixed size elements
+ *****************************************************************************
+ *  Copyright (C) 2018 SchedMD LLC.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _SLURM_VECTOR_H
+#define _SLURM_VECTOR_H
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#include "src/common/xassert.h"
+
+/*
+ * A vector keeps its elements by value in one contiguous array, so walking
+ * or sorting it does not chase pointers the way a List does. Element
+ * addresses change when the vector grows, is sorted or has elements
+ * deleted, so callers must not keep them across those operations.
+ * Like a List, a vector is not locked; callers provide any locking.
+ */
+typedef struct {
+	void *data;		/* elements, elem_size bytes each */
+	size_t elem_size;
+	uint32_t count;		/* elements in use */
+	uint32_t size;		/* elements allocated */
+} vector_t;
+
+/*
+ * Function prototype to test an element. Returns non-zero if the element
+ * matches, zero otherwise. Same as ListFindF.
+ */
+typedef int (*VectorFindF) (void *x, void *key);
+
+/*
+ * Function prototype to operate on each element. Returns a negative value
+ * to stop vector_for_each(). Same as ListForF.
+ */
+typedef int (*VectorForF) (void *x, void *arg);
+
+/*
+ * vector_create - create an empty vector
+ * IN elem_size - size of each element in bytes
+ * IN size - number of elements to allocate space for initially, may be zero
+ * RET new vector, free with vector_destroy()
+ */
+extern vector_t *vector_create(size_t elem_size, uint32_t size);
+
+/*
+ * vector_destroy - free a vector and its elements
+ */
+extern void vector_destroy(vector_t *vec);
+
+#define FREE_NULL_VECTOR(_X)			\
+	do {					\
+		if (_X)				\
+			vector_destroy(_X);	\
+		_X = NULL;			\
+	} while (0)
+
+/* Return the number of elements in a vector */
+static inline uint32_t vector_count(vector_t *vec)
+{
+	return vec->count;
+}
+
+/* Return the address of element inx of a vector */
+static inline void *vector_get(vector_t *vec, uint32_t inx)
+{
+	xassert(inx < vec->count);
+	return (char *) vec->data + (inx * vec->elem_size);
+}
+
+/*
+ * vector_append - add a zeroed element at the end of a vector
+ * RET address of the new element, valid until the vector is next changed
+ */
+extern void *vector_append(vector_t *vec);
+
+/*
+ * vector_sort - sort a vector in place
+ * IN cmp - qsort() comparison function, called with element addresses
+ */
+extern void vector_sort(vector_t *vec,
+			int (*cmp) (const void *x, const void *y));
+
+/*
+ * vector_delete_all - remove the elements matched by f, keeping the order of
+ *	the others
+ * IN f - called with each element's address and key
+ * RET number of elements removed
+ */
+extern uint32_t vector_delete_all(vector_t *vec, VectorFindF f, void *key);
+
+/*
+ * vector_for_each - call f for each element in order, stopping if f returns
+ *	a negative value
+ * RET number of elements f was called for, negated if it was stopped
+ */
+extern int vector_for_each(vector_t *vec, VectorForF f, void *arg);
+
+/*
+ * vector_for_each_parallel - call f for every element, splitting the vector
+ *	into contiguous ranges handled by up to thread_cnt threads. The calling
+ *	thread handles the first range. f must be safe to call concurrently
+ *	and its return value is ignored.
+ */
+extern void vector_for_each_parallel(vector_t *vec, VectorForF f, void *arg,
+				     int thread_cnt);
+
+/*
+ * vector_for_each_balanced - call f for every element using up to thread_cnt
+ *	threads, which take one element at a time. Use this rather than
+ *	vector_for_each_parallel() for a few elements of uneven cost. The
+ *	calling thread takes part. f must be safe to call concurrently and its
+ *	return value is ignored.
+ */
+extern void vector_for_each_balanced(vector_t *vec, VectorForF f, void *arg,
+				     int thread_cnt);
+
+#endif /* !_SLURM_VECTOR_H */
@@ -39,8 +39,11 @@
  *  Copyright (C) 2002 The Regents of the University of California.
 \*****************************************************************************/
 
+#include <errno.h>
 #include <fcntl.h>
 #include <signal.h>
+#include <unistd.h>
+
 #include "src/common/slurm_xlator.h"
 #include "src/common/slurm_protocol_api.h"
 #include "src/common/slurm_protocol_defs.h"
@@ -98,33 +101,31 @@ const uint32_t plugin_version = SLURM_VERSION_NUMBER;
 
 /* Other useful declarations */
 static slurm_cgroup_conf_t slurm_cgroup_conf;
+static List poll_task_list = NULL;	/* task_list of the current poll */
 
-static void _prec_extra(jag_prec_t *prec)
+/*
+ * Fill prec with the usage of the cgroup of task taskid
+ * RET SLURM_SUCCESS if the cpu usage could be read
+ */
+static int _get_task_cgroup_data(uint32_t taskid, jag_prec_t *prec)
 {
 	unsigned long utime, stime, total_rss, total_pgpgin;
-	char *cpu_time = NULL, *memory_stat = NULL, *ptr;
-	size_t cpu_time_size = 0, memory_stat_size = 0;
-
-	//DEF_TIMERS;
-	//START_TIMER;
-	/* info("before"); */
-	/* print_jag_prec(prec); */
-	xcgroup_get_param(&task_cpuacct_cg, "cpuacct.stat",
-			  &cpu_time, &cpu_time_size);
-	if (cpu_time == NULL) {
-		debug2("%s: failed to collect cpuacct.stat pid %d ppid %d",
-		       __func__, prec->pid, prec->ppid);
-	} else {
-		sscanf(cpu_time, "%*s %lu %*s %lu", &utime, &stime);
-		prec->usec = utime;
-		prec->ssec = stime;
+	char sbuf[4096], *ptr;
+
+	if ((jobacct_cgroup_task_file_read(&task_cpuacct_files, taskid,
+					   sbuf, sizeof(sbuf)) <= 0) ||
+	    (sscanf(sbuf, "%*s %lu %*s %lu", &utime, &stime) != 2)) {
+		debug2("%s: failed to collect cpuacct.stat task %u pid %d",
+		       __func__, taskid, prec->pid);
+		return SLURM_ERROR;
 	}
+	prec->usec = utime;
+	prec->ssec = stime;
 
-	xcgroup_get_param(&task_memory_cg, "memory.stat",
-			  &memory_stat, &memory_stat_size);
-	if (memory_stat == NULL) {
-		debug2("%s: failed to collect memory.stat  pid %d ppid %d",
-		       __func__, prec->pid, prec->ppid);
+	if (jobacct_cgroup_task_file_read(&task_memory_files, taskid,
+					  sbuf, sizeof(sbuf)) <= 0) {
+		debug2("%s: failed to collect memory.stat task %u pid %d",
+		       __func__, taskid, prec->pid);
 	} else {
 		/*
 		 * This number represents the amount of "dirty" private memory
@@ -132,7 +133,7 @@ static void _prec_extra(jag_prec_t *prec)
 		 * different than what proc presents, but is probably more
 		 * accurate on what the user is actually using.
 		 */
-		if ((ptr = strstr(memory_stat, "total_rss"))) {
+		if ((ptr = strstr(sbuf, "total_rss "))) {
 			sscanf(ptr, "total_rss %lu", &total_rss);
 			prec->rss = total_rss / 1024; /* bytes to KB */
 		}
@@ -141,15 +142,12 @@ static void _prec_extra(jag_prec_t *prec)
 		 * total_pgmajfault is what is reported in proc, so we use
 		 * the same thing here.
 		 */
-		if ((ptr = strstr(memory_stat, "total_pgmajfault"))) {
+		if ((ptr = strstr(sbuf, "total_pgmajfault"))) {
 			sscanf(ptr, "total_pgmajfault %lu", &total_pgpgin);
 			prec->pages = total_pgpgin;
 		}
 	}
 
-	xfree(cpu_time);
-	xfree(memory_stat);
-
 	/* FIXME: Enable when kernel support ready.
 	 *
 	 * "Read" and "Write" from blkio.throttle.io_service_bytes are
@@ -179,12 +177,63 @@ static void _prec_extra(jag_prec_t *prec)
 	/* prec->disk_read = (double)tot_read / (double)1048576; */
 	/* prec->disk_write = (double)tot_write / (double)1048576; */
 
-	/* info("after %d %d", total_rss); */
-	/* print_jag_prec(prec); */
-	//END_TIMER;
-	//info("took %s", TIME_STR);
-	return;
+	return SLURM_SUCCESS;
+}
+
+static int _find_task_pid(void *x, void *key)
+{
+	struct jobacctinfo *jobacct = (struct jobacctinfo *) x;
+	pid_t pid = *(pid_t *) key;
+
+	return (jobacct->pid == pid);
+}
+
+/*
+ * Only the records of the tasks themselves are used, the usage of their
+ * descendants is accounted in the task cgroup.
+ */
+static void _prec_extra(jag_prec_t *prec)
+{
+	struct jobacctinfo *jobacct;
+
+	if (!poll_task_list ||
+	    !(jobacct = list_find_first(poll_task_list, _find_task_pid,
+					&prec->pid)))
+		return;
+
+	(void) _get_task_cgroup_data(jobacct->id.taskid, prec);
+}
+
+/*
+ * Build one record per task from its cgroup alone, without reading the
+ * /proc files of every process of the step. Virtual memory size, disk I/O
+ * and cpu frequency are not gathered.
+ */
+static List _get_task_precs(List task_list, bool pgid_plugin,
+			    uint64_t cont_id, jag_callbacks_t *callbacks)
+{
+	List prec_list = list_create(destroy_jag_prec);
+	ListIterator itr;
+	struct jobacctinfo *jobacct;
+	jag_prec_t *prec;
+
+	if (!task_list)
+		return prec_list;
+
+	itr = list_iterator_create(task_list);
+	while ((jobacct = list_next(itr))) {
+		prec = xmalloc(sizeof(jag_prec_t));
+		prec->pid = jobacct->pid;
+		if (_get_task_cgroup_data(jobacct->id.taskid, prec) !=
+		    SLURM_SUCCESS) {
+			xfree(prec);
+			continue;
+		}
+		list_append(prec_list, prec);
+	}
+	list_iterator_destroy(itr);
 
+	return prec_list;
 }
 
 static bool _run_in_daemon(void)
@@ -292,13 +341,21 @@ extern void jobacct_gather_p_poll_data(
 	static bool first = 1;
 
 	if (first) {
+		char *acct_params = slurm_get_jobacct_gather_params();
+
 		memset(&callbacks, 0, sizeof(jag_callbacks_t));
 		first = 0;
-		callbacks.prec_extra = _prec_extra;
+		if (acct_params && xstrcasestr(acct_params, "CgroupStatsOnly"))
+			callbacks.get_precs = _get_task_precs;
+		else
+			callbacks.prec_extra = _prec_extra;
+		xfree(acct_params);
 	}
 
+	poll_task_list = task_list;
 	jag_common_poll_data(task_list, pgid_plugin, cont_id, &callbacks,
 			     profile);
+	poll_task_list = NULL;
 
 	return;
 }
@@ -363,3 +420,60 @@ extern char* jobacct_cgroup_create_slurm_cg(xcgroup_ns_t* ns)
 	return pre;
 }
 
+extern void jobacct_cgroup_task_file_open(jobacct_cgroup_task_files_t *files,
+					  uint32_t taskid, xcgroup_t *cg,
+					  const char *param)
+{
+	char path[PATH_MAX];
+	uint32_t i;
+
+	if (taskid >= files->cnt) {
+		xrealloc(files->fd, sizeof(int) * (taskid + 1));
+		for (i = files->cnt; i <= taskid; i++)
+			files->fd[i] = -1;
+		files->cnt = taskid + 1;
+	}
+	if (files->fd[taskid] >= 0)
+		close(files->fd[taskid]);
+
+	if (snprintf(path, sizeof(path), "%s/%s", cg->path, param) >=
+	    sizeof(path)) {
+		files->fd[taskid] = -1;
+		return;
+	}
+	if ((files->fd[taskid] = open(path, O_RDONLY | O_CLOEXEC)) < 0)
+		debug2("%s: unable to open %s: %m", __func__, path);
+}
+
+extern int jobacct_cgroup_task_file_read(jobacct_cgroup_task_files_t *files,
+					 uint32_t taskid, char *buf,
+					 size_t size)
+{
+	ssize_t num_read;
+
+	if ((taskid >= files->cnt) || (files->fd[taskid] < 0))
+		return -1;
+
+	do {
+		num_read = pread(files->fd[taskid], buf, size - 1, 0);
+	} while ((num_read < 0) && (errno == EINTR));
+	if (num_read <= 0)
+		return -1;
+	buf[num_read] = '\0';
+
+	return num_read;
+}
+
+extern void jobacct_cgroup_task_files_close(
+	jobacct_cgroup_task_files_t *files)
+{
+	uint32_t i;
+
+	for (i = 0; i < files->cnt; i++) {
+		if (files->fd[i] >= 0)
+			close(files->fd[i]);
+	}
+	xfree(files->fd);
+	files->cnt = 0;
+}
+
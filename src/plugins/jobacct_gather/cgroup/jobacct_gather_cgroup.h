@@ -43,9 +43,18 @@
 #include "src/common/xcgroup_read_config.h"
 #include "src/slurmd/common/xcgroup.h"
 
+/* A file of each task cgroup, kept open between polls, indexed by task id */
+typedef struct {
+	int *fd;		/* -1 if not open */
+	uint32_t cnt;
+} jobacct_cgroup_task_files_t;
+
 extern xcgroup_t task_memory_cg;
 extern xcgroup_t task_cpuacct_cg;
 
+extern jobacct_cgroup_task_files_t task_memory_files;	/* memory.stat */
+extern jobacct_cgroup_task_files_t task_cpuacct_files;	/* cpuacct.stat */
+
 extern int jobacct_gather_cgroup_cpuacct_init(
 	slurm_cgroup_conf_t *slurm_cgroup_conf);
 
@@ -76,3 +85,19 @@ extern int jobacct_gather_cgroup_memory_attach_task(
 /* 	pid_t pid, jobacct_id_t *jobacct_id); */
 
 extern char* jobacct_cgroup_create_slurm_cg (xcgroup_ns_t* ns);
+
+/* Open the param file of the cgroup of task taskid */
+extern void jobacct_cgroup_task_file_open(jobacct_cgroup_task_files_t *files,
+					  uint32_t taskid, xcgroup_t *cg,
+					  const char *param);
+
+/*
+ * Read the file of task taskid into buf, NUL terminated
+ * RET bytes read, <= 0 on error
+ */
+extern int jobacct_cgroup_task_file_read(jobacct_cgroup_task_files_t *files,
+					 uint32_t taskid, char *buf,
+					 size_t size);
+
+extern void jobacct_cgroup_task_files_close(
+	jobacct_cgroup_task_files_t *files);
@@ -58,6 +58,7 @@ static xcgroup_t user_cpuacct_cg;
 static xcgroup_t job_cpuacct_cg;
 static xcgroup_t step_cpuacct_cg;
 xcgroup_t task_cpuacct_cg;
+jobacct_cgroup_task_files_t task_cpuacct_files;
 
 static uint32_t max_task_id;
 
@@ -93,6 +94,8 @@ jobacct_gather_cgroup_cpuacct_fini(slurm_cgroup_conf_t *slurm_cgroup_conf)
 	    || task_cgroup_path[0] == 0)
 		return SLURM_SUCCESS;
 
+	jobacct_cgroup_task_files_close(&task_cpuacct_files);
+
 	/*
 	 * Move the slurmstepd back to the root cpuacct cg.
 	 * The release_agent will asynchroneously be called for the step
@@ -376,8 +379,11 @@ jobacct_gather_cgroup_cpuacct_attach_task(pid_t pid, jobacct_id_t *jobacct_id)
 		error("jobacct_gather/cgroup: unable to add slurmstepd to "
 		      "cpuacct cg '%s'", task_cpuacct_cg.path);
 		fstatus = SLURM_ERROR;
-	} else
+	} else {
+		jobacct_cgroup_task_file_open(&task_cpuacct_files, taskid,
+					      &task_cpuacct_cg, "cpuacct.stat");
 		fstatus = SLURM_SUCCESS;
+	}
 
 error:
 	xcgroup_unlock(&cpuacct_cg);
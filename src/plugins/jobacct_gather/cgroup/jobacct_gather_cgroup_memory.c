@@ -58,6 +58,7 @@ static xcgroup_t user_memory_cg;
 static xcgroup_t job_memory_cg;
 static xcgroup_t step_memory_cg;
 xcgroup_t task_memory_cg;
+jobacct_cgroup_task_files_t task_memory_files;
 
 static uint32_t max_task_id;
 
@@ -93,6 +94,9 @@ jobacct_gather_cgroup_memory_fini(slurm_cgroup_conf_t *slurm_cgroup_conf)
 	    || jobstep_cgroup_path[0] == '\0'
 	    || task_cgroup_path[0] == 0)
 		return SLURM_SUCCESS;
+
+	jobacct_cgroup_task_files_close(&task_memory_files);
+
 	/*
 	 * Move the slurmstepd back to the root memory cg and force empty
 	 * the step cgroup to move its allocated pages to its parent.
@@ -390,8 +394,11 @@ jobacct_gather_cgroup_memory_attach_task(pid_t pid, jobacct_id_t *jobacct_id)
 		error("jobacct_gather/cgroup: unable to add slurmstepd to "
 		      "memory cg '%s'", task_memory_cg.path);
 		fstatus = SLURM_ERROR;
-	} else
+	} else {
+		jobacct_cgroup_task_file_open(&task_memory_files, taskid,
+					      &task_memory_cg, "memory.stat");
 		fstatus = SLURM_SUCCESS;
+	}
 
 error:
 	xcgroup_unlock(&memory_cg);
@@ -39,10 +39,12 @@
 \*****************************************************************************/
 
 #include <dirent.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <signal.h>
 #include <time.h>
 #include <ctype.h>
+#include <unistd.h>
 
 #include "src/common/slurm_xlator.h"
 #include "src/common/slurm_jobacct_gather.h"
@@ -55,11 +57,30 @@
 
 #include "common_jag.h"
 
+/*
+ * Most processes tracked by proctrack live for many polls. Their /proc
+ * files are kept open between polls and read again with pread(), rather
+ * than being opened, read through stdio and closed on every poll. Past this
+ * many processes the files are opened for each poll as before, so the
+ * slurmstepd does not run out of file descriptors.
+ */
+#define MAX_CACHED_PROCS 256
+
+typedef struct {
+	pid_t pid;
+	int stat_fd;		/* /proc/<pid>/stat, -1 if not open */
+	int statm_fd;		/* /proc/<pid>/statm, -1 if not open */
+	int io_fd;		/* /proc/<pid>/io, -1 if not open */
+	int lwp;		/* _is_a_lwp() result, -1 if not known */
+	bool seen;		/* found by the current poll */
+} jag_proc_fds_t;
+
 static int cpunfo_frequency = 0;
 static long hertz = 0;
 
 static int my_pagesize = 0;
 static DIR  *slash_proc = NULL;
+static List proc_fds_list = NULL;
 static int energy_profile = ENERGY_DATA_NODE_ENERGY_UP;
 static uint64_t debug_flags = 0;
 
@@ -277,7 +298,7 @@ static int _is_a_lwp(uint32_t pid) {
 
 /* _get_process_data_line() - get line of data from /proc/<pid>/stat
  *
- * IN:	in - input file descriptor
+ * IN:	sbuf - contents of the file, modified
  * OUT:	prec - the destination for the data
  *
  * RETVAL:	==0 - no valid data
@@ -288,9 +309,9 @@ static int _is_a_lwp(uint32_t pid) {
  * embedded ')'s. Such names confuse %s (see scanf(3)), so the string is split
  * and %39c is used instead. (except for embedded ')' "(%[^)]c)" would work.
  */
-static int _get_process_data_line(int in, jag_prec_t *prec) {
-	char sbuf[512], *tmp;
-	int num_read, nvals;
+static int _get_process_data_line(char *sbuf, jag_prec_t *prec) {
+	char *tmp;
+	int nvals;
 	char cmd[40], state[1];
 	int ppid, pgrp, session, tty_nr, tpgid;
 	long unsigned flags, minflt, cminflt, majflt, cmajflt;
@@ -299,11 +320,6 @@ static int _get_process_data_line(int in, jag_prec_t *prec) {
 	long unsigned f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13;
 	int exit_signal, last_cpu;
 
-	num_read = read(in, sbuf, (sizeof(sbuf) - 1));
-	if (num_read <= 0)
-		return 0;
-	sbuf[num_read] = '\0';
-
 	/*
 	 * split into "PID (cmd" and "<rest>" replace trailing ')' with NULL
 	 */
@@ -335,11 +351,6 @@ static int _get_process_data_line(int in, jag_prec_t *prec) {
 	if ((nvals < 37) || (rss < 0))
 		return 0;
 
-	/* If current pid corresponds to a Light Weight Process (Thread POSIX) */
-	/* skip it, we will only account the original process (pid==tgid) */
-	if (_is_a_lwp(prec->pid) > 0)
-		return 0;
-
 	/* Copy the values that slurm records into our data structure */
 	prec->ppid  = ppid;
 	prec->pages = majflt;
@@ -353,7 +364,7 @@ static int _get_process_data_line(int in, jag_prec_t *prec) {
 
 /* _get_process_memory_line() - get line of data from /proc/<pid>/statm
  *
- * IN:	in - input file descriptor
+ * IN:	sbuf - contents of the file
  * OUT:	prec - the destination for the data
  *
  * RETVAL:	==0 - no valid data
@@ -364,17 +375,11 @@ static int _get_process_data_line(int in, jag_prec_t *prec) {
  * and return the updated struct.
  *
  */
-static int _get_process_memory_line(int in, jag_prec_t *prec)
+static int _get_process_memory_line(char *sbuf, jag_prec_t *prec)
 {
-	char sbuf[256];
-	int num_read, nvals;
+	int nvals;
 	long int size, rss, share, text, lib, data, dt;
 
-	num_read = read(in, sbuf, (sizeof(sbuf) - 1));
-	if (num_read <= 0)
-		return 0;
-	sbuf[num_read] = '\0';
-
 	nvals = sscanf(sbuf,
 		       "%ld %ld %ld %ld %ld %ld %ld",
 		       &size, &rss, &share, &text, &lib, &data, &dt);
@@ -393,27 +398,9 @@ static int _get_process_memory_line(int in, jag_prec_t *prec)
 	return 1;
 }
 
-static int _remove_share_data(char *proc_stat_file, jag_prec_t *prec)
-{
-	FILE *statm_fp = NULL;
-	char proc_statm_file[256];	/* Allow ~20x extra length */
-	int rc = 0, fd;
-
-	snprintf(proc_statm_file, sizeof(proc_statm_file), "%sm",
-		 proc_stat_file);
-	if (!(statm_fp = fopen(proc_statm_file, "r")))
-		return rc;  /* Assume the process went away */
-	fd = fileno(statm_fp);
-	if (fcntl(fd, F_SETFD, FD_CLOEXEC) == -1)
-		error("%s: fcntl(%s): %m", __func__, proc_statm_file);
-	rc = _get_process_memory_line(fd, prec);
-	fclose(statm_fp);
-	return rc;
-}
-
 /* _get_process_io_data_line() - get line of data from /proc/<pid>/io
  *
- * IN:	in - input file descriptor
+ * IN:	sbuf - contents of the file
  * OUT:	prec - the destination for the data
  *
  * RETVAL:	==0 - no valid data
@@ -424,25 +411,16 @@ static int _remove_share_data(char *proc_stat_file, jag_prec_t *prec)
  * wrchar: <# of characters written>
  *   . . .
  */
-static int _get_process_io_data_line(int in, jag_prec_t *prec) {
-	char sbuf[256];
+static int _get_process_io_data_line(char *sbuf, jag_prec_t *prec) {
 	char f1[7], f3[7];
-	int num_read, nvals;
+	int nvals;
 	uint64_t rchar, wchar;
 
-	num_read = read(in, sbuf, (sizeof(sbuf) - 1));
-	if (num_read <= 0)
-		return 0;
-	sbuf[num_read] = '\0';
-
-	nvals = sscanf(sbuf, "%s %"PRIu64" %s %"PRIu64"",
+	nvals = sscanf(sbuf, "%6s %"PRIu64" %6s %"PRIu64"",
 		       f1, &rchar, f3, &wchar);
 	if (nvals < 4)
 		return 0;
 
-	if (_is_a_lwp(prec->pid) > 0)
-		return 0;
-
 	/* Copy the values that slurm records into our data structure */
 	prec->disk_read = (double)rchar / (double)1048576;
 	prec->disk_write = (double)wchar / (double)1048576;
@@ -450,15 +428,116 @@ static int _get_process_io_data_line(int in, jag_prec_t *prec) {
 	return 1;
 }
 
-static void _handle_stats(List prec_list, char *proc_stat_file, char *proc_io_file,
-			  char *proc_smaps_file, jag_callbacks_t *callbacks)
+static void _close_proc_fds(jag_proc_fds_t *proc)
+{
+	if (proc->stat_fd >= 0)
+		close(proc->stat_fd);
+	if (proc->statm_fd >= 0)
+		close(proc->statm_fd);
+	if (proc->io_fd >= 0)
+		close(proc->io_fd);
+	proc->stat_fd = proc->statm_fd = proc->io_fd = -1;
+	proc->lwp = -1;
+}
+
+static void _destroy_proc_fds(void *x)
+{
+	jag_proc_fds_t *proc = (jag_proc_fds_t *) x;
+
+	_close_proc_fds(proc);
+	xfree(proc);
+}
+
+static int _find_proc_fds(void *x, void *key)
+{
+	jag_proc_fds_t *proc = (jag_proc_fds_t *) x;
+	pid_t pid = *(pid_t *) key;
+
+	return (proc->pid == pid);
+}
+
+/* Remove the processes not found by this poll, clear the flag of others */
+static int _find_unseen_proc_fds(void *x, void *key)
+{
+	jag_proc_fds_t *proc = (jag_proc_fds_t *) x;
+
+	if (!proc->seen)
+		return 1;
+	proc->seen = false;
+	return 0;
+}
+
+/*
+ * Return the open files of a process, kept between polls if cache is set
+ * and there is room, or else in tmp_proc to be closed by the caller
+ */
+static jag_proc_fds_t *_get_proc_fds(pid_t pid, bool cache,
+				     jag_proc_fds_t *tmp_proc)
+{
+	jag_proc_fds_t *proc = NULL;
+
+	if (cache) {
+		if (!proc_fds_list)
+			proc_fds_list = list_create(_destroy_proc_fds);
+		proc = list_find_first(proc_fds_list, _find_proc_fds, &pid);
+		if (!proc &&
+		    (list_count(proc_fds_list) < MAX_CACHED_PROCS)) {
+			proc = xmalloc(sizeof(jag_proc_fds_t));
+			proc->pid = pid;
+			proc->stat_fd = proc->statm_fd = proc->io_fd = -1;
+			proc->lwp = -1;
+			list_append(proc_fds_list, proc);
+		}
+	}
+	if (!proc) {
+		proc = tmp_proc;
+		proc->pid = pid;
+		proc->stat_fd = proc->statm_fd = proc->io_fd = -1;
+		proc->lwp = -1;
+	}
+	proc->seen = true;
+
+	return proc;
+}
+
+/*
+ * Read /proc/<pid>/<name> into sbuf, opening it first if *fd is -1.
+ * The file is opened close-on-exec so user tasks never inherit it.
+ * RET bytes read, <= 0 on error
+ */
+static int _read_proc_file(int *fd, pid_t pid, const char *name,
+			   char *sbuf, size_t size)
+{
+	char path[64];
+	ssize_t num_read;
+
+	if (*fd < 0) {
+		snprintf(path, sizeof(path), "/proc/%d/%s", (int) pid, name);
+		if ((*fd = open(path, O_RDONLY | O_CLOEXEC)) < 0)
+			return -1;
+	}
+
+	do {
+		num_read = pread(*fd, sbuf, size - 1, 0);
+	} while ((num_read < 0) && (errno == EINTR));
+	if (num_read <= 0)
+		return -1;
+	sbuf[num_read] = '\0';
+
+	return num_read;
+}
+
+static void _handle_stats(List prec_list, pid_t pid, bool cache,
+			  jag_callbacks_t *callbacks)
 {
 	static int no_share_data = -1;
 	static int use_pss = -1;
-	FILE *stat_fp = NULL;
-	FILE *io_fp = NULL;
-	int fd, fd2;
+	char sbuf[512];
+	char proc_smaps_file[64];
+	jag_proc_fds_t *proc, tmp_proc;
 	jag_prec_t *prec = NULL;
+	bool was_open;
+	int num_read;
 
 	if (no_share_data == -1) {
 		char *acct_params = slurm_get_jobacct_gather_params();
@@ -474,66 +553,72 @@ static void _handle_stats(List prec_list, char *proc_stat_file, char *proc_io_fi
 		xfree(acct_params);
 	}
 
-	if (!(stat_fp = fopen(proc_stat_file, "r")))
-		return;  /* Assume the process went away */
-	/*
-	 * Close the file on exec() of user tasks.
-	 *
-	 * NOTE: If we fork() slurmstepd after the
-	 * fopen() above and before the fcntl() below,
-	 * then the user task may have this extra file
-	 * open, which can cause problems for
-	 * checkpoint/restart, but this should be a very rare
-	 * problem in practice.
-	 */
-	fd = fileno(stat_fp);
-	if (fcntl(fd, F_SETFD, FD_CLOEXEC) == -1)
-		error("%s: fcntl(%s): %m", __func__, proc_stat_file);
+	proc = _get_proc_fds(pid, cache, &tmp_proc);
+
+	was_open = (proc->stat_fd >= 0);
+	num_read = _read_proc_file(&proc->stat_fd, pid, "stat",
+				   sbuf, sizeof(sbuf));
+	if ((num_read <= 0) && was_open) {
+		/*
+		 * The files kept open belong to a process which is gone,
+		 * the pid may have been reused since
+		 */
+		_close_proc_fds(proc);
+		num_read = _read_proc_file(&proc->stat_fd, pid, "stat",
+					   sbuf, sizeof(sbuf));
+	}
+	if (num_read <= 0)
+		goto done;	/* Assume the process went away */
 
 	prec = try_xmalloc(sizeof(jag_prec_t));
-	if (prec == NULL) {	/* Avoid killing slurmstepd on malloc failure */
-		fclose(stat_fp);
-		return;
+	if (prec == NULL)	/* Avoid killing slurmstepd on malloc failure */
+		goto done;
+	if (!_get_process_data_line(sbuf, prec)) {
+		xfree(prec);
+		goto done;
 	}
-	if (!_get_process_data_line(fd, prec)) {
+
+	/* If current pid corresponds to a Light Weight Process (Thread POSIX) */
+	/* skip it, we will only account the original process (pid==tgid) */
+	if (proc->lwp == -1)
+		proc->lwp = _is_a_lwp(prec->pid);
+	if (proc->lwp > 0) {
 		xfree(prec);
-		fclose(stat_fp);
-		return;
+		goto done;
 	}
-	fclose(stat_fp);
 
 	/* Remove shared data from rss */
-	if (no_share_data)
-		_remove_share_data(proc_stat_file, prec);
+	if (no_share_data &&
+	    (_read_proc_file(&proc->statm_fd, pid, "statm",
+			     sbuf, sizeof(sbuf)) > 0))
+		_get_process_memory_line(sbuf, prec);
 
 	/* Use PSS instead if RSS */
 	if (use_pss) {
+		snprintf(proc_smaps_file, sizeof(proc_smaps_file),
+			 "/proc/%d/smaps", (int) pid);
 		if (_get_pss(proc_smaps_file, prec) == -1) {
 			xfree(prec);
-			return;
+			goto done;
 		}
 	}
 
 	list_append(prec_list, prec);
 
-	if ((io_fp = fopen(proc_io_file, "r"))) {
-		fd2 = fileno(io_fp);
-		if (fcntl(fd2, F_SETFD, FD_CLOEXEC) == -1)
-			error("%s: fcntl: %m", __func__);
-		_get_process_io_data_line(fd2, prec);
-		fclose(io_fp);
-	}
+	if (_read_proc_file(&proc->io_fd, pid, "io", sbuf, sizeof(sbuf)) > 0)
+		_get_process_io_data_line(sbuf, prec);
 	if (callbacks->prec_extra)
 		(*(callbacks->prec_extra))(prec);
+
+done:
+	if (proc == &tmp_proc)
+		_close_proc_fds(proc);
 }
 
 static List _get_precs(List task_list, bool pgid_plugin, uint64_t cont_id,
 		       jag_callbacks_t *callbacks)
 {
 	List prec_list = list_create(destroy_jag_prec);
-	char	proc_stat_file[256];	/* Allow ~20x extra length */
-	char	proc_io_file[256];	/* Allow ~20x extra length */
-	char	proc_smaps_file[256];	/* Allow ~20x extra length */
 	static	int	slash_proc_open = 0;
 	int i;
 
@@ -554,19 +639,19 @@ static List _get_precs(List task_list, bool pgid_plugin, uint64_t cont_id,
 			}
 
 			debug4("no pids in this container %"PRIu64"", cont_id);
-			goto finished;
-		}
-		for (i = 0; i < npids; i++) {
-			snprintf(proc_stat_file, 256, "/proc/%d/stat", pids[i]);
-			snprintf(proc_io_file, 256, "/proc/%d/io", pids[i]);
-			snprintf(proc_smaps_file, 256, "/proc/%d/smaps", pids[i]);
-			_handle_stats(prec_list, proc_stat_file, proc_io_file,
-				      proc_smaps_file, callbacks);
 		}
+		for (i = 0; i < npids; i++)
+			_handle_stats(prec_list, pids[i], true, callbacks);
 		xfree(pids);
+
+		/* Close the files of processes which have exited */
+		if (proc_fds_list)
+			list_delete_all(proc_fds_list, _find_unseen_proc_fds,
+					NULL);
 	} else {
 		struct dirent *slash_proc_entry;
-		char  *iptr = NULL, *optr = NULL, *optr2 = NULL;
+		char *iptr;
+		pid_t pid;
 
 		if (slash_proc_open) {
 			rewinddir(slash_proc);
@@ -578,79 +663,27 @@ static List _get_precs(List task_list, bool pgid_plugin, uint64_t cont_id,
 			}
 			slash_proc_open=1;
 		}
-		strcpy(proc_stat_file, "/proc/");
-		strcpy(proc_io_file, "/proc/");
-		strcpy(proc_smaps_file, "/proc/");
 
 		while ((slash_proc_entry = readdir(slash_proc))) {
-
-			/* Save a few cyles by simulating
-			 * strcat(statFileName, slash_proc_entry->d_name);
-			 * strcat(statFileName, "/stat");
-			 * while checking for a numeric filename (which really
-			 * should be a pid). Then do the same for the
-			 * /proc/<pid>/io file name.
+			/*
+			 * Only numeric filenames (which really should be a
+			 * pid). Files of all processes on the node are not
+			 * kept open between polls.
 			 */
-			optr = proc_stat_file + sizeof("/proc");
-			iptr = slash_proc_entry->d_name;
-			i = 0;
-			do {
-				if ((*iptr < '0') ||
-				    ((*optr++ = *iptr++) > '9')) {
-					i = -1;
-					break;
-				}
-			} while (*iptr);
-
-			if (i == -1)
-				continue;
-			iptr = (char*)"/stat";
-
-			do {
-				*optr++ = *iptr++;
-			} while (*iptr);
-			*optr = 0;
-
-			optr2 = proc_io_file + sizeof("/proc");
 			iptr = slash_proc_entry->d_name;
-			i = 0;
+			pid = 0;
 			do {
-				if ((*iptr < '0') ||
-				    ((*optr2++ = *iptr++) > '9')) {
-					i = -1;
+				if ((*iptr < '0') || (*iptr > '9')) {
+					pid = -1;
 					break;
 				}
+				pid = (pid * 10) + (*iptr++ - '0');
 			} while (*iptr);
-			if (i == -1)
-				continue;
-			iptr = (char*)"/io";
 
-			do {
-				*optr2++ = *iptr++;
-			} while (*iptr);
-			*optr2 = 0;
-
-			optr2 = proc_smaps_file + sizeof("/proc");
-			iptr = slash_proc_entry->d_name;
-			i = 0;
-			do {
-				if ((*iptr < '0') ||
-				    ((*optr2++ = *iptr++) > '9')) {
-					i = -1;
-					break;
-				}
-			} while (*iptr);
-			if (i == -1)
+			if (pid <= 0)
 				continue;
-			iptr = (char*)"/smaps";
-
-			do {
-				*optr2++ = *iptr++;
-			} while (*iptr);
-			*optr2 = 0;
 
-			_handle_stats(prec_list, proc_stat_file, proc_io_file,
-				      proc_smaps_file,callbacks);
+			_handle_stats(prec_list, pid, false, callbacks);
 		}
 	}
 
@@ -784,6 +817,7 @@ extern void jag_common_fini(void)
 {
 	if (slash_proc)
 		(void) closedir(slash_proc);
+	FREE_NULL_LIST(proc_fds_list);
 }
 
 extern void destroy_jag_prec(void *object)
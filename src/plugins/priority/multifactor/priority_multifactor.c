@@ -61,6 +61,9 @@
 #include "src/common/parse_time.h"
 #include "src/common/slurm_mcs.h"
 #include "src/common/slurm_time.h"
+#include "src/common/timers.h"
+#include "src/common/tres_array.h"
+#include "src/common/vector.h"
 #include "src/common/xstring.h"
 #include "src/common/gres.h"
 
@@ -72,6 +75,10 @@
 #define SECS_PER_DAY	(24 * 60 * 60)
 #define SECS_PER_WEEK	(7 * SECS_PER_DAY)
 
+#define MAX_DECAY_THREADS	64
+/* Split the association tree into at least this many subtrees per thread */
+#define SUBTREES_PER_THREAD	16
+
 /* These are defined here so when we link with something other than
  * the slurmctld we will have these symbols defined.  They will get
  * overwritten when linking with the slurmctld.
@@ -147,12 +154,31 @@ static uint32_t prevflags;    /* Priority Flags before _internal_setup() resets
 			       * flags after a reconfigure */
 static time_t g_last_ran = 0; /* when the last poll ran */
 static double decay_factor = 1; /* The decay factor when decaying time. */
+static int decay_thread_cnt = 1; /* PriorityParameters=decay_threads */
+
+/* A job whose priority is being recalculated by the decay thread */
+typedef struct {
+	struct job_record *job_ptr;
+	uint32_t new_prio;
+	double priority_fs;	/* fairshare factor, set before new_prio */
+} decay_job_prio_t;
+
+typedef struct {
+	vector_t *job_prio;
+	time_t *start_time_ptr;
+} decay_usage_arg_t;
 
 /* variables defined in prirority_multifactor.h */
 bool priority_debug = 0;
 
 static void _priority_p_set_assoc_usage_debug(slurmdb_assoc_rec_t *assoc);
 static void _set_assoc_usage_efctv(slurmdb_assoc_rec_t *assoc);
+static void _apply_weighted_factors(vector_t *job_prio,
+				    time_t *start_time_ptr);
+static void _set_priority_factors(time_t start_time,
+				  struct job_record *job_ptr,
+				  double *priority_fs);
+static int _queue_job_prio(void *x, void *arg);
 
 /*
  * apply decay factor to all associations usage_raw
@@ -428,27 +454,90 @@ static int _set_children_usage_efctv(List children_list)
 	return SLURM_SUCCESS;
 }
 
+/* vector_for_each_balanced() callback, set usage_efctv below an account */
+static int _set_subtree_usage_efctv(void *x, void *arg)
+{
+	slurmdb_assoc_rec_t *assoc = *(slurmdb_assoc_rec_t **) x;
+
+	return _set_children_usage_efctv(assoc->usage->children_list);
+}
+
+/*
+ * Set usage_efctv of every association below root, as
+ * _set_children_usage_efctv() does, with decay_thread_cnt threads.
+ *
+ * The tree is set one level at a time from the top until it is wide enough to
+ * share out, then each thread takes whole subtrees below that level. An
+ * association's usage_efctv only depends on associations above it and on its
+ * siblings, which are either set before the threads start or by the same
+ * thread.
+ *
+ * NOTE: acct_mgr_assoc_lock must be locked before this is called.
+ */
+static void _set_all_usage_efctv(void)
+{
+	vector_t *level, *next_level;
+	slurmdb_assoc_rec_t *root_assoc = assoc_mgr_root_assoc, *assoc;
+	ListIterator itr;
+	uint32_t i;
+
+	if (decay_thread_cnt <= 1) {
+		_set_children_usage_efctv(root_assoc->usage->children_list);
+		return;
+	}
+
+	level = vector_create(sizeof(slurmdb_assoc_rec_t *), 1);
+	*(slurmdb_assoc_rec_t **) vector_append(level) = root_assoc;
+
+	while (vector_count(level) &&
+	       (vector_count(level) < decay_thread_cnt * SUBTREES_PER_THREAD)) {
+		next_level = vector_create(sizeof(slurmdb_assoc_rec_t *),
+					   vector_count(level) * 2);
+		for (i = 0; i < vector_count(level); i++) {
+			assoc = *(slurmdb_assoc_rec_t **) vector_get(level, i);
+			if (!assoc->usage->children_list)
+				continue;
+			itr = list_iterator_create(
+				assoc->usage->children_list);
+			while ((assoc = list_next(itr))) {
+				if (assoc->user) {
+					assoc->usage->usage_efctv =
+						(long double)NO_VAL;
+					continue;
+				}
+				priority_p_set_assoc_usage(assoc);
+				*(slurmdb_assoc_rec_t **)
+					vector_append(next_level) = assoc;
+			}
+			list_iterator_destroy(itr);
+		}
+		FREE_NULL_VECTOR(level);
+		level = next_level;
+	}
+
+	vector_for_each_balanced(level, _set_subtree_usage_efctv, NULL,
+				 decay_thread_cnt);
+	FREE_NULL_VECTOR(level);
+}
+
 
 /* job_ptr should already have the partition priority and such added here
  * before had we will be adding to it
+ *
+ * NOTE: acct_mgr_assoc_lock must be locked before this is called.
  */
-static double _get_fairshare_priority(struct job_record *job_ptr)
+static double _get_fairshare_priority_locked(struct job_record *job_ptr)
 {
 	slurmdb_assoc_rec_t *job_assoc;
 	slurmdb_assoc_rec_t *fs_assoc = NULL;
 	double priority_fs = 0.0;
-	assoc_mgr_lock_t locks = { READ_LOCK, NO_LOCK, NO_LOCK, NO_LOCK,
-				   NO_LOCK, NO_LOCK, NO_LOCK };
 
 	if (!calc_fairshare)
 		return 0;
 
-	assoc_mgr_lock(&locks);
-
 	job_assoc = job_ptr->assoc_ptr;
 
 	if (!job_assoc) {
-		assoc_mgr_unlock(&locks);
 		error("Job %u has no association.  Unable to "
 		      "compute fairshare.", job_ptr->job_id);
 		return 0;
@@ -484,15 +573,34 @@ static double _get_fairshare_priority(struct job_record *job_ptr)
 			     fs_assoc->usage->shares_norm, priority_fs);
 		}
 	}
+
+	return priority_fs;
+}
+
+static double _get_fairshare_priority(struct job_record *job_ptr)
+{
+	double priority_fs;
+	assoc_mgr_lock_t locks = { READ_LOCK, NO_LOCK, NO_LOCK, NO_LOCK,
+				   NO_LOCK, NO_LOCK, NO_LOCK };
+
+	if (!calc_fairshare)
+		return 0;
+
+	assoc_mgr_lock(&locks);
+	priority_fs = _get_fairshare_priority_locked(job_ptr);
 	assoc_mgr_unlock(&locks);
 
 	return priority_fs;
 }
 
 
-/* Returns the priority after applying the weight factors */
+/*
+ * Returns the priority after applying the weight factors
+ * IN priority_fs - job's fairshare factor if already known, else NULL
+ */
 static uint32_t _get_priority_internal(time_t start_time,
-				       struct job_record *job_ptr)
+				       struct job_record *job_ptr,
+				       double *priority_fs)
 {
 	double priority	= 0.0;
 	priority_factors_object_t pre_factors;
@@ -522,7 +630,7 @@ static uint32_t _get_priority_internal(time_t start_time,
 		return 0;
 	}
 
-	set_priority_factors(start_time, job_ptr);
+	_set_priority_factors(start_time, job_ptr, priority_fs);
 
 	if (priority_debug) {
 		memcpy(&pre_factors, job_ptr->prio_factors,
@@ -619,9 +727,12 @@ static uint32_t _get_priority_internal(time_t start_time,
 				job_ptr->priority_array[i] =
 					(uint32_t) priority_part;
 			}
-			debug("Job %u has more than one partition (%s)(%u)",
-			      job_ptr->job_id, part_ptr->name,
-			      job_ptr->priority_array[i]);
+			if (get_log_level() >= LOG_LEVEL_DEBUG) {
+				debug("Job %u has more than one partition "
+				      "(%s)(%u)", job_ptr->job_id,
+				      part_ptr->name,
+				      job_ptr->priority_array[i]);
+			}
 			i++;
 		}
 		list_iterator_destroy(part_iterator);
@@ -752,39 +863,41 @@ static void _handle_qos_tres_run_secs(long double *tres_run_decay,
 	if (!qos || !(accounting_enforce & ACCOUNTING_ENFORCE_LIMITS))
 		return;
 
-	for (i=0; i<slurmctld_tres_cnt; i++) {
+	for (i = 0; tres_run_decay && (i < slurmctld_tres_cnt); i++) {
 		if (i == TRES_ARRAY_ENERGY)
 			continue;
-		if (tres_run_decay)
-			qos->usage->usage_tres_raw[i] += tres_run_decay[i];
-
-		if (tres_run_delta[i] >
-		    qos->usage->grp_used_tres_run_secs[i]) {
-			error("_handle_qos_tres_run_secs: job %u: "
-			      "QOS %s TRES %s grp_used_tres_run_secs "
-			      "underflow, tried to remove %"PRIu64" seconds "
-			      "when only %"PRIu64" remained.",
-			      job_id,
-			      qos->name,
-			      assoc_mgr_tres_name_array[i],
-			      tres_run_delta[i],
-			      qos->usage->grp_used_tres_run_secs[i]);
-			qos->usage->grp_used_tres_run_secs[i] = 0;
-		} else
-			qos->usage->grp_used_tres_run_secs[i] -=
-				tres_run_delta[i];
+		qos->usage->usage_tres_raw[i] += tres_run_decay[i];
+	}
 
-		if (priority_debug) {
-			info("_handle_qos_tres_run_secs: job %u: "
-			     "Removed %"PRIu64" unused seconds "
-			     "from QOS %s TRES %s "
-			     "grp_used_tres_run_secs = %"PRIu64,
-			     job_id,
-			     tres_run_delta[i],
-			     qos->name,
-			     assoc_mgr_tres_name_array[i],
-			     qos->usage->grp_used_tres_run_secs[i]);
-		}
+	/* The callers never put ENERGY in tres_run_delta */
+	if ((i = tres_array_exceeds(tres_run_delta, NULL,
+				    qos->usage->grp_used_tres_run_secs,
+				    slurmctld_tres_cnt)) >= 0) {
+		error("_handle_qos_tres_run_secs: job %u: "
+		      "QOS %s TRES %s grp_used_tres_run_secs "
+		      "underflow, tried to remove %"PRIu64" seconds "
+		      "when only %"PRIu64" remained.",
+		      job_id,
+		      qos->name,
+		      assoc_mgr_tres_name_array[i],
+		      tres_run_delta[i],
+		      qos->usage->grp_used_tres_run_secs[i]);
+	}
+	tres_array_sub(qos->usage->grp_used_tres_run_secs, tres_run_delta,
+		       slurmctld_tres_cnt);
+
+	for (i = 0; priority_debug && (i < slurmctld_tres_cnt); i++) {
+		if (i == TRES_ARRAY_ENERGY)
+			continue;
+		info("_handle_qos_tres_run_secs: job %u: "
+		     "Removed %"PRIu64" unused seconds "
+		     "from QOS %s TRES %s "
+		     "grp_used_tres_run_secs = %"PRIu64,
+		     job_id,
+		     tres_run_delta[i],
+		     qos->name,
+		     assoc_mgr_tres_name_array[i],
+		     qos->usage->grp_used_tres_run_secs[i]);
 	}
 }
 
@@ -798,39 +911,41 @@ static void _handle_assoc_tres_run_secs(long double *tres_run_decay,
 	if (!assoc || !(accounting_enforce & ACCOUNTING_ENFORCE_LIMITS))
 		return;
 
-	for (i=0; i<slurmctld_tres_cnt; i++) {
+	for (i = 0; tres_run_decay && (i < slurmctld_tres_cnt); i++) {
 		if (i == TRES_ARRAY_ENERGY)
 			continue;
-		if (tres_run_decay)
-			assoc->usage->usage_tres_raw[i] += tres_run_decay[i];
-
-		if (tres_run_delta[i] >
-		    assoc->usage->grp_used_tres_run_secs[i]) {
-			error("_handle_assoc_tres_run_secs: job %u: "
-			      "assoc %u TRES %s grp_used_tres_run_secs "
-			      "underflow, tried to remove %"PRIu64" seconds "
-			      "when only %"PRIu64" remained.",
-			      job_id,
-			      assoc->id,
-			      assoc_mgr_tres_name_array[i],
-			      tres_run_delta[i],
-			      assoc->usage->grp_used_tres_run_secs[i]);
-			assoc->usage->grp_used_tres_run_secs[i] = 0;
-		} else
-			assoc->usage->grp_used_tres_run_secs[i] -=
-				tres_run_delta[i];
+		assoc->usage->usage_tres_raw[i] += tres_run_decay[i];
+	}
 
-		if (priority_debug) {
-			info("_handle_assoc_tres_run_secs: job %u: "
-			     "Removed %"PRIu64" unused seconds "
-			     "from assoc %d TRES %s "
-			     "grp_used_tres_run_secs = %"PRIu64,
-			     job_id,
-			     tres_run_delta[i],
-			     assoc->id,
-			     assoc_mgr_tres_name_array[i],
-			     assoc->usage->grp_used_tres_run_secs[i]);
-		}
+	/* The callers never put ENERGY in tres_run_delta */
+	if ((i = tres_array_exceeds(tres_run_delta, NULL,
+				    assoc->usage->grp_used_tres_run_secs,
+				    slurmctld_tres_cnt)) >= 0) {
+		error("_handle_assoc_tres_run_secs: job %u: "
+		      "assoc %u TRES %s grp_used_tres_run_secs "
+		      "underflow, tried to remove %"PRIu64" seconds "
+		      "when only %"PRIu64" remained.",
+		      job_id,
+		      assoc->id,
+		      assoc_mgr_tres_name_array[i],
+		      tres_run_delta[i],
+		      assoc->usage->grp_used_tres_run_secs[i]);
+	}
+	tres_array_sub(assoc->usage->grp_used_tres_run_secs, tres_run_delta,
+		       slurmctld_tres_cnt);
+
+	for (i = 0; priority_debug && (i < slurmctld_tres_cnt); i++) {
+		if (i == TRES_ARRAY_ENERGY)
+			continue;
+		info("_handle_assoc_tres_run_secs: job %u: "
+		     "Removed %"PRIu64" unused seconds "
+		     "from assoc %d TRES %s "
+		     "grp_used_tres_run_secs = %"PRIu64,
+		     job_id,
+		     tres_run_delta[i],
+		     assoc->id,
+		     assoc_mgr_tres_name_array[i],
+		     assoc->usage->grp_used_tres_run_secs[i]);
 	}
 }
 
@@ -869,7 +984,6 @@ static void _init_grp_used_cpu_run_secs(time_t last_ran)
 	slurmctld_lock_t job_read_lock =
 		{ NO_LOCK, READ_LOCK, NO_LOCK, NO_LOCK, NO_LOCK };
 	uint64_t tres_run_delta[slurmctld_tres_cnt];
-	int i;
 
 	if (priority_debug)
 		info("Initializing grp_used_cpu_run_secs");
@@ -899,11 +1013,12 @@ static void _init_grp_used_cpu_run_secs(time_t last_ran)
 		if (job_ptr->start_time > last_ran)
 			continue;
 
-		for (i=0; i<slurmctld_tres_cnt; i++) {
-			tres_run_delta[i] =
-				(uint64_t)(last_ran - job_ptr->start_time) *
-				job_ptr->tres_alloc_cnt[i];
-		}
+		memset(tres_run_delta, 0, sizeof(tres_run_delta));
+		tres_array_add_scaled(tres_run_delta, job_ptr->tres_alloc_cnt,
+				      (uint64_t)(last_ran -
+						 job_ptr->start_time),
+				      slurmctld_tres_cnt);
+		tres_run_delta[TRES_ARRAY_ENERGY] = 0;
 
 		_handle_tres_run_secs(tres_run_delta, job_ptr);
 	}
@@ -1046,6 +1161,7 @@ static int _apply_new_usage(struct job_record *job_ptr,
 			tres_run_nodecay[i] = (long double)run_nodecay *
 				(long double)job_ptr->tres_alloc_cnt[i];
 		}
+		tres_run_delta[TRES_ARRAY_ENERGY] = 0;
 	}
 
 	assoc = job_ptr->assoc_ptr;
@@ -1127,6 +1243,26 @@ static int _apply_new_usage(struct job_record *job_ptr,
 }
 
 
+/*
+ * list_for_each() callback of the decay thread, apply the job's new usage and
+ * queue it for _apply_weighted_factors()
+ */
+static int _decay_apply_new_usage_and_queue(void *x, void *arg)
+{
+	struct job_record *job_ptr = (struct job_record *) x;
+	decay_usage_arg_t *usage_arg = (decay_usage_arg_t *) arg;
+
+	/* Always return SUCCESS so that list_for_each will
+	 * continue processing list of jobs. */
+
+	if (!decay_apply_new_usage(job_ptr, usage_arg->start_time_ptr))
+		return SLURM_SUCCESS;
+
+	(void) _queue_job_prio(job_ptr, usage_arg->job_prio);
+
+	return SLURM_SUCCESS;
+}
+
 static int _decay_apply_new_usage_and_weighted_factors(
 	struct job_record *job_ptr,
 	time_t *start_time_ptr)
@@ -1275,8 +1411,7 @@ static void *_decay_thread(void *no_data)
 		 * it handles these calculations during its tree traversal */
 		if (!(flags & PRIORITY_FLAGS_FAIR_TREE)) {
 			assoc_mgr_lock(&locks);
-			_set_children_usage_efctv(
-				assoc_mgr_root_assoc->usage->children_list);
+			_set_all_usage_efctv();
 			assoc_mgr_unlock(&locks);
 		}
 
@@ -1306,12 +1441,23 @@ static void *_decay_thread(void *no_data)
 		}
 
 		if (!(flags & PRIORITY_FLAGS_FAIR_TREE)) {
+			decay_usage_arg_t usage_arg;
+
 			lock_slurmctld(job_write_lock);
-			list_for_each(
-				job_list,
-				(ListForF) _decay_apply_new_usage_and_weighted_factors,
-				&start_time
-				);
+			/*
+			 * Apply all new usage first, it is summed into shared
+			 * associations and QOS. The job priorities are then
+			 * calculated in parallel.
+			 */
+			usage_arg.job_prio = vector_create(
+				sizeof(decay_job_prio_t), list_count(job_list));
+			usage_arg.start_time_ptr = &start_time;
+			list_for_each(job_list,
+				      _decay_apply_new_usage_and_queue,
+				      &usage_arg);
+			_apply_weighted_factors(usage_arg.job_prio,
+						&start_time);
+			FREE_NULL_VECTOR(usage_arg.job_prio);
 			unlock_slurmctld(job_write_lock);
 		}
 
@@ -1456,7 +1602,7 @@ static void *_cleanup_thread(void *no_data)
 
 static void _internal_setup(void)
 {
-	char *tres_weights_str;
+	char *tres_weights_str, *prio_params, *tmp_ptr;
 	if (slurm_get_debug_flags() & DEBUG_FLAG_PRIO)
 		priority_debug = 1;
 	else
@@ -1479,6 +1625,19 @@ static void _internal_setup(void)
 	xfree(tres_weights_str);
 	flags = slurm_get_priority_flags();
 
+	decay_thread_cnt = 1;
+	prio_params = slurm_get_priority_params();
+	if (prio_params && (tmp_ptr = strstr(prio_params, "decay_threads="))) {
+		decay_thread_cnt = atoi(tmp_ptr + 14);
+		if ((decay_thread_cnt < 1) ||
+		    (decay_thread_cnt > MAX_DECAY_THREADS)) {
+			error("Invalid PriorityParameters decay_threads=%d",
+			      decay_thread_cnt);
+			decay_thread_cnt = 1;
+		}
+	}
+	xfree(prio_params);
+
 	if (priority_debug) {
 		info("priority: Damp Factor is %u", damp_factor);
 		info("priority: AccountingStorageEnforce is %u", enforce);
@@ -1489,6 +1648,7 @@ static void _internal_setup(void)
 		info("priority: Weight Part is %u", weight_part);
 		info("priority: Weight QOS is %u", weight_qos);
 		info("priority: Flags is %u", flags);
+		info("priority: Decay threads is %d", decay_thread_cnt);
 	}
 }
 
@@ -1754,7 +1914,7 @@ int fini ( void )
 
 extern uint32_t priority_p_set(uint32_t last_prio, struct job_record *job_ptr)
 {
-	uint32_t priority = _get_priority_internal(time(NULL), job_ptr);
+	uint32_t priority = _get_priority_internal(time(NULL), job_ptr, NULL);
 
 	debug2("initial priority for job %u is %u", job_ptr->job_id, priority);
 
@@ -1958,14 +2118,9 @@ extern bool decay_apply_new_usage(struct job_record *job_ptr,
 }
 
 
-extern int decay_apply_weighted_factors(struct job_record *job_ptr,
-					 time_t *start_time_ptr)
+/* Return true if the decay thread is to recalculate the job's priority */
+static bool _job_prio_recalc(struct job_record *job_ptr)
 {
-	uint32_t new_prio;
-
-	/* Always return SUCCESS so that list_for_each will
-	 * continue processing list of jobs. */
-
 	/*
 	 * Priority 0 is reserved for held jobs. Also skip priority
 	 * re_calculation for non-pending jobs.
@@ -1974,25 +2129,153 @@ extern int decay_apply_weighted_factors(struct job_record *job_ptr,
 	    IS_JOB_POWER_UP_NODE(job_ptr) ||
 	    (!IS_JOB_PENDING(job_ptr) &&
 	     !(flags & PRIORITY_FLAGS_CALCULATE_RUNNING)))
-		return SLURM_SUCCESS;
+		return false;
+
+	return true;
+}
+
+/*
+ * Set a job's recalculated priority
+ * RET true if the priority changed. Only then are job updates signalled, so
+ * the schedulers and clients do not treat an unchanged queue as new.
+ */
+static bool _set_job_prio(struct job_record *job_ptr, uint32_t new_prio)
+{
+	bool changed = false;
 
-	new_prio = _get_priority_internal(*start_time_ptr, job_ptr);
-	if (((flags & PRIORITY_FLAGS_INCR_ONLY) == 0) ||
-	    (job_ptr->priority < new_prio)) {
+	if ((job_ptr->priority != new_prio) &&
+	    (((flags & PRIORITY_FLAGS_INCR_ONLY) == 0) ||
+	     (job_ptr->priority < new_prio))) {
 		job_ptr->priority = new_prio;
 		last_job_update = time(NULL);
+		changed = true;
 	}
 
-	debug2("priority for job %u is now %u",
-	       job_ptr->job_id, job_ptr->priority);
+	if (get_log_level() >= LOG_LEVEL_DEBUG2) {
+		debug2("priority for job %u is now %u",
+		       job_ptr->job_id, job_ptr->priority);
+	}
+
+	return changed;
+}
+
+extern int decay_apply_weighted_factors(struct job_record *job_ptr,
+					 time_t *start_time_ptr)
+{
+	/* Always return SUCCESS so that list_for_each will
+	 * continue processing list of jobs. */
+
+	if (!_job_prio_recalc(job_ptr))
+		return SLURM_SUCCESS;
+
+	(void) _set_job_prio(job_ptr, _get_priority_internal(*start_time_ptr,
+							     job_ptr, NULL));
 
 	return SLURM_SUCCESS;
 }
 
+/* vector_for_each_parallel() callback, calculate one job's new priority */
+static int _calc_job_prio(void *x, void *arg)
+{
+	decay_job_prio_t *job_prio = (decay_job_prio_t *) x;
+	time_t *start_time_ptr = (time_t *) arg;
+
+	job_prio->new_prio = _get_priority_internal(
+		*start_time_ptr, job_prio->job_ptr,
+		weight_fs ? &job_prio->priority_fs : NULL);
+
+	return SLURM_SUCCESS;
+}
+
+/*
+ * Recalculate the priority of the jobs in job_prio. The priority factors are
+ * calculated with decay_thread_cnt threads, each writing only to its own
+ * jobs, then the new priorities are set by the calling thread.
+ *
+ * NOTE: The job write lock must be held and no assoc_mgr lock.
+ */
+static void _apply_weighted_factors(vector_t *job_prio,
+				    time_t *start_time_ptr)
+{
+	decay_job_prio_t *prio;
+	assoc_mgr_lock_t locks = { WRITE_LOCK, NO_LOCK, NO_LOCK, NO_LOCK,
+				   NO_LOCK, NO_LOCK, NO_LOCK };
+	uint32_t i, changed = 0;
+	DEF_TIMERS;
+
+	START_TIMER;
+	/*
+	 * Get every job's fairshare factor under one lock rather than one lock
+	 * per job. This can set a user's usage_efctv, which is filled in on
+	 * first use, so it needs a write lock and the threads only read.
+	 */
+	if (weight_fs) {
+		assoc_mgr_lock(&locks);
+		for (i = 0; i < vector_count(job_prio); i++) {
+			prio = vector_get(job_prio, i);
+			if (prio->job_ptr->assoc_ptr) {
+				prio->priority_fs =
+					_get_fairshare_priority_locked(
+						prio->job_ptr);
+			}
+		}
+		assoc_mgr_unlock(&locks);
+	}
+
+	vector_for_each_parallel(job_prio, _calc_job_prio, start_time_ptr,
+				 decay_thread_cnt);
+
+	for (i = 0; i < vector_count(job_prio); i++) {
+		prio = vector_get(job_prio, i);
+		if (_set_job_prio(prio->job_ptr, prio->new_prio))
+			changed++;
+	}
+	END_TIMER;
+
+	debug("%s: priority of %u jobs calculated with %d threads, "
+	      "%u changed %s", __func__, vector_count(job_prio),
+	      decay_thread_cnt, changed, TIME_STR);
+}
+
+static int _queue_job_prio(void *x, void *arg)
+{
+	struct job_record *job_ptr = (struct job_record *) x;
+	vector_t *job_prio = (vector_t *) arg;
+
+	if (_job_prio_recalc(job_ptr))
+		((decay_job_prio_t *) vector_append(job_prio))->job_ptr =
+			job_ptr;
+
+	return SLURM_SUCCESS;
+}
+
+extern void decay_apply_weighted_factors_list(List jobs,
+					      time_t *start_time_ptr)
+{
+	vector_t *job_prio;
+
+	job_prio = vector_create(sizeof(decay_job_prio_t), list_count(jobs));
+	list_for_each(jobs, _queue_job_prio, job_prio);
+	_apply_weighted_factors(job_prio, start_time_ptr);
+	FREE_NULL_VECTOR(job_prio);
+}
+
 
 extern void set_priority_factors(time_t start_time, struct job_record *job_ptr)
+{
+	_set_priority_factors(start_time, job_ptr, NULL);
+}
+
+/*
+ * Set the job's unweighted priority factors
+ * IN priority_fs - job's fairshare factor if already known, else NULL
+ */
+static void _set_priority_factors(time_t start_time,
+				  struct job_record *job_ptr,
+				  double *priority_fs)
 {
 	slurmdb_qos_rec_t *qos_ptr = NULL;
+	double *priority_tres, *tres_weights;
 
 	xassert(job_ptr);
 
@@ -2000,10 +2283,23 @@ extern void set_priority_factors(time_t start_time, struct job_record *job_ptr)
 		job_ptr->prio_factors =
 			xmalloc(sizeof(priority_factors_object_t));
 	} else {
-		xfree(job_ptr->prio_factors->tres_weights);
-		xfree(job_ptr->prio_factors->priority_tres);
+		priority_tres = job_ptr->prio_factors->priority_tres;
+		tres_weights = job_ptr->prio_factors->tres_weights;
+		/* Keep the TRES arrays if they are still the right size */
+		if (!weight_tres ||
+		    (job_ptr->prio_factors->tres_cnt != slurmctld_tres_cnt)) {
+			xfree(priority_tres);
+			xfree(tres_weights);
+		}
 		memset(job_ptr->prio_factors, 0,
 		       sizeof(priority_factors_object_t));
+		if (priority_tres) {
+			memset(priority_tres, 0,
+			       sizeof(double) * slurmctld_tres_cnt);
+			job_ptr->prio_factors->priority_tres = priority_tres;
+			job_ptr->prio_factors->tres_weights = tres_weights;
+			job_ptr->prio_factors->tres_cnt = slurmctld_tres_cnt;
+		}
 	}
 
 	qos_ptr = job_ptr->qos_ptr;
@@ -2034,8 +2330,11 @@ extern void set_priority_factors(time_t start_time, struct job_record *job_ptr)
 	}
 
 	if (job_ptr->assoc_ptr && weight_fs) {
-		job_ptr->prio_factors->priority_fs =
-			_get_fairshare_priority(job_ptr);
+		if (priority_fs)
+			job_ptr->prio_factors->priority_fs = *priority_fs;
+		else
+			job_ptr->prio_factors->priority_fs =
+				_get_fairshare_priority(job_ptr);
 	}
 
 	/* FIXME: this should work off the product of TRESBillingWeights */
@@ -2129,10 +2428,11 @@ extern void set_priority_factors(time_t start_time, struct job_record *job_ptr)
 				xmalloc(sizeof(double) * slurmctld_tres_cnt);
 			job_ptr->prio_factors->tres_weights =
 				xmalloc(sizeof(double) * slurmctld_tres_cnt);
-			memcpy(job_ptr->prio_factors->tres_weights, weight_tres,
-			       sizeof(double) * slurmctld_tres_cnt);
 			job_ptr->prio_factors->tres_cnt = slurmctld_tres_cnt;
 		}
+		/* The weights may have changed since the arrays were made */
+		memcpy(job_ptr->prio_factors->tres_weights, weight_tres,
+		       sizeof(double) * slurmctld_tres_cnt);
 		tres_factors = job_ptr->prio_factors->priority_tres;
 
 		/* can't memcpy because of different types
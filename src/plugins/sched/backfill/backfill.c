@@ -70,6 +70,7 @@
 #include "src/common/assoc_mgr.h"
 #include "src/common/gres.h"
 #include "src/common/list.h"
+#include "src/common/lock_stats.h"
 #include "src/common/macros.h"
 #include "src/common/node_features.h"
 #include "src/common/node_select.h"
@@ -101,6 +102,8 @@
 #define BACKFILL_WINDOW		(24 * 60 * 60)
 #define BF_MAX_USERS		5000
 #define BF_MAX_JOB_ARRAY_RESV	20
+#define BF_NODE_SPACE_RECS	16	/* Initial records per partition group */
+#define BF_NODE_SPACE_TREE_MIN	16	/* Records to AND before using and_tree */
 
 #define SLURMCTLD_THREAD_LIMIT	5
 #define SCHED_TIMEOUT		2000000	/* time in micro-seconds */
@@ -113,6 +116,38 @@ typedef struct node_space_map {
 	int next;	/* next record, by time, zero termination */
 } node_space_map_t;
 
+/*
+ * Partitions which share no nodes with each other can not affect each other's
+ * jobs, so each group of partitions connected by shared nodes has its own
+ * node_space table. Jobs are then only tested against the reservations made
+ * for jobs which could use the same nodes.
+ */
+typedef struct part_group {
+	bitstr_t *node_bitmap;		/* Nodes in the group's partitions */
+	node_space_map_t *node_space;
+	int node_space_recs;		/* Records used in node_space */
+	int node_space_size;		/* Records allocated in node_space */
+	int *time_order;		/* node_space records in time order */
+	int time_order_cnt;
+	/*
+	 * Segment tree over time_order. Leaf tree_size + i is the avail_bitmap
+	 * of record time_order[i], each internal node the AND of its children
+	 * (NULL if it covers no records). Rebuilt on first use after the
+	 * node_space table changes.
+	 */
+	bitstr_t **and_tree;
+	int tree_size;
+	bool tree_valid;
+} part_group_t;
+
+typedef struct part_group_map {
+	part_group_t *group;
+	int group_cnt;
+	struct part_record **part_ptr;	/* Partitions and the group */
+	part_group_t **part_group;	/* each one belongs to */
+	int part_cnt;
+} part_group_map_t;
+
 /*
  * Pack job scheduling structures
  * NOTE: An individial pack job component can be submitted to multiple
@@ -163,6 +198,9 @@ static bool config_flag = false;
 static uint64_t debug_flags = 0;
 static int backfill_interval = BACKFILL_INTERVAL;
 static int bf_max_time = BACKFILL_INTERVAL;
+static int bf_incremental = 0;		/* Max age of bf_job_queue, seconds */
+static vector_t *bf_job_queue = NULL;	/* Job queue kept with bf_incremental */
+static time_t bf_job_queue_time = 0;	/* Time bf_job_queue was built */
 static int backfill_resolution = BACKFILL_RESOLUTION;
 static int backfill_window = BACKFILL_WINDOW;
 static int bf_job_part_count_reserve = 0;
@@ -184,11 +222,14 @@ static int yield_sleep   = YIELD_SLEEP;
 static List pack_job_list = NULL;
 
 /*********************** local functions *********************/
+static void _add_group_reservation(uint32_t start_time, uint32_t end_reserve,
+				   bitstr_t *res_bitmap, part_group_t *group);
 static void _add_reservation(uint32_t start_time, uint32_t end_reserve,
 			     bitstr_t *res_bitmap,
 			     node_space_map_t *node_space,
 			     int *node_space_recs);
 static int  _attempt_backfill(void);
+static vector_t *_build_job_queue(time_t now);
 static int  _clear_job_start_times(void *x, void *arg);
 static int  _clear_qos_blocked_times(void *x, void *arg);
 static void _do_diag_stats(struct timeval *tv1, struct timeval *tv2);
@@ -202,6 +243,16 @@ static void _load_config(void);
 static bool _many_pending_rpcs(void);
 static bool _more_work(time_t last_backfill_time);
 static uint32_t _my_sleep(int usec);
+static void _part_groups_build(part_group_map_t *part_groups,
+			       time_t begin_time, time_t end_time);
+static part_group_t *_part_groups_find(part_group_map_t *part_groups,
+				       struct part_record *part_ptr);
+static void _part_groups_free(part_group_map_t *part_groups);
+static void _node_space_and(part_group_t *group, int first, int last,
+			    bitstr_t *bitmap);
+static int  _node_space_first(part_group_t *group, time_t when);
+static void _node_space_index(part_group_t *group);
+static int  _node_space_last(part_group_t *group, time_t when);
 static int  _num_feature_count(struct job_record *job_ptr, bool *has_xand,
 			       bool *has_xor);
 static int  _pack_find_map(void *x, void *key);
@@ -211,7 +262,7 @@ static void _pack_start_clear(void);
 static time_t _pack_start_find(struct job_record *job_ptr, time_t now);
 static void _pack_start_set(struct job_record *job_ptr, time_t latest_start,
 			    uint32_t comp_time_limit);
-static void _pack_start_test(node_space_map_t *node_space);
+static void _pack_start_test(part_group_map_t *part_groups);
 static void _reset_job_time_limit(struct job_record *job_ptr, time_t now,
 				  node_space_map_t *node_space);
 static int  _start_job(struct job_record *job_ptr, bitstr_t *avail_bitmap);
@@ -625,6 +676,18 @@ static void _load_config(void)
 		bf_max_time = backfill_interval;
 	}
 
+	if (sched_params &&
+	    (tmp_ptr = strstr(sched_params, "bf_incremental="))) {
+		bf_incremental = atoi(tmp_ptr + 15);
+		if (bf_incremental < 0) {
+			error("Invalid SchedulerParameters bf_incremental:"
+			      " %d", bf_incremental);
+			bf_incremental = 0;
+		}
+	} else {
+		bf_incremental = 0;
+	}
+
 	if (sched_params && (tmp_ptr = strstr(sched_params, "bf_window="))) {
 		backfill_window = atoi(tmp_ptr + 10) * 60;  /* mins to secs */
 		if (backfill_window < 1) {
@@ -914,6 +977,7 @@ extern void *backfill_agent(void *args)
 		error("%s: cannot set my name to %s %m", __func__, "backfill");
 	}
 #endif
+	lock_stats_set_caller(LOCK_CALLER_BACKFILL);
 	_load_config();
 	last_backfill_time = time(NULL);
 	pack_job_list = list_create(_pack_map_del);
@@ -957,6 +1021,7 @@ extern void *backfill_agent(void *args)
 		short_sleep = false;
 	}
 	FREE_NULL_LIST(pack_job_list);
+	FREE_NULL_VECTOR(bf_job_queue);
 
 	return NULL;
 }
@@ -1057,10 +1122,53 @@ static bool _job_runnable_now(struct job_record *job_ptr)
 	return true;
 }
 
+/*
+ * Return the sorted job queue for a backfill cycle. With bf_incremental the
+ * queue of the previous cycle is kept and brought up to date, only jobs not
+ * already in it are tested and added. It is built again once older than
+ * bf_incremental seconds or if the partitions or configuration changed.
+ */
+static vector_t *_build_job_queue(time_t now)
+{
+	static time_t config_update = 0, part_update = 0;
+	int changed;
+
+	if (!bf_incremental) {
+		FREE_NULL_VECTOR(bf_job_queue);
+		bf_job_queue = build_job_queue(true, true);
+		sort_job_queue(bf_job_queue);
+		return bf_job_queue;
+	}
+
+	if (bf_job_queue &&
+	    (difftime(now, bf_job_queue_time) < bf_incremental) &&
+	    (config_update == slurmctld_conf.last_update) &&
+	    (part_update == last_part_update)) {
+		changed = update_job_queue(bf_job_queue, true, true);
+		if (changed)
+			sort_job_queue(bf_job_queue);
+		if (debug_flags & DEBUG_FLAG_BACKFILL) {
+			info("backfill: job queue updated, %d records added or reprioritized",
+			     changed);
+		}
+		return bf_job_queue;
+	}
+
+	FREE_NULL_VECTOR(bf_job_queue);
+	bf_job_queue = build_job_queue(true, true);
+	sort_job_queue(bf_job_queue);
+	bf_job_queue_time = now;
+	config_update = slurmctld_conf.last_update;
+	part_update = last_part_update;
+
+	return bf_job_queue;
+}
+
 static int _attempt_backfill(void)
 {
 	DEF_TIMERS;
-	List job_queue;
+	vector_t *job_queue;
+	uint32_t job_queue_inx;
 	job_queue_rec_t *job_queue_rec;
 	int bb, i, j, k, node_space_recs, mcs_select = 0;
 	slurmdb_qos_rec_t *qos_ptr = NULL;
@@ -1075,6 +1183,8 @@ static int _attempt_backfill(void)
 	time_t now, sched_start, later_start, start_res, resv_end, window_end;
 	time_t pack_time, orig_sched_start, orig_start_time = (time_t) 0;
 	node_space_map_t *node_space;
+	part_group_map_t part_groups;
+	part_group_t *part_group;
 	user_part_rec_t *bf_user_part_ptr = NULL;
 	struct timeval bf_time1, bf_time2;
 	int rc = 0, error_code;
@@ -1143,14 +1253,15 @@ static int _attempt_backfill(void)
 	sched_start = orig_sched_start = now = time(NULL);
 	gettimeofday(&start_tv, NULL);
 
-	job_queue = build_job_queue(true, true);
-	job_test_count = list_count(job_queue);
+	job_queue = _build_job_queue(now);
+	job_test_count = vector_count(job_queue);
 	if (job_test_count == 0) {
 		if (debug_flags & DEBUG_FLAG_BACKFILL)
 			info("backfill: no jobs to backfill");
 		else
 			debug("backfill: no jobs to backfill");
-		FREE_NULL_LIST(job_queue);
+		if (!bf_incremental)
+			FREE_NULL_VECTOR(bf_job_queue);
 		return 0;
 	} else {
 		debug("backfill: %u jobs to backfill", job_test_count);
@@ -1162,7 +1273,7 @@ static int _attempt_backfill(void)
 
 	gettimeofday(&bf_time1, NULL);
 
-	slurmctld_diag_stats.bf_queue_len = list_count(job_queue);
+	slurmctld_diag_stats.bf_queue_len = vector_count(job_queue);
 	slurmctld_diag_stats.bf_queue_len_sum += slurmctld_diag_stats.
 						 bf_queue_len;
 	slurmctld_diag_stats.bf_last_depth = 0;
@@ -1170,16 +1281,18 @@ static int _attempt_backfill(void)
 	slurmctld_diag_stats.bf_when_last_cycle = now;
 	slurmctld_diag_stats.bf_active = 1;
 
-	node_space = xmalloc(sizeof(node_space_map_t) *
-			     (max_backfill_job_cnt * 2 + 1));
-	node_space[0].begin_time = sched_start;
 	window_end = sched_start + backfill_window;
-	node_space[0].end_time = window_end;
-	node_space[0].avail_bitmap = bit_copy(avail_node_bitmap);
-	node_space[0].next = 0;
+	_part_groups_build(&part_groups, sched_start, window_end);
+	/* Records in all partition group tables, counted as one table */
 	node_space_recs = 1;
-	if (debug_flags & DEBUG_FLAG_BACKFILL_MAP)
-		_dump_node_space_table(node_space);
+	if (debug_flags & DEBUG_FLAG_BACKFILL) {
+		info("backfill: %d partition groups with disjoint nodes",
+		     part_groups.group_cnt);
+	}
+	if (debug_flags & DEBUG_FLAG_BACKFILL_MAP) {
+		for (i = 0; i < part_groups.group_cnt; i++)
+			_dump_node_space_table(part_groups.group[i].node_space);
+	}
 
 	if (bf_job_part_count_reserve || max_backfill_job_per_part) {
 		ListIterator part_iterator;
@@ -1226,23 +1339,22 @@ static int _attempt_backfill(void)
 		assoc_mgr_unlock(&qos_read_lock);
 	}
 
-	sort_job_queue(job_queue);
-	while (1) {
+	/* Records are kept for the next cycle with bf_incremental */
+	for (job_queue_inx = 0; ; job_queue_inx++) {
 		uint32_t bf_job_id, bf_array_task_id, bf_job_priority;
 
-		job_queue_rec = (job_queue_rec_t *) list_pop(job_queue);
-		if (!job_queue_rec) {
+		if (job_queue_inx >= vector_count(job_queue)) {
 			if (debug_flags & DEBUG_FLAG_BACKFILL)
 				info("backfill: reached end of job queue");
 			break;
 		}
+		job_queue_rec = vector_get(job_queue, job_queue_inx);
 
 		job_ptr          = job_queue_rec->job_ptr;
 		part_ptr         = job_queue_rec->part_ptr;
 		bf_job_id        = job_queue_rec->job_id;
 		bf_job_priority  = job_queue_rec->priority;
 		bf_array_task_id = job_queue_rec->array_task_id;
-		xfree(job_queue_rec);
 
 		if (slurmctld_config.shutdown_time ||
 		    (difftime(time(NULL),orig_sched_start) >= bf_max_time)){
@@ -1446,6 +1558,9 @@ next_task:
 				continue;
 		}
 		job_ptr->part_ptr = part_ptr;
+		if (!(part_group = _part_groups_find(&part_groups, part_ptr)))
+			continue;	/* Partition added during lock yield */
+		node_space = part_group->node_space;
 
 		if (debug_flags & DEBUG_FLAG_BACKFILL) {
 			char job_id_str[64];
@@ -1804,20 +1919,14 @@ next_task:
 		bit_and(avail_bitmap, up_node_bitmap);
 		filter_by_node_owner(job_ptr, avail_bitmap);
 		filter_by_node_mcs(job_ptr, mcs_select, avail_bitmap);
-		for (j = 0; ; ) {
-			if ((node_space[j].end_time > start_res) &&
-			     node_space[j].next && (later_start == 0))
-				later_start = node_space[j].end_time;
-			if (node_space[j].end_time <= start_res)
-				;
-			else if (node_space[j].begin_time <= end_time) {
-				bit_and(avail_bitmap,
-					node_space[j].avail_bitmap);
-			} else
-				break;
-			if ((j = node_space[j].next) == 0)
-				break;
-		}
+		j = _node_space_first(part_group, start_res);
+		if (j < (part_group->time_order_cnt - 1)) {
+			later_start = node_space[part_group->time_order[j]].
+				      end_time;
+		}
+		_node_space_and(part_group, j,
+				_node_space_last(part_group, end_time),
+				avail_bitmap);
 		if (resv_end && (++resv_end < window_end) &&
 		    ((later_start == 0) || (resv_end < later_start))) {
 			later_start = resv_end;
@@ -1922,19 +2031,11 @@ next_task:
 			orig_end_time = end_time;
 			end_time += boot_time;
 
-			for (j = 0; ; ) {
-				if (node_space[j].end_time <= start_res)
-					;
-				else if (node_space[j].begin_time <= end_time) {
-					if (node_space[j].begin_time >
-					    orig_end_time)
-						bit_and(avail_bitmap,
-						node_space[j].avail_bitmap);
-				} else
-					break;
-				if ((j = node_space[j].next) == 0)
-					break;
-			}
+			j = MAX(_node_space_first(part_group, start_res),
+				_node_space_last(part_group, orig_end_time) + 1);
+			_node_space_and(part_group, j,
+					_node_space_last(part_group, end_time),
+					avail_bitmap);
 		}
 		if (test_fini != 1) {
 			/* Either active_bitmap was NULL or not usable by the
@@ -2338,8 +2439,11 @@ skip_start:
 		xfree(job_ptr->sched_nodes);
 		job_ptr->sched_nodes = bitmap2node_name(avail_bitmap);
 		bit_not(avail_bitmap);
-		_add_reservation(start_time, end_reserve,
-				 avail_bitmap, node_space, &node_space_recs);
+		node_space_recs -= part_group->node_space_recs;
+		_add_group_reservation(start_time, end_reserve,
+				       avail_bitmap, part_group);
+		node_space_recs += part_group->node_space_recs;
+		node_space = part_group->node_space;
 		if (debug_flags & DEBUG_FLAG_BACKFILL_MAP)
 			_dump_node_space_table(node_space);
 		if ((orig_start_time != 0) &&
@@ -2362,7 +2466,7 @@ skip_start:
 	}
 
 	_job_pack_deadlock_fini();
-	_pack_start_test(node_space);
+	_pack_start_test(&part_groups);
 
 	xfree(bf_part_jobs);
 	xfree(bf_part_resv);
@@ -2380,13 +2484,9 @@ skip_start:
 	FREE_NULL_BITMAP(exc_core_bitmap);
 	FREE_NULL_BITMAP(resv_bitmap);
 
-	for (i = 0; ; ) {
-		FREE_NULL_BITMAP(node_space[i].avail_bitmap);
-		if ((i = node_space[i].next) == 0)
-			break;
-	}
-	xfree(node_space);
-	FREE_NULL_LIST(job_queue);
+	_part_groups_free(&part_groups);
+	if (!bf_incremental)
+		FREE_NULL_VECTOR(bf_job_queue);
 
 	gettimeofday(&bf_time2, NULL);
 	_do_diag_stats(&bf_time1, &bf_time2);
@@ -2580,6 +2680,274 @@ static bool _more_work (time_t last_backfill_time)
 	return rc;
 }
 
+/*
+ * Build the partition groups for a backfill cycle, each with a node_space
+ * table covering the time from begin_time to end_time
+ */
+static void _part_groups_build(part_group_map_t *part_groups,
+			       time_t begin_time, time_t end_time)
+{
+	ListIterator part_iterator;
+	struct part_record *part_ptr;
+	part_group_t *group, *merged;
+	int i, j;
+
+	memset(part_groups, 0, sizeof(part_group_map_t));
+	part_groups->part_cnt = list_count(part_list);
+	part_groups->part_ptr = xmalloc(sizeof(struct part_record *) *
+					part_groups->part_cnt);
+	part_groups->part_group = xmalloc(sizeof(part_group_t *) *
+					  part_groups->part_cnt);
+	part_groups->group = xmalloc(sizeof(part_group_t) *
+				     (part_groups->part_cnt + 1));
+
+	/* Merge groups as partitions found to share their nodes are added */
+	i = 0;
+	part_iterator = list_iterator_create(part_list);
+	while ((part_ptr = (struct part_record *) list_next(part_iterator))) {
+		part_groups->part_ptr[i++] = part_ptr;
+		if (!part_ptr->node_bitmap)
+			continue;
+		merged = NULL;
+		for (j = 0; j < part_groups->group_cnt; ) {
+			group = &part_groups->group[j];
+			if (!bit_overlap(group->node_bitmap,
+					 part_ptr->node_bitmap)) {
+				j++;
+			} else if (!merged) {
+				bit_or(group->node_bitmap,
+				       part_ptr->node_bitmap);
+				merged = group;
+				j++;
+			} else {
+				bit_or(merged->node_bitmap,
+				       group->node_bitmap);
+				FREE_NULL_BITMAP(group->node_bitmap);
+				*group = part_groups->group[
+					--part_groups->group_cnt];
+			}
+		}
+		if (!merged) {
+			group = &part_groups->group[part_groups->group_cnt++];
+			group->node_bitmap = bit_copy(part_ptr->node_bitmap);
+		}
+	}
+	list_iterator_destroy(part_iterator);
+	if (part_groups->group_cnt == 0) {
+		group = &part_groups->group[part_groups->group_cnt++];
+		group->node_bitmap = bit_alloc(node_record_count);
+	}
+
+	for (i = 0; i < part_groups->part_cnt; i++) {
+		part_ptr = part_groups->part_ptr[i];
+		part_groups->part_group[i] = &part_groups->group[0];
+		if (!part_ptr->node_bitmap)
+			continue;
+		for (j = 0; j < part_groups->group_cnt; j++) {
+			group = &part_groups->group[j];
+			if (bit_overlap(group->node_bitmap,
+					part_ptr->node_bitmap)) {
+				part_groups->part_group[i] = group;
+				break;
+			}
+		}
+	}
+
+	for (j = 0; j < part_groups->group_cnt; j++) {
+		group = &part_groups->group[j];
+		group->node_space_size = BF_NODE_SPACE_RECS;
+		group->node_space = xmalloc(sizeof(node_space_map_t) *
+					    group->node_space_size);
+		group->time_order = xmalloc(sizeof(int) *
+					    group->node_space_size);
+		group->node_space[0].begin_time = begin_time;
+		group->node_space[0].end_time = end_time;
+		group->node_space[0].avail_bitmap =
+			bit_copy(avail_node_bitmap);
+		group->node_space[0].next = 0;
+		group->node_space_recs = 1;
+		_node_space_index(group);
+	}
+}
+
+/* Return the group of a partition, NULL if not known when groups were built */
+static part_group_t *_part_groups_find(part_group_map_t *part_groups,
+				       struct part_record *part_ptr)
+{
+	int i;
+
+	for (i = 0; i < part_groups->part_cnt; i++) {
+		if (part_groups->part_ptr[i] == part_ptr)
+			return part_groups->part_group[i];
+	}
+	return NULL;
+}
+
+static void _part_groups_free(part_group_map_t *part_groups)
+{
+	node_space_map_t *node_space;
+	int i, j;
+
+	for (j = 0; j < part_groups->group_cnt; j++) {
+		node_space = part_groups->group[j].node_space;
+		for (i = 0; ; ) {
+			FREE_NULL_BITMAP(node_space[i].avail_bitmap);
+			if ((i = node_space[i].next) == 0)
+				break;
+		}
+		xfree(node_space);
+		FREE_NULL_BITMAP(part_groups->group[j].node_bitmap);
+		for (i = 1; i < part_groups->group[j].tree_size; i++)
+			FREE_NULL_BITMAP(part_groups->group[j].and_tree[i]);
+		xfree(part_groups->group[j].and_tree);
+		xfree(part_groups->group[j].time_order);
+	}
+	xfree(part_groups->group);
+	xfree(part_groups->part_ptr);
+	xfree(part_groups->part_group);
+}
+
+/* Create a reservation for a job in its partition group's node_space table */
+static void _add_group_reservation(uint32_t start_time, uint32_t end_reserve,
+				   bitstr_t *res_bitmap, part_group_t *group)
+{
+	/* _add_reservation() adds at most two records */
+	if ((group->node_space_recs + 2) > group->node_space_size) {
+		group->node_space_size *= 2;
+		xrealloc(group->node_space, sizeof(node_space_map_t) *
+					    group->node_space_size);
+		xrealloc(group->time_order, sizeof(int) *
+					    group->node_space_size);
+	}
+	_add_reservation(start_time, end_reserve, res_bitmap,
+			 group->node_space, &group->node_space_recs);
+	_node_space_index(group);
+}
+
+/* Rebuild time_order after the group's node_space table changes */
+static void _node_space_index(part_group_t *group)
+{
+	int i, j;
+
+	for (i = 0, j = 0; ; i++) {
+		group->time_order[i] = j;
+		if ((j = group->node_space[j].next) == 0)
+			break;
+	}
+	group->time_order_cnt = i + 1;
+	group->tree_valid = false;
+}
+
+/*
+ * Return position in time_order of the first record ending after "when",
+ * time_order_cnt if none
+ */
+static int _node_space_first(part_group_t *group, time_t when)
+{
+	int lo = 0, hi = group->time_order_cnt, mid;
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (group->node_space[group->time_order[mid]].end_time > when)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	return lo;
+}
+
+/*
+ * Return position in time_order of the last record beginning no later than
+ * "when", -1 if none
+ */
+static int _node_space_last(part_group_t *group, time_t when)
+{
+	int lo = 0, hi = group->time_order_cnt, mid;
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (group->node_space[group->time_order[mid]].begin_time > when)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	return lo - 1;
+}
+
+static void _node_space_tree_build(part_group_t *group)
+{
+	bitstr_t **tree, *left, *right;
+	int i, size = 1;
+
+	while (size < group->time_order_cnt)
+		size *= 2;
+	if (size != group->tree_size) {
+		for (i = 1; i < group->tree_size; i++)
+			FREE_NULL_BITMAP(group->and_tree[i]);
+		xfree(group->and_tree);
+		group->and_tree = xmalloc(sizeof(bitstr_t *) * size * 2);
+		group->tree_size = size;
+	}
+	tree = group->and_tree;
+
+	for (i = 0; i < size; i++) {
+		if (i < group->time_order_cnt) {
+			tree[size + i] = group->node_space[
+				group->time_order[i]].avail_bitmap;
+		} else
+			tree[size + i] = NULL;
+	}
+	for (i = size - 1; i > 0; i--) {
+		left  = tree[i * 2];
+		right = tree[i * 2 + 1];
+		if (!left && !right) {
+			FREE_NULL_BITMAP(tree[i]);
+			continue;
+		}
+		if (!tree[i])
+			tree[i] = bit_alloc(node_record_count);
+		bit_copybits(tree[i], left ? left : right);
+		if (left && right)
+			bit_and(tree[i], right);
+	}
+	group->tree_valid = true;
+}
+
+/*
+ * AND into bitmap the avail_bitmap of records at positions first through
+ * last of time_order. Long ranges use and_tree, touching O(log n) bitmaps.
+ */
+static void _node_space_and(part_group_t *group, int first, int last,
+			    bitstr_t *bitmap)
+{
+	bitstr_t **tree;
+	int i;
+
+	if ((last - first + 1) < BF_NODE_SPACE_TREE_MIN) {
+		for (i = first; i <= last; i++) {
+			bit_and(bitmap, group->node_space[
+					group->time_order[i]].avail_bitmap);
+		}
+		return;
+	}
+
+	if (!group->tree_valid)
+		_node_space_tree_build(group);
+	tree = group->and_tree;
+	first += group->tree_size;
+	last  += group->tree_size + 1;
+	for ( ; first < last; first /= 2, last /= 2) {
+		if (first & 1) {
+			bit_and(bitmap, tree[first]);
+			first++;
+		}
+		if (last & 1) {
+			last--;
+			bit_and(bitmap, tree[last]);
+		}
+	}
+}
+
 /* Create a reservation for a job in the future */
 static void _add_reservation(uint32_t start_time, uint32_t end_reserve,
 			     bitstr_t *res_bitmap,
@@ -2688,8 +3056,9 @@ static bool _test_resv_overlap(node_space_map_t *node_space,
 	int j;
 
 	for (j=0; ; ) {
+		if (node_space[j].begin_time >= end_reserve)
+			break;		/* Records are in time order */
 		if ((node_space[j].end_time   > start_time) &&
-		    (node_space[j].begin_time < end_reserve) &&
 		    (!bit_super_set(use_bitmap, node_space[j].avail_bitmap))) {
 			overlap = true;
 			break;
@@ -3051,9 +3420,11 @@ static bool _pack_job_limit_check(pack_job_map_t *map, time_t now)
 /*
  * Start all components of a pack job now
  */
-static int _pack_start_now(pack_job_map_t *map, node_space_map_t *node_space)
+static int _pack_start_now(pack_job_map_t *map,
+			   part_group_map_t *part_groups)
 {
 	struct job_record *job_ptr;
+	part_group_t *part_group;
 	bitstr_t *avail_bitmap = NULL, *exc_core_bitmap = NULL;
 	bitstr_t *resv_bitmap = NULL, *used_bitmap = NULL;
 	pack_job_rec_t *rec;
@@ -3149,8 +3520,11 @@ static int _pack_start_now(pack_job_map_t *map, node_space_map_t *node_space)
 			 * Only set if start_time. end_time must be set
 			 * beforehand for _reset_job_time_limit.
 			 */
-			if (reset_time)
-				_reset_job_time_limit(job_ptr, now, node_space);
+			if (reset_time &&
+			    (part_group = _part_groups_find(part_groups,
+							    job_ptr->part_ptr)))
+				_reset_job_time_limit(job_ptr, now,
+						      part_group->node_space);
 		}
 		if (reset_time)
 			jobacct_storage_job_start_direct(acct_db_conn, job_ptr);
@@ -3209,7 +3583,7 @@ static void _pack_kill_now(pack_job_map_t *map)
 /*
  * If all components of a pack job can start now, then do so
  */
-static void _pack_start_test(node_space_map_t *node_space)
+static void _pack_start_test(part_group_map_t *part_groups)
 {
 	ListIterator iter;
 	pack_job_map_t *map;
@@ -3250,7 +3624,7 @@ static void _pack_start_test(node_space_map_t *node_space)
 			info("Attempting to start pack job %u",
 			     map->pack_job_id);
 		}
-		rc = _pack_start_now(map, node_space);
+		rc = _pack_start_now(map, part_groups);
 		if (rc != SLURM_SUCCESS) {
 			if (debug_flags & DEBUG_FLAG_HETERO_JOBS) {
 				info("Failed to start pack job %u",
@@ -100,9 +100,20 @@ int main(int argc, char **argv)
 	exit(rc);
 }
 
+static void _print_hist(char *name, uint32_t *hist, uint32_t hist_cnt)
+{
+	int i;
+
+	printf("\t\t%s histogram:", name);
+	for (i = 0; i < hist_cnt; i++)
+		printf(" %u", hist[i]);
+	printf("\n");
+}
+
 static int _print_stats(void)
 {
 	int i;
+	uint64_t bound, count;
 
 	if (!buf) {
 		printf("No data available. Probably slurmctld is not working\n");
@@ -182,13 +193,99 @@ static int _print_stats(void)
 		       buf->bf_queue_len_sum / buf->bf_cycle_counter);
 	}
 
+	if (buf->job_hash_cnt)
+		printf("\nJob hash tables\n");
+	for (i = 0; i < buf->job_hash_cnt; i++) {
+		printf("\t%-14s slots:%-8u records:%-8u lookups:%-10"PRIu64
+		       " mean probes:%.2f max probes:%u resizes:%u\n",
+		       buf->job_hash_name[i], buf->job_hash_size[i],
+		       buf->job_hash_records[i], buf->job_hash_lookups[i],
+		       buf->job_hash_lookups[i] ?
+		       ((double) buf->job_hash_probes[i] /
+			buf->job_hash_lookups[i]) : 0.0,
+		       buf->job_hash_probe_max[i], buf->job_hash_resizes[i]);
+	}
+
+	if (buf->lock_stat_cnt) {
+		printf("\nLock statistics (microseconds)\n");
+		printf("\tHistogram buckets:");
+		for (i = 0, bound = 10; i < buf->lock_stat_hist_cnt;
+		     i++, bound *= 10) {
+			if (i < (buf->lock_stat_hist_cnt - 1))
+				printf(" <%"PRIu64, bound);
+			else
+				printf(" >=%"PRIu64, bound / 10);
+		}
+		printf("\n");
+	}
+	for (i = 0; i < buf->lock_stat_cnt; i++) {
+		count = buf->lock_stat_count[i];
+		printf("\t%-24s count:%-8"PRIu64" "
+		       "wait ave:%-6"PRIu64" max:%-8"PRIu64" "
+		       "hold ave:%-6"PRIu64" max:%"PRIu64"\n",
+		       buf->lock_stat_name[i], count,
+		       count ? (buf->lock_stat_wait_time[i] / count) : 0,
+		       buf->lock_stat_wait_max[i],
+		       count ? (buf->lock_stat_hold_time[i] / count) : 0,
+		       buf->lock_stat_hold_max[i]);
+		_print_hist("wait", &buf->lock_stat_wait_hist[
+				    i * buf->lock_stat_hist_cnt],
+			    buf->lock_stat_hist_cnt);
+		_print_hist("hold", &buf->lock_stat_hold_hist[
+				    i * buf->lock_stat_hist_cnt],
+			    buf->lock_stat_hist_cnt);
+	}
+
+	printf("\nCredential signing statistics (microseconds)\n");
+	printf("\tSigned:      %"PRIu64"\n", buf->cred_sign_cnt);
+	printf("\tBatches:     %"PRIu64"\n", buf->cred_sign_batch_cnt);
+	printf("\tFailures:    %"PRIu64"\n", buf->cred_sign_fail_cnt);
+	if (buf->cred_sign_cnt) {
+		printf("\tMean time:   %"PRIu64"\n",
+		       buf->cred_sign_time / buf->cred_sign_cnt);
+	}
+	printf("\tMax time:    %"PRIu64"\n", buf->cred_sign_max);
+	if (buf->cred_sign_time) {
+		printf("\tPer second:  %.1f\n",
+		       (double) buf->cred_sign_cnt * 1000000 /
+		       buf->cred_sign_time);
+	}
+	printf("\tWaiting:     %u\n", buf->cred_sign_queue);
+
+	printf("\nDBD agent statistics (microseconds)\n");
+	printf("\tQueue size:  %u\n", buf->dbd_agent_queue_size);
+	printf("\tQueue max:   %u\n", buf->dbd_agent_queue_max);
+	printf("\tSent:        %"PRIu64"\n", buf->dbd_agent_sent_cnt);
+	printf("\tBatches:     %"PRIu64"\n", buf->dbd_agent_batch_cnt);
+	printf("\tCoalesced:   %"PRIu64"\n", buf->dbd_agent_coalesced_cnt);
+	if (buf->dbd_agent_sent_cnt) {
+		printf("\tLatency ave: %"PRIu64"\n",
+		       buf->dbd_agent_latency_time / buf->dbd_agent_sent_cnt);
+	}
+	printf("\tLatency max: %"PRIu64"\n", buf->dbd_agent_latency_max);
+	if (buf->dbd_agent_hist_cnt) {
+		printf("\tLatency histogram buckets (milliseconds):");
+		for (i = 0, bound = 10; i < buf->dbd_agent_hist_cnt;
+		     i++, bound *= 10) {
+			if (i < (buf->dbd_agent_hist_cnt - 1))
+				printf(" <%"PRIu64, bound);
+			else
+				printf(" >=%"PRIu64, bound / 10);
+		}
+		printf("\n");
+		_print_hist("latency", buf->dbd_agent_latency_hist,
+			    buf->dbd_agent_hist_cnt);
+	}
+
 	printf("\nRemote Procedure Call statistics by message type\n");
 	for (i = 0; i < buf->rpc_type_size; i++) {
 		printf("\t%-40s(%5u) count:%-6u "
-		       "ave_time:%-6u total_time:%"PRIu64"\n",
+		       "ave_time:%-6u total_time:%-10"PRIu64" "
+		       "lock_wait:%"PRIu64"\n",
 		       rpc_num2string(buf->rpc_type_id[i]),
 		       buf->rpc_type_id[i], buf->rpc_type_cnt[i],
-		       rpc_type_ave_time[i], buf->rpc_type_time[i]);
+		       rpc_type_ave_time[i], buf->rpc_type_time[i],
+		       buf->rpc_type_lock_wait[i]);
 	}
 
 	printf("\nRemote Procedure Call statistics by user\n");
@@ -208,10 +305,15 @@ static void _sort_rpc(void)
 	int i, j;
 	uint16_t type_id;
 	uint32_t type_ave, type_cnt, user_ave, user_cnt, user_id;
-	uint64_t type_time, user_time;
+	uint64_t type_time, type_wait, user_time;
 
 	rpc_type_ave_time = xmalloc(sizeof(uint32_t) * buf->rpc_type_size);
 	rpc_user_ave_time = xmalloc(sizeof(uint32_t) * buf->rpc_user_size);
+	/* Not reported by older versions of slurmctld */
+	if (!buf->rpc_type_lock_wait) {
+		buf->rpc_type_lock_wait = xmalloc(sizeof(uint64_t) *
+						  buf->rpc_type_size);
+	}
 
 	if (sort_by_id) {
 		for (i = 0; i < buf->rpc_type_size; i++) {
@@ -221,12 +323,16 @@ static void _sort_rpc(void)
 				type_id   = buf->rpc_type_id[i];
 				type_cnt  = buf->rpc_type_cnt[i];
 				type_time = buf->rpc_type_time[i];
+				type_wait = buf->rpc_type_lock_wait[i];
 				buf->rpc_type_id[i]   = buf->rpc_type_id[j];
 				buf->rpc_type_cnt[i]  = buf->rpc_type_cnt[j];
 				buf->rpc_type_time[i] = buf->rpc_type_time[j];
+				buf->rpc_type_lock_wait[i] =
+					buf->rpc_type_lock_wait[j];
 				buf->rpc_type_id[j]   = type_id;
 				buf->rpc_type_cnt[j]  = type_cnt;
 				buf->rpc_type_time[j] = type_time;
+				buf->rpc_type_lock_wait[j] = type_wait;
 			}
 			if (buf->rpc_type_cnt[i]) {
 				rpc_type_ave_time[i] = buf->rpc_type_time[i] /
@@ -260,12 +366,16 @@ static void _sort_rpc(void)
 				type_id   = buf->rpc_type_id[i];
 				type_cnt  = buf->rpc_type_cnt[i];
 				type_time = buf->rpc_type_time[i];
+				type_wait = buf->rpc_type_lock_wait[i];
 				buf->rpc_type_id[i]   = buf->rpc_type_id[j];
 				buf->rpc_type_cnt[i]  = buf->rpc_type_cnt[j];
 				buf->rpc_type_time[i] = buf->rpc_type_time[j];
+				buf->rpc_type_lock_wait[i] =
+					buf->rpc_type_lock_wait[j];
 				buf->rpc_type_id[j]   = type_id;
 				buf->rpc_type_cnt[j]  = type_cnt;
 				buf->rpc_type_time[j] = type_time;
+				buf->rpc_type_lock_wait[j] = type_wait;
 			}
 			if (buf->rpc_type_cnt[i]) {
 				rpc_type_ave_time[i] = buf->rpc_type_time[i] /
@@ -306,14 +416,18 @@ static void _sort_rpc(void)
 				type_id   = buf->rpc_type_id[i];
 				type_cnt  = buf->rpc_type_cnt[i];
 				type_time = buf->rpc_type_time[i];
+				type_wait = buf->rpc_type_lock_wait[i];
 				rpc_type_ave_time[i]  = rpc_type_ave_time[j];
 				buf->rpc_type_id[i]   = buf->rpc_type_id[j];
 				buf->rpc_type_cnt[i]  = buf->rpc_type_cnt[j];
 				buf->rpc_type_time[i] = buf->rpc_type_time[j];
+				buf->rpc_type_lock_wait[i] =
+					buf->rpc_type_lock_wait[j];
 				rpc_type_ave_time[j]  = type_ave;
 				buf->rpc_type_id[j]   = type_id;
 				buf->rpc_type_cnt[j]  = type_cnt;
 				buf->rpc_type_time[j] = type_time;
+				buf->rpc_type_lock_wait[j] = type_wait;
 			}
 		}
 		for (i = 0; i < buf->rpc_user_size; i++) {
@@ -348,12 +462,16 @@ static void _sort_rpc(void)
 				type_id   = buf->rpc_type_id[i];
 				type_cnt  = buf->rpc_type_cnt[i];
 				type_time = buf->rpc_type_time[i];
+				type_wait = buf->rpc_type_lock_wait[i];
 				buf->rpc_type_id[i]   = buf->rpc_type_id[j];
 				buf->rpc_type_cnt[i]  = buf->rpc_type_cnt[j];
 				buf->rpc_type_time[i] = buf->rpc_type_time[j];
+				buf->rpc_type_lock_wait[i] =
+					buf->rpc_type_lock_wait[j];
 				buf->rpc_type_id[j]   = type_id;
 				buf->rpc_type_cnt[j]  = type_cnt;
 				buf->rpc_type_time[j] = type_time;
+				buf->rpc_type_lock_wait[j] = type_wait;
 			}
 			if (buf->rpc_type_cnt[i]) {
 				rpc_type_ave_time[i] = buf->rpc_type_time[i] /
@@ -36,13 +36,17 @@
  *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
 \*****************************************************************************/
 
+#include <pthread.h>
+
 #include "slurm/slurm_errno.h"
 
 #include "src/common/assoc_mgr.h"
 #include "src/common/slurm_accounting_storage.h"
+#include "src/common/tres_array.h"
 
 #include "src/slurmctld/slurmctld.h"
 #include "src/slurmctld/acct_policy.h"
+#include "src/slurmctld/job_hash.h"
 #include "src/common/node_select.h"
 #include "src/common/slurm_priority.h"
 
@@ -69,6 +73,30 @@ typedef struct pack_limits {
 	slurmdb_qos_rec_t *qos_ptr_2;
 } pack_limits_t;
 
+/*
+ * Index of the records of a QOS's acct_limit_list or user_limit_list.
+ * Records are only ever added to those lists, never removed, so an index is
+ * current as long as it was built for the same list and has seen as many
+ * records as the list holds.
+ */
+typedef struct {
+	List list;		/* list indexed, do not free */
+	int count;		/* records of list in hash */
+	job_hash_t *hash;	/* key -> slurmdb_used_limits_t */
+} used_limits_index_t;
+
+typedef struct {
+	used_limits_index_t acct;	/* keyed by hash of account name */
+	used_limits_index_t user;	/* keyed by user ID */
+} qos_limits_index_t;
+
+/*
+ * Used limits are looked up under assoc_mgr read locks by several threads,
+ * so the indexes have a lock of their own. Each QOS's index is kept in its
+ * usage record and freed with the lists it indexes.
+ */
+static pthread_mutex_t limits_index_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 static int _get_tres_state_reason(int tres_pos, int unk_reason)
 {
 	switch (tres_pos) {
@@ -414,24 +442,108 @@ static int _find_used_limits_for_acct(void *x, void *key)
 	return 0;
 }
 
-/* Checks for record in *user_limit_list of user_id if
- * *user_limit_list doesn't exist it will create it, if the user_id
+static uint64_t _acct_key(char *acct)
+{
+	uint64_t key = 14695981039346656037ULL;	/* FNV-1a */
+
+	if (!acct)
+		return 0;
+	for (; *acct; acct++) {
+		key ^= (unsigned char) *acct;
+		key *= 1099511628211ULL;
+	}
+	return key;
+}
+
+static uint64_t _used_limits_key(slurmdb_used_limits_t *used_limits)
+{
+	if (used_limits->acct)
+		return _acct_key(used_limits->acct);
+	return used_limits->uid;
+}
+
+/* Free a QOS's index, called by slurmdb_destroy_qos_usage() */
+static void _free_limits_index(void *x)
+{
+	qos_limits_index_t *qos_index = (qos_limits_index_t *) x;
+
+	if (qos_index) {
+		job_hash_destroy(qos_index->acct.hash);
+		job_hash_destroy(qos_index->user.hash);
+		xfree(qos_index);
+	}
+}
+
+/*
+ * Return the index of list, bringing it up to date if records were added to
+ * the list elsewhere or the list was replaced.
+ * limits_index_mutex must be locked.
+ */
+static used_limits_index_t *_get_limits_index(slurmdb_qos_rec_t *qos_ptr,
+					      List list, bool acct)
+{
+	qos_limits_index_t *qos_index;
+	used_limits_index_t *index;
+	slurmdb_used_limits_t *used_limits;
+	ListIterator itr;
+	int i, count;
+
+	if (!(qos_index = qos_ptr->usage->limits_index)) {
+		qos_index = xmalloc(sizeof(qos_limits_index_t));
+		qos_ptr->usage->limits_index = qos_index;
+		qos_ptr->usage->limits_index_free = _free_limits_index;
+	}
+	index = acct ? &qos_index->acct : &qos_index->user;
+
+	count = list_count(list);
+	if ((index->list != list) || (index->count > count)) {
+		job_hash_destroy(index->hash);
+		index->hash = job_hash_create(
+			acct ? "acct_limits" : "user_limits", count);
+		index->list = list;
+		index->count = 0;
+	}
+	if (index->count < count) {
+		itr = list_iterator_create(list);
+		for (i = 0; (used_limits = list_next(itr)); i++) {
+			if (i < index->count)
+				continue;
+			job_hash_insert(index->hash,
+					_used_limits_key(used_limits),
+					used_limits);
+		}
+		list_iterator_destroy(itr);
+		index->count = i;
+	}
+
+	return index;
+}
+
+/* Checks for record in qos_ptr's acct_limit_list of acct if
+ * the acct_limit_list doesn't exist it will create it, if the acct
  * record doesn't exist it will add it to the list.
- * In all cases the user record is returned.
+ * In all cases the acct record is returned.
  */
 static slurmdb_used_limits_t *_get_acct_used_limits(
-	List *acct_limit_list, char *acct)
+	slurmdb_qos_rec_t *qos_ptr, char *acct)
 {
+	List *acct_limit_list = &qos_ptr->usage->acct_limit_list;
+	used_limits_index_t *index;
 	slurmdb_used_limits_t *used_limits;
 
-	xassert(acct_limit_list);
-
+	slurm_mutex_lock(&limits_index_mutex);
 	if (!*acct_limit_list)
 		*acct_limit_list = list_create(slurmdb_destroy_used_limits);
 
-	if (!(used_limits = list_find_first(*acct_limit_list,
-					    _find_used_limits_for_acct,
-					    acct))) {
+	index = _get_limits_index(qos_ptr, *acct_limit_list, true);
+	used_limits = job_hash_find(index->hash, _acct_key(acct));
+	if (used_limits && xstrcmp(used_limits->acct, acct)) {
+		/* Account names with the same hash, search the list */
+		used_limits = list_find_first(*acct_limit_list,
+					      _find_used_limits_for_acct,
+					      acct);
+	}
+	if (!used_limits) {
 		int i = sizeof(uint64_t) * slurmctld_tres_cnt;
 
 		used_limits = xmalloc(sizeof(slurmdb_used_limits_t));
@@ -441,40 +553,32 @@ static slurmdb_used_limits_t *_get_acct_used_limits(
 		used_limits->tres_run_mins = xmalloc(i);
 
 		list_append(*acct_limit_list, used_limits);
+		job_hash_insert(index->hash, _acct_key(acct), used_limits);
+		index->count++;
 	}
+	slurm_mutex_unlock(&limits_index_mutex);
 
 	return used_limits;
 }
 
-static int _find_used_limits_for_user(void *x, void *key)
-{
-	slurmdb_used_limits_t *used_limits = (slurmdb_used_limits_t *)x;
-	uint32_t user_id = *(uint32_t *)key;
-
-	if (used_limits->uid == user_id)
-		return 1;
-
-	return 0;
-}
-
-/* Checks for record in *user_limit_list of user_id if
- * *user_limit_list doesn't exist it will create it, if the user_id
+/* Checks for record in qos_ptr's user_limit_list of user_id if
+ * the user_limit_list doesn't exist it will create it, if the user_id
  * record doesn't exist it will add it to the list.
  * In all cases the user record is returned.
  */
 static slurmdb_used_limits_t *_get_user_used_limits(
-	List *user_limit_list, uint32_t user_id)
+	slurmdb_qos_rec_t *qos_ptr, uint32_t user_id)
 {
+	List *user_limit_list = &qos_ptr->usage->user_limit_list;
+	used_limits_index_t *index;
 	slurmdb_used_limits_t *used_limits;
 
-	xassert(user_limit_list);
-
+	slurm_mutex_lock(&limits_index_mutex);
 	if (!*user_limit_list)
 		*user_limit_list = list_create(slurmdb_destroy_used_limits);
 
-	if (!(used_limits = list_find_first(*user_limit_list,
-					    _find_used_limits_for_user,
-					    &user_id))) {
+	index = _get_limits_index(qos_ptr, *user_limit_list, false);
+	if (!(used_limits = job_hash_find(index->hash, user_id))) {
 		int i = sizeof(uint64_t) * slurmctld_tres_cnt;
 
 		used_limits = xmalloc(sizeof(slurmdb_used_limits_t));
@@ -484,7 +588,10 @@ static slurmdb_used_limits_t *_get_user_used_limits(
 		used_limits->tres_run_mins = xmalloc(i);
 
 		list_append(*user_limit_list, used_limits);
+		job_hash_insert(index->hash, user_id, used_limits);
+		index->count++;
 	}
+	slurm_mutex_unlock(&limits_index_mutex);
 
 	return used_limits;
 }
@@ -517,8 +624,23 @@ static bool _valid_job_assoc(struct job_record *job_ptr)
 	return true;
 }
 
+/*
+ * Remove a job's TRES counts from usage, setting any that would underflow to
+ * zero. RET position of the first TRES that underflowed or -1 if none
+ */
+static int _remove_tres_usage(uint64_t *usage, uint64_t *used_tres)
+{
+	int pos = tres_array_exceeds(used_tres, NULL, usage,
+				     slurmctld_tres_cnt);
+
+	tres_array_sub(usage, used_tres, slurmctld_tres_cnt);
+
+	return pos;
+}
+
 static void _qos_adjust_limit_usage(int type, struct job_record *job_ptr,
 				    slurmdb_qos_rec_t *qos_ptr,
+				    uint64_t *used_tres,
 				    uint64_t *used_tres_run_secs,
 				    uint32_t job_cnt)
 {
@@ -528,11 +650,10 @@ static void _qos_adjust_limit_usage(int type, struct job_record *job_ptr,
 	if (!qos_ptr || !job_ptr->assoc_ptr)
 		return;
 
-	used_limits_a =	_get_acct_used_limits(&qos_ptr->usage->acct_limit_list,
+	used_limits_a =	_get_acct_used_limits(qos_ptr,
 					      job_ptr->assoc_ptr->acct);
 
-	used_limits = _get_user_used_limits(&qos_ptr->usage->user_limit_list,
-					    job_ptr->user_id);
+	used_limits = _get_user_used_limits(qos_ptr, job_ptr->user_id);
 
 	switch(type) {
 	case ACCT_POLICY_ADD_SUBMIT:
@@ -573,22 +694,19 @@ static void _qos_adjust_limit_usage(int type, struct job_record *job_ptr,
 		break;
 	case ACCT_POLICY_JOB_BEGIN:
 		qos_ptr->usage->grp_used_jobs++;
-		for (i=0; i<slurmctld_tres_cnt; i++) {
-			/* tres_alloc_cnt for ENERGY is currently after the
-			 * fact, so don't add it here or you will get underflows
-			 * when you remove it.  If this ever changes this will
-			 * have to be moved to a new TRES ARRAY probably.
-			 */
+		tres_array_add(used_limits->tres, used_tres,
+			       slurmctld_tres_cnt);
+		tres_array_add(used_limits_a->tres, used_tres,
+			       slurmctld_tres_cnt);
+		tres_array_add(qos_ptr->usage->grp_used_tres, used_tres,
+			       slurmctld_tres_cnt);
+		tres_array_add(qos_ptr->usage->grp_used_tres_run_secs,
+			       used_tres_run_secs, slurmctld_tres_cnt);
+
+		for (i = 0; (get_log_level() >= LOG_LEVEL_DEBUG2) &&
+			    (i < slurmctld_tres_cnt); i++) {
 			if (i == TRES_ARRAY_ENERGY)
 				continue;
-
-			used_limits->tres[i] += job_ptr->tres_alloc_cnt[i];
-			used_limits_a->tres[i] += job_ptr->tres_alloc_cnt[i];
-
-			qos_ptr->usage->grp_used_tres[i] +=
-				job_ptr->tres_alloc_cnt[i];
-			qos_ptr->usage->grp_used_tres_run_secs[i] +=
-				used_tres_run_secs[i];
 			debug2("acct_policy_job_begin: after "
 			       "adding job %u, qos %s "
 			       "grp_used_tres_run_secs(%s) "
@@ -617,43 +735,31 @@ static void _qos_adjust_limit_usage(int type, struct job_record *job_ptr,
 			       "underflow for qos %s", qos_ptr->name);
 		}
 
-		for (i=0; i<slurmctld_tres_cnt; i++) {
-			if (i == TRES_ARRAY_ENERGY)
-				continue;
-			if (job_ptr->tres_alloc_cnt[i] >
-			    qos_ptr->usage->grp_used_tres[i]) {
-				qos_ptr->usage->grp_used_tres[i] = 0;
-				debug2("acct_policy_job_fini: "
-				       "grp_used_tres(%s) "
-				       "underflow for QOS %s",
-				       assoc_mgr_tres_name_array[i],
-				       qos_ptr->name);
-			} else
-				qos_ptr->usage->grp_used_tres[i] -=
-					job_ptr->tres_alloc_cnt[i];
+		if ((i = _remove_tres_usage(qos_ptr->usage->grp_used_tres,
+					    used_tres)) >= 0) {
+			debug2("acct_policy_job_fini: "
+			       "grp_used_tres(%s) "
+			       "underflow for QOS %s",
+			       assoc_mgr_tres_name_array[i],
+			       qos_ptr->name);
+		}
 
-			if (job_ptr->tres_alloc_cnt[i] > used_limits->tres[i]) {
-				used_limits->tres[i] = 0;
-				debug2("acct_policy_job_fini: "
-				       "used_limits->tres(%s) "
-				       "underflow for qos %s user %u",
-				       assoc_mgr_tres_name_array[i],
-				       qos_ptr->name, used_limits->uid);
-			} else
-				used_limits->tres[i] -=
-					job_ptr->tres_alloc_cnt[i];
-
-			if (job_ptr->tres_alloc_cnt[i] >
-			    used_limits_a->tres[i]) {
-				used_limits_a->tres[i] = 0;
-				debug2("acct_policy_job_fini: "
-				       "used_limits->tres(%s) "
-				       "underflow for qos %s account %s",
-				       assoc_mgr_tres_name_array[i],
-				       qos_ptr->name, used_limits_a->acct);
-			} else
-				used_limits_a->tres[i] -=
-					job_ptr->tres_alloc_cnt[i];
+		if ((i = _remove_tres_usage(used_limits->tres,
+					    used_tres)) >= 0) {
+			debug2("acct_policy_job_fini: "
+			       "used_limits->tres(%s) "
+			       "underflow for qos %s user %u",
+			       assoc_mgr_tres_name_array[i],
+			       qos_ptr->name, used_limits->uid);
+		}
+
+		if ((i = _remove_tres_usage(used_limits_a->tres,
+					    used_tres)) >= 0) {
+			debug2("acct_policy_job_fini: "
+			       "used_limits->tres(%s) "
+			       "underflow for qos %s account %s",
+			       assoc_mgr_tres_name_array[i],
+			       qos_ptr->name, used_limits_a->acct);
 		}
 
 		if (used_limits->jobs)
@@ -691,26 +797,36 @@ static void _adjust_limit_usage(int type, struct job_record *job_ptr)
 	slurmdb_assoc_rec_t *assoc_ptr = NULL;
 	assoc_mgr_lock_t locks = { WRITE_LOCK, NO_LOCK, WRITE_LOCK, NO_LOCK,
 				   READ_LOCK, NO_LOCK, NO_LOCK };
+	uint64_t used_tres[slurmctld_tres_cnt];
 	uint64_t used_tres_run_secs[slurmctld_tres_cnt];
 	int i;
 	uint32_t job_cnt = 1;
 
+	memset(used_tres, 0, sizeof(uint64_t) * slurmctld_tres_cnt);
 	memset(used_tres_run_secs, 0, sizeof(uint64_t) * slurmctld_tres_cnt);
 
 	if (!(accounting_enforce & ACCOUNTING_ENFORCE_LIMITS)
 	    || !_valid_job_assoc(job_ptr))
 		return;
 
+	/* tres_alloc_cnt for ENERGY is currently after the
+	 * fact, so don't add it here or you will get underflows
+	 * when you remove it.  If this ever changes this will
+	 * have to be moved to a new TRES ARRAY probably.
+	 */
+	if (((type == ACCT_POLICY_JOB_BEGIN) ||
+	     (type == ACCT_POLICY_JOB_FINI)) && job_ptr->tres_alloc_cnt) {
+		memcpy(used_tres, job_ptr->tres_alloc_cnt,
+		       sizeof(uint64_t) * slurmctld_tres_cnt);
+		used_tres[TRES_ARRAY_ENERGY] = 0;
+	}
+
 	if (type == ACCT_POLICY_JOB_FINI)
 		priority_g_job_end(job_ptr);
 	else if (type == ACCT_POLICY_JOB_BEGIN) {
 		uint64_t time_limit_secs = (uint64_t)job_ptr->time_limit * 60;
-		for (i=0; i<slurmctld_tres_cnt; i++) {
-			if (i == TRES_ARRAY_ENERGY)
-				continue;
-			used_tres_run_secs[i] =
-				job_ptr->tres_alloc_cnt[i] * time_limit_secs;
-		}
+		tres_array_add_scaled(used_tres_run_secs, used_tres,
+				      time_limit_secs, slurmctld_tres_cnt);
 	} else if (((type == ACCT_POLICY_ADD_SUBMIT) ||
 		    (type == ACCT_POLICY_REM_SUBMIT)) &&
 		   job_ptr->array_recs && job_ptr->array_recs->task_cnt)
@@ -739,7 +855,8 @@ static void _adjust_limit_usage(int type, struct job_record *job_ptr)
 
 		if (job_first) {
 			_qos_adjust_limit_usage(type, job_ptr, job_ptr->qos_ptr,
-						used_tres_run_secs, job_cnt);
+						used_tres, used_tres_run_secs,
+						job_cnt);
 			part_qos_list = list_create(NULL);
 			list_push(part_qos_list, job_ptr->qos_ptr);
 		}
@@ -756,7 +873,8 @@ static void _adjust_limit_usage(int type, struct job_record *job_ptr)
 			list_push(part_qos_list, part_ptr->qos_ptr);
 			_qos_adjust_limit_usage(type, job_ptr,
 						part_ptr->qos_ptr,
-						used_tres_run_secs, job_cnt);
+						used_tres, used_tres_run_secs,
+						job_cnt);
 		}
 		list_iterator_destroy(part_itr);
 
@@ -764,7 +882,8 @@ static void _adjust_limit_usage(int type, struct job_record *job_ptr)
 		    !list_find_first(part_qos_list, _find_qos_part,
 				     job_ptr->qos_ptr)))
 			_qos_adjust_limit_usage(type, job_ptr, job_ptr->qos_ptr,
-						used_tres_run_secs, job_cnt);
+						used_tres, used_tres_run_secs,
+						job_cnt);
 
 		FREE_NULL_LIST(part_qos_list);
 	} else {
@@ -800,6 +919,7 @@ static void _adjust_limit_usage(int type, struct job_record *job_ptr)
 				_qos_adjust_limit_usage(ACCT_POLICY_REM_SUBMIT,
 							job_ptr,
 							part_ptr->qos_ptr,
+							used_tres,
 							used_tres_run_secs,
 							job_cnt);
 			}
@@ -810,9 +930,11 @@ static void _adjust_limit_usage(int type, struct job_record *job_ptr)
 		_set_qos_order(job_ptr, &qos_ptr_1, &qos_ptr_2);
 
 		_qos_adjust_limit_usage(type, job_ptr, qos_ptr_1,
-					used_tres_run_secs, job_cnt);
+					used_tres, used_tres_run_secs,
+					job_cnt);
 		_qos_adjust_limit_usage(type, job_ptr, qos_ptr_2,
-					used_tres_run_secs, job_cnt);
+					used_tres, used_tres_run_secs,
+					job_cnt);
 	}
 
 	assoc_ptr = job_ptr->assoc_ptr;
@@ -832,14 +954,15 @@ static void _adjust_limit_usage(int type, struct job_record *job_ptr)
 			break;
 		case ACCT_POLICY_JOB_BEGIN:
 			assoc_ptr->usage->used_jobs++;
-			for (i=0; i<slurmctld_tres_cnt; i++) {
+			tres_array_add(assoc_ptr->usage->grp_used_tres,
+				       used_tres, slurmctld_tres_cnt);
+			tres_array_add(assoc_ptr->usage->grp_used_tres_run_secs,
+				       used_tres_run_secs, slurmctld_tres_cnt);
+
+			for (i = 0; (get_log_level() >= LOG_LEVEL_DEBUG2) &&
+				    (i < slurmctld_tres_cnt); i++) {
 				if (i == TRES_ARRAY_ENERGY)
 					continue;
-
-				assoc_ptr->usage->grp_used_tres[i] +=
-					job_ptr->tres_alloc_cnt[i];
-				assoc_ptr->usage->grp_used_tres_run_secs[i] +=
-					used_tres_run_secs[i];
 				debug2("acct_policy_job_begin: after "
 				       "adding job %u, assoc %u(%s/%s/%s) "
 				       "grp_used_tres_run_secs(%s) "
@@ -860,24 +983,17 @@ static void _adjust_limit_usage(int type, struct job_record *job_ptr)
 				       "underflow for account %s",
 				       assoc_ptr->acct);
 
-			for (i = 0; i < slurmctld_tres_cnt; i++) {
-				if (i == TRES_ARRAY_ENERGY)
-					continue;
-				if (job_ptr->tres_alloc_cnt[i] >
-				    assoc_ptr->usage->grp_used_tres[i]) {
-					assoc_ptr->usage->grp_used_tres[i] = 0;
-					debug2("acct_policy_job_fini: "
-					       "grp_used_tres(%s) "
-					       "underflow for assoc "
-					       "%u(%s/%s/%s)",
-					       assoc_mgr_tres_name_array[i],
-					       assoc_ptr->id, assoc_ptr->acct,
-					       assoc_ptr->user,
-					       assoc_ptr->partition);
-				} else {
-					assoc_ptr->usage->grp_used_tres[i] -=
-						job_ptr->tres_alloc_cnt[i];
-				}
+			if ((i = _remove_tres_usage(
+				     assoc_ptr->usage->grp_used_tres,
+				     used_tres)) >= 0) {
+				debug2("acct_policy_job_fini: "
+				       "grp_used_tres(%s) "
+				       "underflow for assoc "
+				       "%u(%s/%s/%s)",
+				       assoc_mgr_tres_name_array[i],
+				       assoc_ptr->id, assoc_ptr->acct,
+				       assoc_ptr->user,
+				       assoc_ptr->partition);
 			}
 
 			break;
@@ -1260,7 +1376,11 @@ static acct_policy_tres_usage_t _validate_tres_usage_limits(
 
 	xassert(tres_limit_array);
 
-	for (i = 0; i < g_tres_count; i++) {
+	/* Most limits are usually not set, start at the first one that is */
+	if ((i = tres_array_first_limit(tres_limit_array, g_tres_count)) < 0)
+		return TRES_USAGE_OKAY;
+
+	for ( ; i < g_tres_count; i++) {
 		(*tres_pos) = i;
 
 		if ((admin_limit_set &&
@@ -1679,9 +1799,7 @@ static int _qos_policy_validate(job_desc_msg_t *job_desc,
 	if ((qos_out_ptr->max_submit_jobs_pa == INFINITE) &&
 	    (qos_ptr->max_submit_jobs_pa != INFINITE)) {
 		slurmdb_used_limits_t *used_limits =
-			_get_acct_used_limits(
-				&qos_ptr->usage->acct_limit_list,
-				assoc_ptr->acct);
+			_get_acct_used_limits(qos_ptr, assoc_ptr->acct);
 
 		qos_out_ptr->max_submit_jobs_pa = qos_ptr->max_submit_jobs_pa;
 
@@ -1702,9 +1820,7 @@ static int _qos_policy_validate(job_desc_msg_t *job_desc,
 	if ((qos_out_ptr->max_submit_jobs_pu == INFINITE) &&
 	    (qos_ptr->max_submit_jobs_pu != INFINITE)) {
 		slurmdb_used_limits_t *used_limits =
-			_get_user_used_limits(
-				&qos_ptr->usage->user_limit_list,
-				job_desc->user_id);
+			_get_user_used_limits(qos_ptr, job_desc->user_id);
 
 		qos_out_ptr->max_submit_jobs_pu = qos_ptr->max_submit_jobs_pu;
 
@@ -1774,11 +1890,9 @@ static int _qos_job_runnable_pre_select(struct job_record *job_ptr,
 
 	wall_mins = qos_ptr->usage->grp_used_wall / 60;
 
-	used_limits_a =	_get_acct_used_limits(&qos_ptr->usage->acct_limit_list,
-					      assoc_ptr->acct);
+	used_limits_a =	_get_acct_used_limits(qos_ptr, assoc_ptr->acct);
 
-	used_limits = _get_user_used_limits(&qos_ptr->usage->user_limit_list,
-					    job_ptr->user_id);
+	used_limits = _get_user_used_limits(qos_ptr, job_ptr->user_id);
 
 
 	/* we don't need to check grp_tres_mins here */
@@ -1980,11 +2094,9 @@ static int _qos_job_runnable_post_select(struct job_record *job_ptr,
 			(uint64_t)(qos_ptr->usage->usage_tres_raw[i] / 60.0);
 	}
 
-	used_limits_a =	_get_acct_used_limits(&qos_ptr->usage->acct_limit_list,
-					      assoc_ptr->acct);
+	used_limits_a =	_get_acct_used_limits(qos_ptr, assoc_ptr->acct);
 
-	used_limits = _get_user_used_limits(&qos_ptr->usage->user_limit_list,
-					    job_ptr->user_id);
+	used_limits = _get_user_used_limits(qos_ptr, job_ptr->user_id);
 
 	tres_usage = _validate_tres_usage_limits_for_qos(
 		&tres_pos, qos_ptr->grp_tres_mins_ctld,
@@ -170,6 +170,7 @@ typedef struct mail_info {
 	char *message;
 } mail_info_t;
 
+static slurm_cred_t *_agent_arg_cred(agent_arg_t *agent_arg_ptr);
 static void _agent_retry(int min_wait, bool wait_too);
 static int  _batch_launch_defer(queued_request_t *queued_req_ptr);
 static int  _signal_defer(queued_request_t *queued_req_ptr);
@@ -193,10 +194,13 @@ static mail_info_t *_mail_alloc(void);
 static void  _mail_free(void *arg);
 static void *_mail_proc(void *arg);
 static char *_mail_type_str(uint16_t mail_type);
+static int   _sign_creds(void);
 
 static pthread_mutex_t retry_mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_mutex_t mail_mutex  = PTHREAD_MUTEX_INITIALIZER;
 static List retry_list = NULL;		/* agent_arg_t list for retry */
+static pthread_mutex_t sign_mutex  = PTHREAD_MUTEX_INITIALIZER;
+static List sign_list = NULL;		/* requests with unsigned creds */
 static List mail_list = NULL;		/* pending e-mail requests */
 
 static pthread_mutex_t agent_cnt_mutex = PTHREAD_MUTEX_INITIALIZER;
@@ -1339,7 +1343,7 @@ static void _list_delete_retry(void *retry_entry)
 /* Start a thread to manage queued agent requests */
 static void *_agent_init(void *arg)
 {
-	int min_wait;
+	int min_wait, sign_cnt;
 	bool mail_too;
 	struct timespec ts = {0, 0};
 
@@ -1361,7 +1365,11 @@ static void *_agent_init(void *arg)
 		pending_wait_time = NO_VAL16;
 		slurm_mutex_unlock(&pending_mutex);
 
+		sign_cnt = _sign_creds();
 		_agent_retry(min_wait, mail_too);
+		/* Start the other requests whose credentials were signed */
+		while (--sign_cnt > 0)
+			_agent_retry(999, false);
 	}
 
 	slurm_mutex_lock(&pending_mutex);
@@ -1544,6 +1552,7 @@ static void _agent_retry(int min_wait, bool mail_too)
 void agent_queue_request(agent_arg_t *agent_arg_ptr)
 {
 	queued_request_t *queued_req_ptr = NULL;
+	slurm_cred_t *cred;
 
 	if ((AGENT_THREAD_COUNT + 2) >= MAX_SERVER_THREADS)
 		fatal("AGENT_THREAD_COUNT value is too high relative to MAX_SERVER_THREADS");
@@ -1564,6 +1573,18 @@ void agent_queue_request(agent_arg_t *agent_arg_ptr)
 	queued_req_ptr->agent_arg_ptr = agent_arg_ptr;
 /*	queued_req_ptr->last_attempt  = 0; Implicit */
 
+	cred = _agent_arg_cred(agent_arg_ptr);
+	if (cred && !slurm_cred_signed(cred)) {
+		/* Signed by _sign_creds() without the caller's locks */
+		slurm_mutex_lock(&sign_mutex);
+		if (sign_list == NULL)
+			sign_list = list_create(_list_delete_retry);
+		list_append(sign_list, queued_req_ptr);
+		slurm_mutex_unlock(&sign_mutex);
+		agent_trigger(999, false);
+		return;
+	}
+
 	slurm_mutex_lock(&retry_mutex);
 
 	if (retry_list == NULL)
@@ -1576,9 +1597,93 @@ void agent_queue_request(agent_arg_t *agent_arg_ptr)
 	agent_trigger(999, false);
 }
 
+/* Return the job credential carried by a request, NULL if none */
+static slurm_cred_t *_agent_arg_cred(agent_arg_t *agent_arg_ptr)
+{
+	if (agent_arg_ptr->msg_type == REQUEST_BATCH_JOB_LAUNCH)
+		return ((batch_job_launch_msg_t *)
+			agent_arg_ptr->msg_args)->cred;
+	if (agent_arg_ptr->msg_type == REQUEST_LAUNCH_PROLOG)
+		return ((prolog_launch_msg_t *)
+			agent_arg_ptr->msg_args)->cred;
+	return NULL;
+}
+
+/*
+ * Sign the credentials of all requests queued by agent_queue_request() with
+ * unsigned credentials, in one batch and without slurmctld locks, then move
+ * the requests to the retry list to be sent. Requests whose credential could
+ * not be signed are kept to be tried again. A credential's expiry window
+ * starts when it is signed, so waiting here does not shorten it.
+ * RET number of requests moved to the retry list
+ */
+static int _sign_creds(void)
+{
+	queued_request_t *queued_req_ptr;
+	slurm_cred_t **creds;
+	ListIterator iter;
+	List batch, signed_list;
+	int cnt, i = 0;
+
+	slurm_mutex_lock(&sign_mutex);
+	batch = sign_list;
+	sign_list = NULL;
+	slurm_mutex_unlock(&sign_mutex);
+	if (!batch)
+		return 0;
+
+	cnt = list_count(batch);
+	creds = xmalloc(sizeof(slurm_cred_t *) * cnt);
+	iter = list_iterator_create(batch);
+	while ((queued_req_ptr = list_next(iter)))
+		creds[i++] = _agent_arg_cred(queued_req_ptr->agent_arg_ptr);
+	list_iterator_destroy(iter);
+
+	if (slurm_cred_sign_batch(slurmctld_config.cred_ctx, creds, cnt) !=
+	    SLURM_SUCCESS)
+		error("%s: unable to sign job credentials, will retry",
+		      __func__);
+	xfree(creds);
+
+	signed_list = list_create(NULL);
+	iter = list_iterator_create(batch);
+	while ((queued_req_ptr = list_next(iter))) {
+		if (slurm_cred_signed(
+			    _agent_arg_cred(queued_req_ptr->agent_arg_ptr)))
+			list_append(signed_list, list_remove(iter));
+	}
+	list_iterator_destroy(iter);
+	cnt = list_count(signed_list);
+
+	slurm_mutex_lock(&retry_mutex);
+	if (retry_list == NULL)
+		retry_list = list_create(_list_delete_retry);
+	list_transfer(retry_list, signed_list);
+	slurm_mutex_unlock(&retry_mutex);
+	FREE_NULL_LIST(signed_list);
+
+	/* Keep the failed requests ahead of those queued since */
+	slurm_mutex_lock(&sign_mutex);
+	if (sign_list)
+		list_transfer(batch, sign_list);
+	FREE_NULL_LIST(sign_list);
+	if (list_count(batch))
+		sign_list = batch;
+	else
+		FREE_NULL_LIST(batch);
+	slurm_mutex_unlock(&sign_mutex);
+
+	return cnt;
+}
+
 /* agent_purge - purge all pending RPC requests */
 extern void agent_purge(void)
 {
+	if (sign_list) {
+		slurm_mutex_lock(&sign_mutex);
+		FREE_NULL_LIST(sign_list);
+		slurm_mutex_unlock(&sign_mutex);
+	}
 	if (retry_list) {
 		slurm_mutex_lock(&retry_mutex);
 		FREE_NULL_LIST(retry_list);
@@ -2053,3 +2158,16 @@ extern int retry_list_size(void)
 		return 0;
 	return list_count(retry_list);
 }
+
+/* Return count of requests waiting for their credential to be signed */
+extern int sign_list_size(void)
+{
+	int cnt = 0;
+
+	slurm_mutex_lock(&sign_mutex);
+	if (sign_list)
+		cnt = list_count(sign_list);
+	slurm_mutex_unlock(&sign_mutex);
+
+	return cnt;
+}
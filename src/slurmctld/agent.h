@@ -108,4 +108,7 @@ extern void mail_job_info (struct job_record *job_ptr, uint16_t mail_type);
 /* Return length of agent's retry_list */
 extern int retry_list_size(void);
 
+/* Return count of requests waiting for their credential to be signed */
+extern int sign_list_size(void);
+
 #endif /* !_AGENT_H */
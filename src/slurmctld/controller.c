@@ -65,6 +65,7 @@
 #include "src/common/group_cache.h"
 #include "src/common/hostlist.h"
 #include "src/common/layouts_mgr.h"
+#include "src/common/lock_stats.h"
 #include "src/common/log.h"
 #include "src/common/macros.h"
 #include "src/common/node_features.h"
@@ -98,6 +99,7 @@
 #include "src/slurmctld/front_end.h"
 #include "src/slurmctld/gang.h"
 #include "src/slurmctld/heartbeat.h"
+#include "src/slurmctld/info_snapshot.h"
 #include "src/slurmctld/job_scheduler.h"
 #include "src/slurmctld/job_submit.h"
 #include "src/slurmctld/licenses.h"
@@ -110,6 +112,7 @@
 #include "src/slurmctld/proc_req.h"
 #include "src/slurmctld/read_config.h"
 #include "src/slurmctld/reservation.h"
+#include "src/slurmctld/rpc_queue.h"
 #include "src/slurmctld/sched_plugin.h"
 #include "src/slurmctld/slurmctld.h"
 #include "src/slurmctld/slurmctld_plugstack.h"
@@ -717,6 +720,7 @@ int main(int argc, char **argv)
 	assoc_mgr_fini(1);
 	reserve_port_config(NULL);
 	free_rpc_stats();
+	info_snapshot_fini();
 
 	/* Some plugins are needed to purge job/node data structures,
 	 * unplug after other data structures are purged */
@@ -976,6 +980,7 @@ static void *_slurmctld_rpc_mgr(void *no_data)
 		READ_LOCK, NO_LOCK, NO_LOCK, NO_LOCK, NO_LOCK };
 	int sigarray[] = {SIGUSR1, 0};
 	char *node_addr = NULL;
+	bool use_rpc_queue;
 
 #if HAVE_SYS_PRCTL_H
 	if (prctl(PR_SET_NAME, "rpcmgr", NULL, NULL, NULL) < 0) {
@@ -1035,9 +1040,13 @@ static void *_slurmctld_rpc_mgr(void *no_data)
 	xsignal_unblock(sigarray);
 
 	/*
-	 * Process incoming RPCs until told to shutdown
+	 * Process incoming RPCs until told to shutdown, either from a pool
+	 * of worker threads or with a new thread for each connection
 	 */
-	while (_wait_for_server_thread()) {
+	use_rpc_queue = rpc_queue_enabled();
+	if (use_rpc_queue)
+		rpc_queue_mgr(sockfd, nports);
+	while (!use_rpc_queue && _wait_for_server_thread()) {
 		int max_fd = -1;
 		FD_ZERO(&rfds);
 		for (i=0; i<nports; i++) {
@@ -1805,6 +1814,7 @@ static void *_slurmctld_background(void *no_data)
 	(void) pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
 	(void) pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, NULL);
 	debug3("_slurmctld_background pid = %u", getpid());
+	lock_stats_set_caller(LOCK_CALLER_BACKGROUND);
 
 	while (1) {
 		for (i = 0; ((i < 10) && (slurmctld_config.shutdown_time == 0));
@@ -3257,7 +3267,7 @@ static void *_purge_files_thread(void *no_data)
 	int *job_id;
 
 	/*
-	 * Use the purge_files_list as a queue. _delete_job_details()
+	 * Use the purge_files_list as a queue. _purge_job_files()
 	 * in job_mgr.c always enqueues (at the end), while
 	 *_purge_files_thread consumes off the front.
 	 *
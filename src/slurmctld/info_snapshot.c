@@ -0,0 +1,326 @@
+/*****************************************************************************\
+ *  info_snapshot.c - shared snapshots of packed job and node information
+ *****************************************************************************
+ *  Copyright (C) 2018 SchedMD LLC.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "src/common/list.h"
+#include "src/common/log.h"
+#include "src/common/macros.h"
+#include "src/common/node_select.h"
+#include "src/common/read_config.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+
+#include "src/slurmctld/info_snapshot.h"
+#include "src/slurmctld/locks.h"
+#include "src/slurmctld/slurmctld.h"
+
+/*
+ * Query RPCs normally pack the entire job or node table under the slurmctld
+ * read (or node write) lock for every request, which keeps the scheduler
+ * and backfill threads from getting write locks when many users poll at
+ * once. Instead, the first request after a change packs the table once and
+ * publishes the result, and later requests send that same buffer without
+ * touching slurmctld_lock_t until last_job_update/last_node_update moves.
+ *
+ * Each snapshot is reference counted. Replacing the published snapshot only
+ * drops the slot's reference, readers still sending the old one free it
+ * when they release it.
+ */
+
+typedef struct {
+	info_snapshot_type_t type;
+	uint16_t show_flags;
+	uint16_t protocol_version;
+	info_snapshot_t *current;	/* published snapshot or NULL */
+	bool building;			/* a thread is packing a new one */
+} snapshot_slot_t;
+
+static pthread_mutex_t snapshot_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t snapshot_cond = PTHREAD_COND_INITIALIZER;
+static List slot_list = NULL;
+static time_t config_update = 0;
+static int snapshot_age = 0;	/* seconds, 0 disables snapshots */
+
+/* Cache of part_visibility_restricted() as of part_restricted_time */
+static bool part_restricted = false;
+static time_t part_restricted_time = 0;
+
+static void _snapshot_unref(info_snapshot_t *snap)
+{
+	xassert(snap->ref_cnt > 0);
+	if (--snap->ref_cnt == 0) {
+		xfree(snap->data);
+		xfree(snap);
+	}
+}
+
+static void _slot_free(void *x)
+{
+	snapshot_slot_t *slot = (snapshot_slot_t *) x;
+
+	if (slot->current)
+		_snapshot_unref(slot->current);
+	xfree(slot);
+}
+
+/* Must hold snapshot_mutex */
+static void _load_config(void)
+{
+	char *sched_params, *tmp_ptr;
+
+	if (config_update == slurmctld_conf.last_update)
+		return;
+	config_update = slurmctld_conf.last_update;
+
+	snapshot_age = 0;
+	sched_params = slurm_get_sched_params();
+	if (sched_params &&
+	    (tmp_ptr = strstr(sched_params, "info_snapshot_age="))) {
+		snapshot_age = atoi(tmp_ptr + 18);
+		if (snapshot_age < 0) {
+			error("Invalid SchedulerParameters info_snapshot_age=%d",
+			      snapshot_age);
+			snapshot_age = 0;
+		}
+	}
+	xfree(sched_params);
+}
+
+/* Must hold snapshot_mutex */
+static snapshot_slot_t *_get_slot(info_snapshot_type_t type,
+				  uint16_t show_flags,
+				  uint16_t protocol_version)
+{
+	snapshot_slot_t *slot;
+	ListIterator iter;
+
+	if (!slot_list)
+		slot_list = list_create(_slot_free);
+
+	iter = list_iterator_create(slot_list);
+	while ((slot = (snapshot_slot_t *) list_next(iter))) {
+		if ((slot->type == type) &&
+		    (slot->show_flags == show_flags) &&
+		    (slot->protocol_version == protocol_version))
+			break;
+	}
+	list_iterator_destroy(iter);
+
+	if (!slot) {
+		slot = xmalloc(sizeof(snapshot_slot_t));
+		slot->type = type;
+		slot->show_flags = show_flags;
+		slot->protocol_version = protocol_version;
+		list_append(slot_list, slot);
+	}
+
+	return slot;
+}
+
+/*
+ * Test if a snapshot still matches slurmctld state. The update times have a
+ * one second resolution, so a snapshot packed in the same second as the last
+ * change could miss a later change made in that same second and is never
+ * reused.
+ */
+static bool _snapshot_current(info_snapshot_t *snap, info_snapshot_type_t type,
+			      time_t now)
+{
+	time_t last_update;
+
+	if (type == INFO_SNAPSHOT_JOBS)
+		last_update = last_job_update;
+	else
+		last_update = last_node_update;
+
+	if ((snap->last_update != last_update) ||
+	    (snap->conf_update != slurmctld_conf.last_update) ||
+	    (snap->part_update != last_part_update))
+		return false;
+	if ((snap->create_time <= snap->last_update) ||
+	    (snap->create_time <= snap->conf_update) ||
+	    (snap->create_time <= snap->part_update))
+		return false;
+	if ((now - snap->create_time) > snapshot_age)
+		return false;
+
+	return true;
+}
+
+/*
+ * Pack a new snapshot under the locks the RPC would otherwise use.
+ * RET NULL if the response would depend upon the requesting user
+ */
+static info_snapshot_t *_snapshot_build(info_snapshot_type_t type,
+					uint16_t show_flags, bool user_filter,
+					uint16_t protocol_version)
+{
+	/* Locks: Read config job part */
+	slurmctld_lock_t job_read_lock = {
+		READ_LOCK, READ_LOCK, NO_LOCK, READ_LOCK, READ_LOCK };
+	/* Locks: Read config, write node (reset allocated CPU count in some
+	 * select plugins), read part (for part_is_visible) */
+	slurmctld_lock_t node_write_lock = {
+		READ_LOCK, NO_LOCK, WRITE_LOCK, READ_LOCK, NO_LOCK };
+	slurmctld_lock_t *locks;
+	info_snapshot_t *snap = NULL;
+	bool restricted;
+
+	if (type == INFO_SNAPSHOT_JOBS)
+		locks = &job_read_lock;
+	else
+		locks = &node_write_lock;
+	lock_slurmctld(*locks);
+
+	restricted = part_visibility_restricted();
+	slurm_mutex_lock(&snapshot_mutex);
+	part_restricted = restricted;
+	part_restricted_time = last_part_update;
+	slurm_mutex_unlock(&snapshot_mutex);
+
+	if (user_filter && restricted)
+		goto fini;
+
+	snap = xmalloc(sizeof(info_snapshot_t));
+	snap->conf_update = slurmctld_conf.last_update;
+	snap->part_update = last_part_update;
+	snap->create_time = time(NULL);
+	snap->part_restricted = restricted;
+	/* uid 0 sees all partitions, the same as any user when unrestricted */
+	if (type == INFO_SNAPSHOT_JOBS) {
+		snap->last_update = last_job_update;
+		pack_all_jobs(&snap->data, &snap->size, show_flags, 0, NO_VAL,
+			      protocol_version);
+	} else {
+		select_g_select_nodeinfo_set_all();
+		snap->last_update = last_node_update;
+		pack_all_node(&snap->data, &snap->size, show_flags, 0,
+			      protocol_version);
+	}
+
+fini:
+	unlock_slurmctld(*locks);
+	if (snap) {
+		debug2("%s: packed %s snapshot, size=%d", __func__,
+		       (type == INFO_SNAPSHOT_JOBS) ? "job" : "node",
+		       snap->size);
+	}
+	return snap;
+}
+
+extern info_snapshot_t *info_snapshot_acquire(info_snapshot_type_t type,
+					      uint16_t show_flags, uid_t uid,
+					      uint16_t protocol_version)
+{
+	info_snapshot_t *snap = NULL;
+	snapshot_slot_t *slot;
+	bool user_filter;
+	time_t now = time(NULL);
+
+	if ((type == INFO_SNAPSHOT_JOBS) &&
+	    (slurmctld_conf.private_data & PRIVATE_DATA_JOBS))
+		return NULL;
+
+	/* Hidden partitions are filtered by user unless SHOW_ALL */
+	user_filter = (!(show_flags & SHOW_ALL) && (uid != 0));
+
+	slurm_mutex_lock(&snapshot_mutex);
+	_load_config();
+	if (!snapshot_age ||
+	    (user_filter && part_restricted &&
+	     (part_restricted_time == last_part_update))) {
+		slurm_mutex_unlock(&snapshot_mutex);
+		return NULL;
+	}
+
+	slot = _get_slot(type, show_flags, protocol_version);
+	while (1) {
+		if (slot->current && _snapshot_current(slot->current, type,
+						       now)) {
+			snap = slot->current;
+			if (user_filter && snap->part_restricted) {
+				/* packed without filtering by user */
+				slurm_mutex_unlock(&snapshot_mutex);
+				return NULL;
+			}
+			snap->ref_cnt++;
+			slurm_mutex_unlock(&snapshot_mutex);
+			return snap;
+		}
+		if (!slot->building)
+			break;
+		slurm_cond_wait(&snapshot_cond, &snapshot_mutex);
+		now = time(NULL);
+	}
+	slot->building = true;
+	slurm_mutex_unlock(&snapshot_mutex);
+
+	snap = _snapshot_build(type, show_flags, user_filter,
+			       protocol_version);
+
+	slurm_mutex_lock(&snapshot_mutex);
+	slot->building = false;
+	if (snap) {
+		if (slot->current)
+			_snapshot_unref(slot->current);
+		slot->current = snap;
+		snap->ref_cnt = 2;	/* slot and caller */
+	}
+	slurm_cond_broadcast(&snapshot_cond);
+	slurm_mutex_unlock(&snapshot_mutex);
+
+	return snap;
+}
+
+extern void info_snapshot_release(info_snapshot_t *snap)
+{
+	if (!snap)
+		return;
+
+	slurm_mutex_lock(&snapshot_mutex);
+	_snapshot_unref(snap);
+	slurm_mutex_unlock(&snapshot_mutex);
+}
+
+extern void info_snapshot_fini(void)
+{
+	slurm_mutex_lock(&snapshot_mutex);
+	FREE_NULL_LIST(slot_list);
+	slurm_mutex_unlock(&snapshot_mutex);
+}
@@ -0,0 +1,87 @@
+/*****************************************************************************\
+ *  info_snapshot.h - shared snapshots of packed job and node information
+ *****************************************************************************
+ *  Copyright (C) 2018 SchedMD LLC.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+
+#ifndef _SLURM_INFO_SNAPSHOT_H
+#define _SLURM_INFO_SNAPSHOT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <time.h>
+
+typedef enum {
+	INFO_SNAPSHOT_JOBS,	/* pack_all_jobs() output */
+	INFO_SNAPSHOT_NODES	/* pack_all_node() output */
+} info_snapshot_type_t;
+
+/*
+ * Immutable packed response body shared by all readers holding a reference.
+ * Only ref_cnt changes after the snapshot is published.
+ */
+typedef struct info_snapshot {
+	char *data;		/* packed RESPONSE_JOB_INFO/NODE_INFO body */
+	int size;		/* size of data in bytes */
+	time_t last_update;	/* last_job_update or last_node_update */
+	time_t conf_update;	/* slurmctld_conf.last_update */
+	time_t part_update;	/* last_part_update */
+	time_t create_time;
+	bool part_restricted;	/* partition visibility differs by user */
+	int ref_cnt;		/* protected by snapshot mutex */
+} info_snapshot_t;
+
+/*
+ * Get a reference to a snapshot of all job or node information packed with
+ * the given show_flags and protocol_version. A current snapshot is returned
+ * without taking any slurmctld locks. A stale one is rebuilt under the same
+ * locks the RPC would otherwise use and published for later readers.
+ *
+ * RET snapshot to be released with info_snapshot_release() or NULL if
+ *     snapshots are disabled (SchedulerParameters=info_snapshot_age) or the
+ *     response depends upon the requesting user (PrivateData=jobs, hidden
+ *     partitions without SHOW_ALL), in which case the caller must pack the
+ *     response itself
+ */
+extern info_snapshot_t *info_snapshot_acquire(info_snapshot_type_t type,
+					      uint16_t show_flags, uid_t uid,
+					      uint16_t protocol_version);
+
+/* Release a reference from info_snapshot_acquire() */
+extern void info_snapshot_release(info_snapshot_t *snap);
+
+/* Free all snapshots, called at slurmctld shutdown */
+extern void info_snapshot_fini(void);
+
+#endif /* !_SLURM_INFO_SNAPSHOT_H */
@@ -0,0 +1,309 @@
+/*****************************************************************************\
+ *  job_hash.c - open addressing hash tables for job records
+ *****************************************************************************
+ *  Copyright (C) 2018 SchedMD LLC.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include "config.h"
+
+#include <stdbool.h>
+
+#include "slurm/slurm_errno.h"
+
+#include "src/common/log.h"
+#include "src/common/xassert.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+
+#include "src/slurmctld/job_hash.h"
+
+#define JOB_HASH_MIN_BITS	10
+/* Old table slots to visit per insertion or removal while growing */
+#define JOB_HASH_MIGRATE_CNT	8
+
+typedef struct {
+	uint64_t key;
+	void *value;		/* NULL if slot is empty */
+} job_hash_entry_t;
+
+typedef struct {
+	job_hash_entry_t *entry;
+	uint32_t bits;
+	uint32_t mask;
+	uint32_t count;
+} job_hash_table_t;
+
+struct job_hash {
+	char *name;
+	job_hash_table_t cur;
+	job_hash_table_t old;		/* being moved into cur if entry set */
+	uint32_t migrate_inx;		/* next slot of old to visit */
+	uint64_t lookups;
+	uint64_t probes;
+	uint32_t probe_max;
+	uint32_t resizes;
+};
+
+/* Fibonacci hashing, spreads sequential job IDs over the whole table */
+static inline uint32_t _home(job_hash_table_t *table, uint64_t key)
+{
+	return (uint32_t) ((key * 0x9e3779b97f4a7c15ULL) >> (64 - table->bits));
+}
+
+static void _table_init(job_hash_table_t *table, uint32_t bits)
+{
+	table->bits = bits;
+	table->mask = (1 << bits) - 1;
+	table->count = 0;
+	table->entry = xmalloc(sizeof(job_hash_entry_t) << bits);
+}
+
+/* Return slot holding key (and value if not NULL), -1 if not found */
+static int64_t _table_find(job_hash_table_t *table, uint64_t key,
+			   void *value, uint32_t *probes)
+{
+	job_hash_entry_t *entry;
+	uint32_t inx;
+
+	if (!table->entry)
+		return -1;
+
+	inx = _home(table, key);
+	while (true) {
+		entry = &table->entry[inx];
+		(*probes)++;
+		if (!entry->value)
+			return -1;
+		if ((entry->key == key) && (!value || (entry->value == value)))
+			return inx;
+		inx = (inx + 1) & table->mask;
+	}
+}
+
+static void _table_insert(job_hash_table_t *table, uint64_t key, void *value)
+{
+	uint32_t inx = _home(table, key);
+
+	while (table->entry[inx].value)
+		inx = (inx + 1) & table->mask;
+	table->entry[inx].key = key;
+	table->entry[inx].value = value;
+	table->count++;
+}
+
+/*
+ * Empty a slot, shifting later records of the same cluster back so that no
+ * record is separated from its home slot by an empty slot
+ */
+static void _table_delete(job_hash_table_t *table, uint32_t inx)
+{
+	uint32_t next = inx, home;
+
+	while (true) {
+		next = (next + 1) & table->mask;
+		if (!table->entry[next].value)
+			break;
+		home = _home(table, table->entry[next].key);
+		/* Leave the record if its home is cyclically in (inx, next] */
+		if ((inx <= next) ?
+		    ((home > inx) && (home <= next)) :
+		    ((home > inx) || (home <= next)))
+			continue;
+		table->entry[inx] = table->entry[next];
+		inx = next;
+	}
+	table->entry[inx].value = NULL;
+	table->count--;
+}
+
+/*
+ * Move records from the old table into the current one. Whole clusters are
+ * moved at once, so records remaining in the old table can still be found.
+ */
+static void _migrate(job_hash_t *hash, int slot_cnt)
+{
+	job_hash_table_t *old = &hash->old;
+	job_hash_entry_t *entry;
+	bool moved;
+
+	while (old->entry && (slot_cnt > 0)) {
+		if (!old->count) {
+			xfree(old->entry);
+			break;
+		}
+		/* Visit one empty slot or a cluster and the slot after it */
+		do {
+			entry = &old->entry[hash->migrate_inx];
+			if ((moved = (entry->value != NULL))) {
+				_table_insert(&hash->cur, entry->key,
+					      entry->value);
+				entry->value = NULL;
+				old->count--;
+			}
+			hash->migrate_inx = (hash->migrate_inx + 1) &
+					    old->mask;
+			slot_cnt--;
+		} while (moved);
+	}
+}
+
+static void _grow(job_hash_t *hash)
+{
+	uint32_t inx;
+
+	while (hash->old.entry)
+		_migrate(hash, hash->old.mask + 1);
+
+	hash->old = hash->cur;
+	_table_init(&hash->cur, hash->old.bits + 1);
+	hash->resizes++;
+
+	/* Start moving records just after an empty slot */
+	for (inx = 0; hash->old.entry[inx].value; inx++)
+		;
+	hash->migrate_inx = (inx + 1) & hash->old.mask;
+
+	debug("%s: %s hash table grown to %u slots", __func__, hash->name,
+	      hash->cur.mask + 1);
+}
+
+extern job_hash_t *job_hash_create(const char *name, uint32_t size)
+{
+	job_hash_t *hash = xmalloc(sizeof(job_hash_t));
+	uint32_t bits = JOB_HASH_MIN_BITS;
+
+	/* Keep the table no more than half full for the expected records */
+	while ((bits < 31) && (((uint64_t) 1 << bits) < ((uint64_t) size * 2)))
+		bits++;
+
+	hash->name = xstrdup(name);
+	_table_init(&hash->cur, bits);
+
+	return hash;
+}
+
+extern void job_hash_destroy(job_hash_t *hash)
+{
+	if (!hash)
+		return;
+
+	xfree(hash->cur.entry);
+	xfree(hash->old.entry);
+	xfree(hash->name);
+	xfree(hash);
+}
+
+extern void *job_hash_find(job_hash_t *hash, uint64_t key)
+{
+	uint32_t probes = 0;
+	int64_t inx;
+	void *value = NULL;
+
+	if ((inx = _table_find(&hash->cur, key, NULL, &probes)) >= 0)
+		value = hash->cur.entry[inx].value;
+	else if ((inx = _table_find(&hash->old, key, NULL, &probes)) >= 0)
+		value = hash->old.entry[inx].value;
+
+	/*
+	 * Lookups run concurrently under read locks, so these counts are
+	 * approximate. They are only used for statistics.
+	 */
+	hash->lookups++;
+	hash->probes += probes;
+	if (probes > hash->probe_max)
+		hash->probe_max = probes;
+
+	return value;
+}
+
+extern void job_hash_insert(job_hash_t *hash, uint64_t key, void *value)
+{
+	xassert(value);
+
+	_migrate(hash, JOB_HASH_MIGRATE_CNT);
+	if (((uint64_t) hash->cur.count + hash->old.count + 1) * 2 >
+	    ((uint64_t) hash->cur.mask + 1))
+		_grow(hash);
+	_table_insert(&hash->cur, key, value);
+}
+
+extern int job_hash_remove(job_hash_t *hash, uint64_t key, void *value)
+{
+	uint32_t probes = 0;
+	int64_t inx;
+
+	_migrate(hash, JOB_HASH_MIGRATE_CNT);
+	if ((inx = _table_find(&hash->cur, key, value, &probes)) >= 0)
+		_table_delete(&hash->cur, inx);
+	else if ((inx = _table_find(&hash->old, key, value, &probes)) >= 0)
+		_table_delete(&hash->old, inx);
+	else
+		return SLURM_ERROR;
+
+	return SLURM_SUCCESS;
+}
+
+extern int job_hash_replace(job_hash_t *hash, uint64_t key, void *value,
+			    void *new_value)
+{
+	uint32_t probes = 0;
+	int64_t inx;
+
+	xassert(new_value);
+
+	if ((inx = _table_find(&hash->cur, key, value, &probes)) >= 0)
+		hash->cur.entry[inx].value = new_value;
+	else if ((inx = _table_find(&hash->old, key, value, &probes)) >= 0)
+		hash->old.entry[inx].value = new_value;
+	else
+		return SLURM_ERROR;
+
+	return SLURM_SUCCESS;
+}
+
+extern void job_hash_get_stats(job_hash_t *hash, job_hash_stats_t *stats)
+{
+	stats->name = hash->name;
+	stats->size = hash->cur.mask + 1;
+	stats->records = hash->cur.count + hash->old.count;
+	stats->lookups = hash->lookups;
+	stats->probes = hash->probes;
+	stats->probe_max = hash->probe_max;
+	stats->resizes = hash->resizes;
+}
+
+extern void job_hash_reset_stats(job_hash_t *hash)
+{
+	hash->lookups = 0;
+	hash->probes = 0;
+	hash->probe_max = 0;
+}
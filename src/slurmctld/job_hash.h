@@ -0,0 +1,94 @@
+/*****************************************************************************\
+ *  job_hash.h - open addressing hash tables for job records
+ *****************************************************************************
+ *  Copyright (C) 2018 SchedMD LLC.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _SLURM_JOB_HASH_H
+#define _SLURM_JOB_HASH_H
+
+#include <inttypes.h>
+
+/*
+ * Open addressing (linear probing) hash table mapping a 64-bit key to a
+ * pointer. The table doubles in size when half full. Records are moved to the
+ * larger table a few at a time by later insertions and removals, so no single
+ * operation has to move every record.
+ *
+ * Lookups do not modify the table and may run concurrently with each other.
+ * Insertions and removals must be serialized with all other operations by the
+ * caller (e.g. the job write lock).
+ */
+typedef struct job_hash job_hash_t;
+
+typedef struct {
+	char *name;		/* table name, do not free */
+	uint32_t size;		/* slots in the table(s) */
+	uint32_t records;	/* records in the table(s) */
+	uint64_t lookups;	/* job_hash_find() calls */
+	uint64_t probes;	/* slots examined by job_hash_find() */
+	uint32_t probe_max;	/* most slots examined by one lookup */
+	uint32_t resizes;	/* times the table has grown */
+} job_hash_stats_t;
+
+/*
+ * Create a hash table
+ * IN name - name of the table, reported in statistics
+ * IN size - expected number of records, the table grows as needed
+ */
+extern job_hash_t *job_hash_create(const char *name, uint32_t size);
+
+extern void job_hash_destroy(job_hash_t *hash);
+
+/* Return the first value found for key or NULL if none */
+extern void *job_hash_find(job_hash_t *hash, uint64_t key);
+
+/* Add a value for key, value may not be NULL. Duplicate keys are permitted. */
+extern void job_hash_insert(job_hash_t *hash, uint64_t key, void *value);
+
+/* Remove the given key/value pair, RET SLURM_SUCCESS or SLURM_ERROR */
+extern int job_hash_remove(job_hash_t *hash, uint64_t key, void *value);
+
+/*
+ * Replace the value of the given key/value pair with new_value
+ * RET SLURM_SUCCESS or SLURM_ERROR if the key/value pair is not found
+ */
+extern int job_hash_replace(job_hash_t *hash, uint64_t key, void *value,
+			    void *new_value);
+
+/* Copy the table's statistics into stats */
+extern void job_hash_get_stats(job_hash_t *hash, job_hash_stats_t *stats);
+
+/* Clear the table's lookup statistics */
+extern void job_hash_reset_stats(job_hash_t *hash);
+
+#endif /* !_SLURM_JOB_HASH_H */
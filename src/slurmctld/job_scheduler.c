@@ -60,6 +60,7 @@
 #include "src/common/group_cache.h"
 #include "src/common/layouts_mgr.h"
 #include "src/common/list.h"
+#include "src/common/lock_stats.h"
 #include "src/common/macros.h"
 #include "src/common/node_features.h"
 #include "src/common/node_select.h"
@@ -79,6 +80,7 @@
 #include "src/slurmctld/fed_mgr.h"
 #include "src/slurmctld/front_end.h"
 #include "src/slurmctld/gang.h"
+#include "src/slurmctld/job_hash.h"
 #include "src/slurmctld/locks.h"
 #include "src/slurmctld/job_scheduler.h"
 #include "src/slurmctld/licenses.h"
@@ -115,9 +117,9 @@ static char **	_build_env(struct job_record *job_ptr, bool is_epilog);
 static batch_job_launch_msg_t *_build_launch_job_msg(struct job_record *job_ptr,
 						     uint16_t protocol_version);
 static void	_depend_list_del(void *dep_ptr);
-static void	_job_queue_append(List job_queue, struct job_record *job_ptr,
+static void	_job_queue_append(vector_t *job_queue,
+				  struct job_record *job_ptr,
 				  struct part_record *part_ptr, uint32_t priority);
-static void	_job_queue_rec_del(void *x);
 static bool	_job_runnable_test1(struct job_record *job_ptr,
 				    bool clear_start);
 static bool	_job_runnable_test2(struct job_record *job_ptr,
@@ -233,23 +235,16 @@ static List _build_user_job_list(uint32_t user_id, char* job_name)
 	return job_queue;
 }
 
-static void _job_queue_append(List job_queue, struct job_record *job_ptr,
+static void _job_queue_append(vector_t *job_queue, struct job_record *job_ptr,
 			      struct part_record *part_ptr, uint32_t prio)
 {
-	job_queue_rec_t *job_queue_rec;
+	job_queue_rec_t *job_queue_rec = vector_append(job_queue);
 
-	job_queue_rec = xmalloc(sizeof(job_queue_rec_t));
 	job_queue_rec->array_task_id = job_ptr->array_task_id;
 	job_queue_rec->job_id   = job_ptr->job_id;
 	job_queue_rec->job_ptr  = job_ptr;
 	job_queue_rec->part_ptr = part_ptr;
 	job_queue_rec->priority = prio;
-	list_append(job_queue, job_queue_rec);
-}
-
-static void _job_queue_rec_del(void *x)
-{
-	xfree(x);
 }
 
 /* Return true if the job has some step still in a cleaning state, which
@@ -377,17 +372,13 @@ static bool _job_runnable_test2(struct job_record *job_ptr, bool check_min_time)
 }
 
 /*
- * build_job_queue - build (non-priority ordered) list of pending jobs
- * IN clear_start - if set then clear the start_time for pending jobs,
- *		    true when called from sched/backfill or sched/builtin
- * IN backfill - true if running backfill scheduler, enforce min time limit
- * RET the job queue
- * NOTE: the caller must call FREE_NULL_LIST() on RET value to free memory
+ * Add pending jobs to job_queue, skipping those with a job ID in queued (if
+ * not NULL). RET count of records added
  */
-extern List build_job_queue(bool clear_start, bool backfill)
+static int _build_job_queue(vector_t *job_queue, job_hash_t *queued,
+			    bool clear_start, bool backfill)
 {
 	static time_t last_log_time = 0;
-	List job_queue;
 	ListIterator depend_iter, job_iterator, part_iterator;
 	struct job_record *job_ptr = NULL, *new_job_ptr;
 	struct part_record *part_ptr;
@@ -401,7 +392,6 @@ extern List build_job_queue(bool clear_start, bool backfill)
 
 	/* init the timer */
 	(void) slurm_delta_tv(&start_tv);
-	job_queue = list_create(_job_queue_rec_del);
 
 	/* Create individual job records for job arrays that need burst buffer
 	 * staging */
@@ -519,6 +509,8 @@ extern List build_job_queue(bool clear_start, bool backfill)
 			job_ptr->state_reason_prev = job_ptr->state_reason;
 			last_job_update = now;
 		}
+		if (queued && job_hash_find(queued, job_ptr->job_id))
+			continue;
 		if (!_job_runnable_test1(job_ptr, clear_start))
 			continue;
 
@@ -577,9 +569,116 @@ extern List build_job_queue(bool clear_start, bool backfill)
 	}
 	list_iterator_destroy(job_iterator);
 
+	return job_part_pairs;
+}
+
+/*
+ * build_job_queue - build (non-priority ordered) list of pending jobs
+ * IN clear_start - if set then clear the start_time for pending jobs,
+ *		    true when called from sched/backfill or sched/builtin
+ * IN backfill - true if running backfill scheduler, enforce min time limit
+ * RET the job queue, a vector of job_queue_rec_t
+ * NOTE: the caller must call FREE_NULL_VECTOR() on RET value to free memory
+ */
+extern vector_t *build_job_queue(bool clear_start, bool backfill)
+{
+	vector_t *job_queue = vector_create(sizeof(job_queue_rec_t),
+					    list_count(job_list));
+
+	(void) _build_job_queue(job_queue, NULL, clear_start, backfill);
+
 	return job_queue;
 }
 
+/*
+ * Return a queued job's priority in the record's partition, zero if the job
+ * can no longer use that partition
+ */
+static uint32_t _job_queue_rec_prio(job_queue_rec_t *job_queue_rec)
+{
+	struct job_record *job_ptr = job_queue_rec->job_ptr;
+	struct part_record *part_ptr;
+	ListIterator part_iterator;
+	int inx = -1;
+
+	if (job_ptr->part_ptr_list) {
+		part_iterator = list_iterator_create(job_ptr->part_ptr_list);
+		while ((part_ptr = (struct part_record *)
+				   list_next(part_iterator))) {
+			inx++;
+			if (part_ptr == job_queue_rec->part_ptr)
+				break;
+		}
+		list_iterator_destroy(part_iterator);
+		if (!part_ptr)
+			return 0;
+		if (job_ptr->priority_array)
+			return job_ptr->priority_array[inx];
+	} else if (job_ptr->part_ptr != job_queue_rec->part_ptr) {
+		return 0;
+	}
+
+	return job_ptr->priority;
+}
+
+typedef struct {
+	job_hash_t *queued;		/* Job IDs remaining in the queue */
+	int changed;			/* Records added or re-prioritized */
+} job_queue_update_t;
+
+/* vector_delete_all() callback, remove records of jobs no longer pending */
+static int _job_queue_rec_update(void *x, void *arg)
+{
+	job_queue_rec_t *job_queue_rec = (job_queue_rec_t *) x;
+	job_queue_update_t *update = (job_queue_update_t *) arg;
+	uint32_t prio;
+
+	/* The job record may have been purged, do not use job_ptr until found */
+	if ((find_job_record(job_queue_rec->job_id) !=
+	     job_queue_rec->job_ptr) ||
+	    !IS_JOB_PENDING(job_queue_rec->job_ptr) ||
+	    ((prio = _job_queue_rec_prio(job_queue_rec)) == 0))
+		return 1;
+
+	if (prio != job_queue_rec->priority) {
+		job_queue_rec->priority = prio;
+		update->changed++;
+	}
+	/* Records move as the vector is compacted, only the key is used */
+	if (!job_hash_find(update->queued, job_queue_rec->job_id)) {
+		job_hash_insert(update->queued, job_queue_rec->job_id,
+				job_queue_rec->job_ptr);
+	}
+
+	return 0;
+}
+
+/*
+ * update_job_queue - bring a job queue built earlier by build_job_queue()
+ *	up to date. Records of jobs no longer pending are removed and the
+ *	priority of the others updated. Only pending jobs not in the queue are
+ *	tested for ability to run and added.
+ * IN/OUT job_queue - job queue to update
+ * IN clear_start - if set then clear the start_time for pending jobs added
+ * IN backfill - true if running backfill scheduler, enforce min time limit
+ * RET count of records added or with a changed priority, if non-zero the
+ *	queue must be sorted again
+ */
+extern int update_job_queue(vector_t *job_queue, bool clear_start,
+			    bool backfill)
+{
+	job_queue_update_t update;
+
+	update.queued = job_hash_create("job_queue", vector_count(job_queue));
+	update.changed = 0;
+	(void) vector_delete_all(job_queue, _job_queue_rec_update, &update);
+	update.changed += _build_job_queue(job_queue, update.queued,
+					   clear_start, backfill);
+	job_hash_destroy(update.queued);
+
+	return update.changed;
+}
+
 /*
  * job_is_completing - Determine if jobs are in the process of completing.
  * IN/OUT  eff_cg_bitmap - optional bitmap of all relevent completing nodes,
@@ -966,6 +1065,24 @@ next_part:		part_ptr = (struct part_record *)
 		list_iterator_destroy(part_iterator);
 
 send_reply:
+	if (launch_msg &&
+	    (slurm_cred_sign_batch(slurmctld_config.cred_ctx,
+				   &launch_msg->cred, 1) != SLURM_SUCCESS)) {
+		agent_arg_t *agent_arg_ptr;
+
+		/* The agent keeps trying to sign it */
+		error("%s: unable to sign credential for batch job %u, launching through agent",
+		      __func__, launch_msg->job_id);
+		agent_arg_ptr = xmalloc(sizeof(agent_arg_t));
+		agent_arg_ptr->protocol_version = msg->protocol_version;
+		agent_arg_ptr->node_count = 1;
+		agent_arg_ptr->retry = 0;
+		agent_arg_ptr->hostlist = hostlist_create(launch_msg->nodes);
+		agent_arg_ptr->msg_type = REQUEST_BATCH_JOB_LAUNCH;
+		agent_arg_ptr->msg_args = (void *) launch_msg;
+		agent_queue_request(agent_arg_ptr);
+		launch_msg = NULL;
+	}
 	if (launch_msg) {
 		if (msg->msg_index && msg->ret_list) {
 			slurm_msg_t *resp_msg = xmalloc_nz(sizeof(slurm_msg_t));
@@ -1048,6 +1165,7 @@ extern int schedule(uint32_t job_limit)
 	int job_count = 0;
 	struct timeval now;
 	long delta_t;
+	lock_caller_t old_caller;
 
 	if (slurmctld_config.scheduling_disabled)
 		return 0;
@@ -1082,7 +1200,9 @@ extern int schedule(uint32_t job_limit)
 		sched_job_limit = -1;
 		slurm_mutex_unlock(&sched_mutex);
 
+		old_caller = lock_stats_set_caller(LOCK_CALLER_SCHED);
 		job_count = _schedule(job_limit);
+		lock_stats_set_caller(old_caller);
 
 		slurm_mutex_lock(&sched_mutex);
 		gettimeofday(&now, NULL);
@@ -1198,7 +1318,8 @@ extern bool deadline_ok(struct job_record *job_ptr, char *func)
 static int _schedule(uint32_t job_limit)
 {
 	ListIterator job_iterator = NULL, part_iterator = NULL;
-	List job_queue = NULL;
+	vector_t *job_queue = NULL;
+	uint32_t job_queue_inx = 0;
 	int failed_part_cnt = 0, failed_resv_cnt = 0, job_cnt = 0;
 	int error_code, i, j, part_cnt, time_limit, pend_time;
 	uint32_t job_depth = 0, array_task_id;
@@ -1575,7 +1696,8 @@ static int _schedule(uint32_t job_limit)
 		job_iterator = list_iterator_create(job_list);
 	} else {
 		job_queue = build_job_queue(false, false);
-		slurmctld_diag_stats.schedule_queue_len = list_count(job_queue);
+		slurmctld_diag_stats.schedule_queue_len =
+			vector_count(job_queue);
 		sort_job_queue(job_queue);
 	}
 	while (1) {
@@ -1614,14 +1736,13 @@ next_part:			part_ptr = (struct part_record *)
 					continue;
 			}
 		} else {
-			job_queue_rec = list_pop(job_queue);
-			if (!job_queue_rec)
+			if (job_queue_inx >= vector_count(job_queue))
 				break;
+			job_queue_rec = vector_get(job_queue, job_queue_inx++);
 			array_task_id = job_queue_rec->array_task_id;
 			job_ptr  = job_queue_rec->job_ptr;
 			part_ptr = job_queue_rec->part_ptr;
 			job_ptr->priority = job_queue_rec->priority;
-			xfree(job_queue_rec);
 			if (!avail_front_end(job_ptr)) {
 				job_ptr->state_reason = WAIT_FRONT_END;
 				xfree(job_ptr->state_desc);
@@ -2163,8 +2284,8 @@ fail_this_part:	if (fail_by_part) {
 			list_iterator_destroy(job_iterator);
 		if (part_iterator)
 			list_iterator_destroy(part_iterator);
-	} else if (job_queue) {
-		FREE_NULL_LIST(job_queue);
+	} else {
+		FREE_NULL_VECTOR(job_queue);
 	}
 	xfree(sched_part_ptr);
 	xfree(sched_part_jobs);
@@ -2193,18 +2314,18 @@ out:
  * sort_job_queue - sort job_queue in descending priority order
  * IN/OUT job_queue - sorted job queue
  */
-extern void sort_job_queue(List job_queue)
+extern void sort_job_queue(vector_t *job_queue)
 {
-	list_sort(job_queue, sort_job_queue2);
+	vector_sort(job_queue, sort_job_queue2);
 }
 
-/* Note this differs from the ListCmpF typedef since we want jobs sorted
+/* qsort() comparison of two job_queue_rec_t, we want jobs sorted
  * in order of decreasing priority then submit time and the by increasing
  * job id */
-extern int sort_job_queue2(void *x, void *y)
+extern int sort_job_queue2(const void *x, const void *y)
 {
-	job_queue_rec_t *job_rec1 = *(job_queue_rec_t **) x;
-	job_queue_rec_t *job_rec2 = *(job_queue_rec_t **) y;
+	job_queue_rec_t *job_rec1 = (job_queue_rec_t *) x;
+	job_queue_rec_t *job_rec2 = (job_queue_rec_t *) y;
 	bool has_resv1, has_resv2;
 	static time_t config_update = 0;
 	static bool preemption_enabled = true;
@@ -2745,6 +2866,8 @@ extern void launch_job(struct job_record *job_ptr)
 
 /*
  * make_batch_job_cred - add a job credential to the batch_job_launch_msg
+ *	The credential is left unsigned, the agent signs it before sending
+ *	the message. Messages sent otherwise must sign it themselves.
  * IN/OUT launch_msg_ptr - batch_job_launch_msg in which job_id, step_id,
  *                         uid and nodes have already been set
  * IN job_ptr - pointer to job record
@@ -2796,8 +2919,8 @@ extern int make_batch_job_cred(batch_job_launch_msg_t *launch_msg_ptr,
 	cred_arg.sockets_per_node    = job_resrcs_ptr->sockets_per_node;
 	cred_arg.sock_core_rep_count = job_resrcs_ptr->sock_core_rep_count;
 
-	launch_msg_ptr->cred = slurm_cred_create(slurmctld_config.cred_ctx,
-						 &cred_arg, protocol_version);
+	launch_msg_ptr->cred = slurm_cred_create_unsigned(
+		slurmctld_config.cred_ctx, &cred_arg, protocol_version);
 
 	if (launch_msg_ptr->cred)
 		return SLURM_SUCCESS;
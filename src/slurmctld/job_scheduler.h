@@ -42,6 +42,7 @@
 #ifndef _JOB_SCHEDULER_H
 #define _JOB_SCHEDULER_H
 
+#include "src/common/vector.h"
 #include "src/slurmctld/slurmctld.h"
 
 typedef struct job_queue_rec {
@@ -65,10 +66,10 @@ extern int build_feature_list(struct job_record *job_ptr);
  * build_job_queue - build (non-priority ordered) list of pending jobs
  * IN clear_start - if set then clear the start_time for pending jobs
  * IN backfill - true if running backfill scheduler, enforce min time limit
- * RET the job queue
- * NOTE: the caller must call list_destroy() on RET value to free memory
+ * RET the job queue, a vector of job_queue_rec_t
+ * NOTE: the caller must call FREE_NULL_VECTOR() on RET value to free memory
  */
-extern List build_job_queue(bool clear_start, bool backfill);
+extern vector_t *build_job_queue(bool clear_start, bool backfill);
 
 /* Given a scheduled job, return a pointer to it batch_job_launch_msg_t data */
 extern batch_job_launch_msg_t *build_launch_job_msg(
@@ -206,15 +207,29 @@ extern int schedule(uint32_t job_limit);
  */
 extern void set_job_elig_time(void);
 
+/*
+ * update_job_queue - bring a job queue built earlier by build_job_queue()
+ *	up to date. Records of jobs no longer pending are removed and the
+ *	priority of the others updated. Only pending jobs not in the queue are
+ *	tested for ability to run and added.
+ * IN/OUT job_queue - job queue to update
+ * IN clear_start - if set then clear the start_time for pending jobs added
+ * IN backfill - true if running backfill scheduler, enforce min time limit
+ * RET count of records added or with a changed priority, if non-zero the
+ *	queue must be sorted again
+ */
+extern int update_job_queue(vector_t *job_queue, bool clear_start,
+			    bool backfill);
+
 /*
  * sort_job_queue - sort job_queue in decending priority order
  * IN/OUT job_queue - sorted job queue previously made by build_job_queue()
  */
-extern void sort_job_queue(List job_queue);
+extern void sort_job_queue(vector_t *job_queue);
 
-/* Note this differs from the ListCmpF typedef since we want jobs sorted
+/* qsort() comparison of two job_queue_rec_t, we want jobs sorted
  *	in order of decreasing priority */
-extern int sort_job_queue2(void *x, void *y);
+extern int sort_job_queue2(const void *x, const void *y);
 
 /*
  * Determine if a job's dependencies are met
@@ -42,19 +42,59 @@
 #include <string.h>
 #include <sys/types.h>
 
+#include "src/common/assoc_mgr.h"
+#include "src/common/lock_stats.h"
+
 #include "src/slurmctld/locks.h"
 #include "src/slurmctld/slurmctld.h"
 
-static pthread_mutex_t locks_mutex = PTHREAD_MUTEX_INITIALIZER;
-static pthread_cond_t locks_cond = PTHREAD_COND_INITIALIZER;
+/*
+ * Each data type has its own mutex and condition variables, so threads
+ * locking one data type never wait on or are woken by activity on another.
+ * Readers and writers wait on separate condition variables, so an unlock
+ * wakes only those threads which can then proceed.
+ */
+typedef struct {
+	pthread_mutex_t mutex;
+	pthread_cond_t read_cond;	/* Readers waiting for writers */
+	pthread_cond_t write_cond;	/* Writers waiting for exclusive use */
+} entity_lock_t;
+
+#define ENTITY_LOCK_INITIALIZER \
+	{ PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, \
+	  PTHREAD_COND_INITIALIZER }
+
+/* One record per lock_datatype_t */
+static entity_lock_t entity_locks[ENTITY_COUNT] = {
+	ENTITY_LOCK_INITIALIZER,	/* CONFIG_LOCK */
+	ENTITY_LOCK_INITIALIZER,	/* JOB_LOCK */
+	ENTITY_LOCK_INITIALIZER,	/* NODE_LOCK */
+	ENTITY_LOCK_INITIALIZER,	/* PART_LOCK */
+	ENTITY_LOCK_INITIALIZER		/* FED_LOCK */
+};
 static pthread_mutex_t state_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 static slurmctld_lock_flags_t slurmctld_locks;
 
-static void _wr_rdlock(lock_datatype_t datatype);
-static void _wr_rdunlock(lock_datatype_t datatype);
-static void _wr_wrlock(lock_datatype_t datatype);
-static void _wr_wrunlock(lock_datatype_t datatype);
+/*
+ * Wait and hold time by data type, lock level (read or write) and caller,
+ * each protected by the data type's mutex
+ */
+static lock_stats_t lock_stats[ENTITY_COUNT][2][LOCK_CALLER_CNT];
+/* When this thread was granted each lock, to find how long it was held */
+static __thread uint64_t thread_lock_time[ENTITY_COUNT];
+
+static const char *entity_str[ENTITY_COUNT] = {
+	"config", "job", "node", "part", "fed"
+};
+static const char *assoc_entity_str[ASSOC_MGR_ENTITY_COUNT] = {
+	"assoc", "file", "qos", "res", "tres", "user", "wckey"
+};
+
+static void _wr_rdlock(lock_datatype_t datatype, uint64_t *now);
+static void _wr_rdunlock(lock_datatype_t datatype, uint64_t now);
+static void _wr_wrlock(lock_datatype_t datatype, uint64_t *now);
+static void _wr_wrunlock(lock_datatype_t datatype, uint64_t now);
 
 #ifndef NDEBUG
 /*
@@ -120,135 +160,278 @@ void init_locks(void)
 /* lock_slurmctld - Issue the required lock requests in a well defined order */
 extern void lock_slurmctld(slurmctld_lock_t lock_levels)
 {
+	uint64_t now = lock_stats_now();
+
 	xassert(_store_locks(lock_levels));
 
 	if (lock_levels.config == READ_LOCK)
-		_wr_rdlock(CONFIG_LOCK);
+		_wr_rdlock(CONFIG_LOCK, &now);
 	else if (lock_levels.config == WRITE_LOCK)
-		_wr_wrlock(CONFIG_LOCK);
+		_wr_wrlock(CONFIG_LOCK, &now);
 
 	if (lock_levels.job == READ_LOCK)
-		_wr_rdlock(JOB_LOCK);
+		_wr_rdlock(JOB_LOCK, &now);
 	else if (lock_levels.job == WRITE_LOCK)
-		_wr_wrlock(JOB_LOCK);
+		_wr_wrlock(JOB_LOCK, &now);
 
 	if (lock_levels.node == READ_LOCK)
-		_wr_rdlock(NODE_LOCK);
+		_wr_rdlock(NODE_LOCK, &now);
 	else if (lock_levels.node == WRITE_LOCK)
-		_wr_wrlock(NODE_LOCK);
+		_wr_wrlock(NODE_LOCK, &now);
 
 	if (lock_levels.partition == READ_LOCK)
-		_wr_rdlock(PART_LOCK);
+		_wr_rdlock(PART_LOCK, &now);
 	else if (lock_levels.partition == WRITE_LOCK)
-		_wr_wrlock(PART_LOCK);
+		_wr_wrlock(PART_LOCK, &now);
 
 	if (lock_levels.federation == READ_LOCK)
-		_wr_rdlock(FED_LOCK);
+		_wr_rdlock(FED_LOCK, &now);
 	else if (lock_levels.federation == WRITE_LOCK)
-		_wr_wrlock(FED_LOCK);
+		_wr_wrlock(FED_LOCK, &now);
 }
 
 /* unlock_slurmctld - Issue the required unlock requests in a well
  *	defined order */
 extern void unlock_slurmctld(slurmctld_lock_t lock_levels)
 {
+	uint64_t now = lock_stats_now();
+
 	xassert(_clear_locks(lock_levels));
 
 	if (lock_levels.federation == READ_LOCK)
-		_wr_rdunlock(FED_LOCK);
+		_wr_rdunlock(FED_LOCK, now);
 	else if (lock_levels.federation == WRITE_LOCK)
-		_wr_wrunlock(FED_LOCK);
+		_wr_wrunlock(FED_LOCK, now);
 
 	if (lock_levels.partition == READ_LOCK)
-		_wr_rdunlock(PART_LOCK);
+		_wr_rdunlock(PART_LOCK, now);
 	else if (lock_levels.partition == WRITE_LOCK)
-		_wr_wrunlock(PART_LOCK);
+		_wr_wrunlock(PART_LOCK, now);
 
 	if (lock_levels.node == READ_LOCK)
-		_wr_rdunlock(NODE_LOCK);
+		_wr_rdunlock(NODE_LOCK, now);
 	else if (lock_levels.node == WRITE_LOCK)
-		_wr_wrunlock(NODE_LOCK);
+		_wr_wrunlock(NODE_LOCK, now);
 
 	if (lock_levels.job == READ_LOCK)
-		_wr_rdunlock(JOB_LOCK);
+		_wr_rdunlock(JOB_LOCK, now);
 	else if (lock_levels.job == WRITE_LOCK)
-		_wr_wrunlock(JOB_LOCK);
+		_wr_wrunlock(JOB_LOCK, now);
 
 	if (lock_levels.config == READ_LOCK)
-		_wr_rdunlock(CONFIG_LOCK);
+		_wr_rdunlock(CONFIG_LOCK, now);
 	else if (lock_levels.config == WRITE_LOCK)
-		_wr_wrunlock(CONFIG_LOCK);
+		_wr_wrunlock(CONFIG_LOCK, now);
+}
+
+/*
+ * Record the wait for a lock just granted and note when it was granted.
+ * Called with the data type's mutex held.
+ */
+static void _add_wait(lock_datatype_t datatype, lock_level_t level,
+		      uint64_t *now)
+{
+	uint64_t start = *now;
+
+	*now = lock_stats_now();
+	lock_stats_add_wait(&lock_stats[datatype][level - READ_LOCK]
+					[lock_stats_get_caller()],
+			    *now - start);
+	thread_lock_time[datatype] = *now;
+}
+
+/* Record how long a lock was held. Called with the data type's mutex held. */
+static void _add_hold(lock_datatype_t datatype, lock_level_t level,
+		      uint64_t now)
+{
+	uint64_t start = thread_lock_time[datatype];
+
+	lock_stats_add_hold(&lock_stats[datatype][level - READ_LOCK]
+					[lock_stats_get_caller()],
+			    (now > start) ? (now - start) : 0);
 }
 
 /* _wr_rdlock - Issue a read lock on the specified data type
  *	Wait until there are no write locks AND
  *	no pending write locks (write_wait_lock == 0)
+ *	IN/OUT now - time the wait started, set to the time the lock was granted
  *
  *	NOTE: Always favoring write locks could result in starvation for
  *	read locks. */
-static void _wr_rdlock(lock_datatype_t datatype)
+static void _wr_rdlock(lock_datatype_t datatype, uint64_t *now)
 {
-	slurm_mutex_lock(&locks_mutex);
-	while (1) {
-		if ((slurmctld_locks.entity[write_lock(datatype)] == 0) &&
-		    (slurmctld_locks.entity[write_wait_lock(datatype)] == 0)) {
-			slurmctld_locks.entity[read_lock(datatype)]++;
-			slurmctld_locks.entity[write_cnt_lock(datatype)] = 0;
-			break;
-		} else {	/* wait for state change and retry */
-			slurm_cond_wait(&locks_cond, &locks_mutex);
-		}
+	entity_lock_t *lock = &entity_locks[datatype];
+
+	slurm_mutex_lock(&lock->mutex);
+	while ((slurmctld_locks.entity[write_lock(datatype)] != 0) ||
+	       (slurmctld_locks.entity[write_wait_lock(datatype)] != 0)) {
+		/* wait for state change and retry */
+		slurm_cond_wait(&lock->read_cond, &lock->mutex);
 	}
-	slurm_mutex_unlock(&locks_mutex);
+	slurmctld_locks.entity[read_lock(datatype)]++;
+	slurmctld_locks.entity[write_cnt_lock(datatype)] = 0;
+	_add_wait(datatype, READ_LOCK, now);
+	slurm_mutex_unlock(&lock->mutex);
 }
 
 /* _wr_rdunlock - Issue a read unlock on the specified data type */
-static void _wr_rdunlock(lock_datatype_t datatype)
+static void _wr_rdunlock(lock_datatype_t datatype, uint64_t now)
 {
-	slurm_mutex_lock(&locks_mutex);
+	entity_lock_t *lock = &entity_locks[datatype];
+
+	slurm_mutex_lock(&lock->mutex);
+	_add_hold(datatype, READ_LOCK, now);
 	slurmctld_locks.entity[read_lock(datatype)]--;
 	xassert(slurmctld_locks.entity[read_lock(datatype)] >= 0);
-	slurm_cond_broadcast(&locks_cond);
-	slurm_mutex_unlock(&locks_mutex);
+	/* Readers are only waiting if a writer is, let the writer go first */
+	if ((slurmctld_locks.entity[read_lock(datatype)] == 0) &&
+	    (slurmctld_locks.entity[write_wait_lock(datatype)] != 0))
+		slurm_cond_signal(&lock->write_cond);
+	slurm_mutex_unlock(&lock->mutex);
 }
 
-/* _wr_wrlock - Issue a write lock on the specified data type */
-static void _wr_wrlock(lock_datatype_t datatype)
+/* _wr_wrlock - Issue a write lock on the specified data type
+ *	IN/OUT now - time the wait started, set to the time the lock was granted
+ */
+static void _wr_wrlock(lock_datatype_t datatype, uint64_t *now)
 {
-	slurm_mutex_lock(&locks_mutex);
-	slurmctld_locks.entity[write_wait_lock(datatype)]++;
+	entity_lock_t *lock = &entity_locks[datatype];
 
-	while (1) {
-		if ((slurmctld_locks.entity[read_lock(datatype)] == 0) &&
-		    (slurmctld_locks.entity[write_lock(datatype)] == 0)) {
-			slurmctld_locks.entity[write_lock(datatype)]++;
-			slurmctld_locks.entity[write_wait_lock(datatype)]--;
-			slurmctld_locks.entity[write_cnt_lock(datatype)]++;
-			break;
-		} else {	/* wait for state change and retry */
-			slurm_cond_wait(&locks_cond, &locks_mutex);
-		}
+	slurm_mutex_lock(&lock->mutex);
+	slurmctld_locks.entity[write_wait_lock(datatype)]++;
+	while ((slurmctld_locks.entity[read_lock(datatype)] != 0) ||
+	       (slurmctld_locks.entity[write_lock(datatype)] != 0)) {
+		/* wait for state change and retry */
+		slurm_cond_wait(&lock->write_cond, &lock->mutex);
 	}
-	slurm_mutex_unlock(&locks_mutex);
+	slurmctld_locks.entity[write_lock(datatype)]++;
+	slurmctld_locks.entity[write_wait_lock(datatype)]--;
+	slurmctld_locks.entity[write_cnt_lock(datatype)]++;
+	_add_wait(datatype, WRITE_LOCK, now);
+	slurm_mutex_unlock(&lock->mutex);
 }
 
 /* _wr_wrunlock - Issue a write unlock on the specified data type */
-static void _wr_wrunlock(lock_datatype_t datatype)
+static void _wr_wrunlock(lock_datatype_t datatype, uint64_t now)
 {
-	slurm_mutex_lock(&locks_mutex);
+	entity_lock_t *lock = &entity_locks[datatype];
+
+	slurm_mutex_lock(&lock->mutex);
+	_add_hold(datatype, WRITE_LOCK, now);
 	slurmctld_locks.entity[write_lock(datatype)]--;
 	xassert(slurmctld_locks.entity[write_lock(datatype)] >= 0);
-	slurm_cond_broadcast(&locks_cond);
-	slurm_mutex_unlock(&locks_mutex);
+	/* Pending writers have priority over readers */
+	if (slurmctld_locks.entity[write_wait_lock(datatype)] != 0)
+		slurm_cond_signal(&lock->write_cond);
+	else
+		slurm_cond_broadcast(&lock->read_cond);
+	slurm_mutex_unlock(&lock->mutex);
 }
 
 /* get_lock_values - Get the current value of all locks
  * OUT lock_flags - a copy of the current lock values */
 void get_lock_values(slurmctld_lock_flags_t * lock_flags)
 {
+	int i;
+
 	xassert(lock_flags);
-	memcpy((void *) lock_flags, (void *) &slurmctld_locks,
-	       sizeof(slurmctld_locks));
+	for (i = 0; i < ENTITY_COUNT; i++) {
+		slurm_mutex_lock(&entity_locks[i].mutex);
+		memcpy((void *) &lock_flags->entity[read_lock(i)],
+		       (void *) &slurmctld_locks.entity[read_lock(i)],
+		       sizeof(int) * 4);
+		slurm_mutex_unlock(&entity_locks[i].mutex);
+	}
+}
+
+/* Pack statistics for every lock, lock level and caller granted any locks */
+extern void pack_lock_stats(Buf buffer)
+{
+	int ctld_cnt = ENTITY_COUNT * 2 * LOCK_CALLER_CNT;
+	int rec_cnt = ctld_cnt + (ASSOC_MGR_ENTITY_COUNT * 2 * LOCK_CALLER_CNT);
+	lock_stats_t *stats = xmalloc(sizeof(lock_stats_t) * rec_cnt);
+	char **name = xmalloc(sizeof(char *) * rec_cnt);
+	uint64_t *count = xmalloc(sizeof(uint64_t) * rec_cnt);
+	uint64_t *wait_time = xmalloc(sizeof(uint64_t) * rec_cnt);
+	uint64_t *wait_max = xmalloc(sizeof(uint64_t) * rec_cnt);
+	uint64_t *hold_time = xmalloc(sizeof(uint64_t) * rec_cnt);
+	uint64_t *hold_max = xmalloc(sizeof(uint64_t) * rec_cnt);
+	uint32_t *wait_hist = xmalloc(sizeof(uint32_t) * rec_cnt *
+				      LOCK_STATS_HIST_CNT);
+	uint32_t *hold_hist = xmalloc(sizeof(uint32_t) * rec_cnt *
+				      LOCK_STATS_HIST_CNT);
+	const char *type_str;
+	uint32_t cnt = 0;
+	int i, type;
+
+	for (i = 0; i < ENTITY_COUNT; i++) {
+		slurm_mutex_lock(&entity_locks[i].mutex);
+		memcpy(&stats[i * 2 * LOCK_CALLER_CNT], lock_stats[i],
+		       sizeof(lock_stats[i]));
+		slurm_mutex_unlock(&entity_locks[i].mutex);
+	}
+	assoc_mgr_get_lock_stats(&stats[ctld_cnt]);
+
+	/* Records are ordered by data type, then lock level, then caller */
+	for (i = 0; i < rec_cnt; i++) {
+		if (!stats[i].count)
+			continue;
+		type = i / (2 * LOCK_CALLER_CNT);
+		if (i < ctld_cnt)
+			type_str = entity_str[type];
+		else
+			type_str = assoc_entity_str[type - ENTITY_COUNT];
+		name[cnt] = xstrdup_printf(
+			"%s %s %s", type_str,
+			((i / LOCK_CALLER_CNT) % 2) ? "write" : "read",
+			lock_stats_caller_str(i % LOCK_CALLER_CNT));
+		count[cnt] = stats[i].count;
+		wait_time[cnt] = stats[i].wait_time;
+		wait_max[cnt] = stats[i].wait_max;
+		hold_time[cnt] = stats[i].hold_time;
+		hold_max[cnt] = stats[i].hold_max;
+		memcpy(&wait_hist[cnt * LOCK_STATS_HIST_CNT], stats[i].wait_hist,
+		       sizeof(stats[i].wait_hist));
+		memcpy(&hold_hist[cnt * LOCK_STATS_HIST_CNT], stats[i].hold_hist,
+		       sizeof(stats[i].hold_hist));
+		cnt++;
+	}
+
+	pack32(cnt, buffer);
+	pack32(LOCK_STATS_HIST_CNT, buffer);
+	packstr_array(name, cnt, buffer);
+	pack64_array(count, cnt, buffer);
+	pack64_array(wait_time, cnt, buffer);
+	pack64_array(wait_max, cnt, buffer);
+	pack64_array(hold_time, cnt, buffer);
+	pack64_array(hold_max, cnt, buffer);
+	pack32_array(wait_hist, cnt * LOCK_STATS_HIST_CNT, buffer);
+	pack32_array(hold_hist, cnt * LOCK_STATS_HIST_CNT, buffer);
+
+	for (i = 0; i < cnt; i++)
+		xfree(name[i]);
+	xfree(name);
+	xfree(stats);
+	xfree(count);
+	xfree(wait_time);
+	xfree(wait_max);
+	xfree(hold_time);
+	xfree(hold_max);
+	xfree(wait_hist);
+	xfree(hold_hist);
+}
+
+/* Clear all lock statistics */
+extern void reset_lock_stats(void)
+{
+	int i;
+
+	for (i = 0; i < ENTITY_COUNT; i++) {
+		slurm_mutex_lock(&entity_locks[i].mutex);
+		memset(lock_stats[i], 0, sizeof(lock_stats[i]));
+		slurm_mutex_unlock(&entity_locks[i].mutex);
+	}
+	assoc_mgr_reset_lock_stats();
 }
 
 /* un/lock semaphore used for saving state of slurmctld */
@@ -93,6 +93,8 @@
 
 #include <stdbool.h>
 
+#include "src/common/pack.h"
+
 /* levels of locking required for each data structure */
 typedef enum {
 	NO_LOCK,
@@ -156,6 +158,12 @@ extern void lock_slurmctld (slurmctld_lock_t lock_levels);
  *	defined order */
 extern void unlock_slurmctld (slurmctld_lock_t lock_levels);
 
+/* Pack statistics for every lock, lock level and caller granted any locks */
+extern void pack_lock_stats(Buf buffer);
+
+/* Clear all lock statistics */
+extern void reset_lock_stats(void);
+
 /* un/lock semaphore used for saving state of slurmctld */
 extern void lock_state_files ( void );
 extern void unlock_state_files ( void );
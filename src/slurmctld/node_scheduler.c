@@ -3050,9 +3050,9 @@ extern void launch_prolog(struct job_record *job_ptr)
 	cred_arg.step_hostlist   = job_ptr->job_resrcs->nodes;
 #endif
 
-	prolog_msg_ptr->cred = slurm_cred_create(slurmctld_config.cred_ctx,
-						 &cred_arg,
-						 SLURM_PROTOCOL_VERSION);
+	/* Signed by the agent, outside of the job locks */
+	prolog_msg_ptr->cred = slurm_cred_create_unsigned(
+		slurmctld_config.cred_ctx, &cred_arg, SLURM_PROTOCOL_VERSION);
 
 	agent_arg_ptr = (agent_arg_t *) xmalloc(sizeof(agent_arg_t));
 	agent_arg_ptr->retry = 0;
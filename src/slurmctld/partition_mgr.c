@@ -1118,6 +1118,27 @@ extern bool part_is_visible(struct part_record *part_ptr, uid_t uid)
 	return true;
 }
 
+/* partitions visible to a user may differ from those visible to another user.
+ * must had part read lock before calling */
+extern bool part_visibility_restricted(void)
+{
+	ListIterator part_iterator;
+	struct part_record *part_ptr;
+	bool rc = false;
+
+	part_iterator = list_iterator_create(part_list);
+	while ((part_ptr = (struct part_record *) list_next(part_iterator))) {
+		if ((part_ptr->flags & PART_FLAG_HIDDEN) ||
+		    part_ptr->allow_groups) {
+			rc = true;
+			break;
+		}
+	}
+	list_iterator_destroy(part_iterator);
+
+	return rc;
+}
+
 /*
  * pack_all_part - dump all partition information for all partitions in
  *	machine independent form (for network transmission)
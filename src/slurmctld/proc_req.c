@@ -62,6 +62,7 @@
 #include "src/common/group_cache.h"
 #include "src/common/hostlist.h"
 #include "src/common/layouts_mgr.h"
+#include "src/common/lock_stats.h"
 #include "src/common/log.h"
 #include "src/common/macros.h"
 #include "src/common/node_features.h"
@@ -89,6 +90,7 @@
 #include "src/slurmctld/fed_mgr.h"
 #include "src/slurmctld/front_end.h"
 #include "src/slurmctld/gang.h"
+#include "src/slurmctld/info_snapshot.h"
 #include "src/slurmctld/job_scheduler.h"
 #include "src/slurmctld/licenses.h"
 #include "src/slurmctld/locks.h"
@@ -111,6 +113,7 @@ static int rpc_type_size = 0;	/* Size of rpc_type_* arrays */
 static uint16_t *rpc_type_id = NULL;
 static uint32_t *rpc_type_cnt = NULL;
 static uint64_t *rpc_type_time = NULL;
+static uint64_t *rpc_type_lock_wait = NULL;	/* usec waiting for locks */
 static int rpc_user_size = 0;	/* Size of rpc_user_* arrays */
 static uint32_t *rpc_user_id = NULL;
 static uint32_t *rpc_user_cnt = NULL;
@@ -128,6 +131,8 @@ static int          _make_step_cred(struct step_record *step_rec,
 inline static void  _proc_multi_msg(uint32_t rpc_uid, slurm_msg_t *msg);
 static int          _route_msg_to_origin(slurm_msg_t *msg, char *job_id_str,
 					 uint32_t job_id, uid_t uid);
+static void         _send_info_snapshot(slurm_msg_t *msg, uint16_t msg_type,
+					info_snapshot_t *snap);
 static void         _throttle_fini(int *active_rpc_cnt);
 static void         _throttle_start(int *active_rpc_cnt);
 
@@ -258,6 +263,8 @@ void slurmctld_req(slurm_msg_t *msg, connection_arg_t *arg)
 	DEF_TIMERS;
 	int i, rpc_type_index = -1, rpc_user_index = -1;
 	uint32_t rpc_uid;
+	uint64_t lock_wait;
+	lock_caller_t old_caller;
 
 	if (arg && (arg->newsockfd >= 0))
 		fd_set_nonblocking(arg->newsockfd);
@@ -281,6 +288,7 @@ void slurmctld_req(slurm_msg_t *msg, connection_arg_t *arg)
 		rpc_type_id   = xmalloc(sizeof(uint16_t) * rpc_type_size);
 		rpc_type_cnt  = xmalloc(sizeof(uint32_t) * rpc_type_size);
 		rpc_type_time = xmalloc(sizeof(uint64_t) * rpc_type_size);
+		rpc_type_lock_wait = xmalloc(sizeof(uint64_t) * rpc_type_size);
 	}
 	for (i = 0; i < rpc_type_size; i++) {
 		if (rpc_type_id[i] == 0)
@@ -306,6 +314,10 @@ void slurmctld_req(slurm_msg_t *msg, connection_arg_t *arg)
 	}
 	slurm_mutex_unlock(&rpc_mutex);
 
+	/* Only count lock waits made while processing this RPC */
+	old_caller = lock_stats_set_caller(LOCK_CALLER_RPC);
+	(void) lock_stats_thread_wait();
+
 	/* Debug the protocol layer.
 	 */
 	START_TIMER;
@@ -611,16 +623,19 @@ void slurmctld_req(slurm_msg_t *msg, connection_arg_t *arg)
 	}
 
 	END_TIMER;
+	lock_wait = lock_stats_thread_wait();
 	slurm_mutex_lock(&rpc_mutex);
 	if (rpc_type_index >= 0) {
 		rpc_type_cnt[rpc_type_index]++;
 		rpc_type_time[rpc_type_index] += DELTA_TIMER;
+		rpc_type_lock_wait[rpc_type_index] += lock_wait;
 	}
 	if (rpc_user_index >= 0) {
 		rpc_user_cnt[rpc_user_index]++;
 		rpc_user_time[rpc_user_index] += DELTA_TIMER;
 	}
 	slurm_mutex_unlock(&rpc_mutex);
+	lock_stats_set_caller(old_caller);
 }
 
 /* These functions prevent certain RPCs from keeping the slurmctld write locks
@@ -1024,7 +1039,10 @@ static void _kill_job_on_msg_fail(uint32_t job_id)
 	unlock_slurmctld(job_write_lock);
 }
 
-/* create a credential for a given job step, return error code */
+/*
+ * create an unsigned credential for a given job step, return error code.
+ * It is signed once the job locks have been released.
+ */
 static int _make_step_cred(struct step_record *step_ptr,
 			   slurm_cred_t **slurm_cred, uint16_t protocol_version)
 {
@@ -1080,8 +1098,8 @@ static int _make_step_cred(struct step_record *step_ptr,
 	cred_arg.sockets_per_node    = job_resrcs_ptr->sockets_per_node;
 	cred_arg.sock_core_rep_count = job_resrcs_ptr->sock_core_rep_count;
 
-	*slurm_cred = slurm_cred_create(slurmctld_config.cred_ctx, &cred_arg,
-					protocol_version);
+	*slurm_cred = slurm_cred_create_unsigned(slurmctld_config.cred_ctx,
+						 &cred_arg, protocol_version);
 
 	if (*slurm_cred == NULL) {
 		error("slurm_cred_create error");
@@ -1687,6 +1705,24 @@ static void _slurm_rpc_dump_conf(slurm_msg_t * msg)
 	}
 }
 
+/* Send a shared, already packed, job or node information response */
+static void _send_info_snapshot(slurm_msg_t *msg, uint16_t msg_type,
+				info_snapshot_t *snap)
+{
+	slurm_msg_t response_msg;
+
+	slurm_msg_t_init(&response_msg);
+	response_msg.flags = msg->flags;
+	response_msg.protocol_version = msg->protocol_version;
+	response_msg.address = msg->address;
+	response_msg.conn = msg->conn;
+	response_msg.msg_type = msg_type;
+	response_msg.data = snap->data;
+	response_msg.data_size = snap->size;
+
+	slurm_send_node_msg(msg->conn_fd, &response_msg);
+}
+
 /* _slurm_rpc_dump_jobs - process RPC for job state information */
 static void _slurm_rpc_dump_jobs(slurm_msg_t * msg)
 {
@@ -1696,6 +1732,7 @@ static void _slurm_rpc_dump_jobs(slurm_msg_t * msg)
 	slurm_msg_t response_msg;
 	job_info_request_msg_t *job_info_request_msg =
 		(job_info_request_msg_t *) msg->data;
+	info_snapshot_t *snap;
 	/* Locks: Read config job part */
 	slurmctld_lock_t job_read_lock = {
 		READ_LOCK, READ_LOCK, NO_LOCK, READ_LOCK, READ_LOCK };
@@ -1704,6 +1741,18 @@ static void _slurm_rpc_dump_jobs(slurm_msg_t * msg)
 
 	START_TIMER;
 	debug3("Processing RPC: REQUEST_JOB_INFO from uid=%d", uid);
+
+	if (!job_info_request_msg->job_ids &&
+	    ((job_info_request_msg->last_update - 1) < last_job_update) &&
+	    (snap = info_snapshot_acquire(INFO_SNAPSHOT_JOBS,
+					  job_info_request_msg->show_flags,
+					  uid, msg->protocol_version))) {
+		END_TIMER2("_slurm_rpc_dump_jobs");
+		_send_info_snapshot(msg, RESPONSE_JOB_INFO, snap);
+		info_snapshot_release(snap);
+		return;
+	}
+
 	lock_slurmctld(job_read_lock);
 
 	if ((job_info_request_msg->last_update - 1) >= last_job_update) {
@@ -2010,6 +2059,7 @@ static void _slurm_rpc_dump_nodes(slurm_msg_t * msg)
 	slurm_msg_t response_msg;
 	node_info_request_msg_t *node_req_msg =
 		(node_info_request_msg_t *) msg->data;
+	info_snapshot_t *snap;
 	/* Locks: Read config, write node (reset allocated CPU count in some
 	 * select plugins), read part (for part_is_visible) */
 	slurmctld_lock_t node_write_lock = {
@@ -2028,6 +2078,16 @@ static void _slurm_rpc_dump_nodes(slurm_msg_t * msg)
 		return;
 	}
 
+	if (((node_req_msg->last_update - 1) < last_node_update) &&
+	    (snap = info_snapshot_acquire(INFO_SNAPSHOT_NODES,
+					  node_req_msg->show_flags,
+					  uid, msg->protocol_version))) {
+		END_TIMER2("_slurm_rpc_dump_nodes");
+		_send_info_snapshot(msg, RESPONSE_NODE_INFO, snap);
+		info_snapshot_release(snap);
+		return;
+	}
+
 	lock_slurmctld(node_write_lock);
 
 	select_g_select_nodeinfo_set_all();
@@ -2797,6 +2857,18 @@ static void _slurm_rpc_job_step_create(slurm_msg_t * msg)
 
 		unlock_slurmctld(job_write_lock);
 		_throttle_fini(&active_rpc_cnt);
+
+		if (slurm_cred_sign_batch(slurmctld_config.cred_ctx,
+					  &slurm_cred, 1) != SLURM_SUCCESS) {
+			error("%s: unable to sign credential for step %u.%u",
+			      __func__, req_step_msg->job_id,
+			      job_step_resp.job_step_id);
+			slurm_send_rc_msg(msg, ESLURM_INVALID_JOB_CREDENTIAL);
+			slurm_cred_destroy(slurm_cred);
+			schedule_job_save();	/* Sets own locks */
+			return;
+		}
+
 		slurm_msg_t_init(&resp);
 		resp.flags = msg->flags;
 		resp.protocol_version = msg->protocol_version;
@@ -6274,6 +6346,7 @@ static void _clear_rpc_stats(void)
 		rpc_type_cnt[i] = 0;
 		rpc_type_id[i] = 0;
 		rpc_type_time[i] = 0;
+		rpc_type_lock_wait[i] = 0;
 	}
 	for (i = 0; i < rpc_user_size; i++) {
 		rpc_user_cnt[i] = 0;
@@ -6300,6 +6373,8 @@ static void _pack_rpc_stats(int resp, char **buffer_ptr, int *buffer_size,
 	pack16_array(rpc_type_id,   i, buffer);
 	pack32_array(rpc_type_cnt,  i, buffer);
 	pack64_array(rpc_type_time, i, buffer);
+	if (protocol_version >= SLURM_18_08_PROTOCOL_VERSION)
+		pack64_array(rpc_type_lock_wait, i, buffer);
 
 	for (i = 1; i < rpc_user_size; i++) {
 		if (rpc_user_id[i] == 0)
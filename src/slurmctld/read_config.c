@@ -48,6 +48,7 @@
 #include <string.h>
 #include <syslog.h>
 #include <sys/stat.h>
+#include <sys/time.h>
 #include <sys/types.h>
 #include <time.h>
 #include <unistd.h>
@@ -982,6 +983,24 @@ static void _validate_pack_jobs(void)
 	list_for_each(job_list, _test_pack_used, NULL);
 }
 
+/*
+ * Add the time since *phase_tv to the list of phase times in *phase_str and
+ * restart the phase timer
+ */
+static void _phase_time(struct timeval *phase_tv, char *phase,
+			char **phase_str)
+{
+	struct timeval now;
+	long delta;
+
+	gettimeofday(&now, NULL);
+	delta = (now.tv_sec - phase_tv->tv_sec) * 1000000 +
+		(now.tv_usec - phase_tv->tv_usec);
+	xstrfmtcat(*phase_str, "%s%s=%ld", *phase_str ? " " : "", phase,
+		   delta);
+	*phase_tv = now;
+}
+
 /*
  * read_slurm_conf - load the slurm configuration from the configured file.
  * read_slurm_conf can be called more than once if so desired.
@@ -1016,11 +1035,13 @@ int read_slurm_conf(int recover, bool reconfig)
 	char *old_select_type     = xstrdup(slurmctld_conf.select_type);
 	char *old_switch_type     = xstrdup(slurmctld_conf.switch_type);
 	char *state_save_dir      = xstrdup(slurmctld_conf.state_save_location);
-	char *mpi_params;
+	char *mpi_params, *phase_str = NULL;
 	uint16_t old_select_type_p = slurmctld_conf.select_type_param;
+	struct timeval phase_tv;
 
 	/* initialization */
 	START_TIMER;
+	gettimeofday(&phase_tv, NULL);
 
 	xfree(slurmctld_config.auth_info);
 	slurmctld_config.auth_info = slurm_get_auth_info();
@@ -1147,6 +1168,7 @@ int read_slurm_conf(int recover, bool reconfig)
 	 */
 	if (!reconfig && (layouts_load_config(recover) != SLURM_SUCCESS))
 		fatal("Failed to load the layouts framework configuration");
+	_phase_time(&phase_tv, "config", &phase_str);
 
 	if (reconfig) {		/* Preserve state from memory */
 		if (old_node_table_ptr) {
@@ -1180,14 +1202,19 @@ int read_slurm_conf(int recover, bool reconfig)
 	} else if (recover == 1) {	/* Load job & node state files */
 		(void) load_all_node_state(true);
 		(void) load_all_front_end_state(true);
+		_phase_time(&phase_tv, "node_state", &phase_str);
 		load_job_ret = load_all_job_state();
 		sync_job_priorities();
+		_phase_time(&phase_tv, "job_state", &phase_str);
 	} else if (recover > 1) {	/* Load node, part & job state files */
 		(void) load_all_node_state(false);
 		(void) load_all_front_end_state(false);
+		_phase_time(&phase_tv, "node_state", &phase_str);
 		(void) load_all_part_state();
+		_phase_time(&phase_tv, "part_state", &phase_str);
 		load_job_ret = load_all_job_state();
 		sync_job_priorities();
+		_phase_time(&phase_tv, "job_state", &phase_str);
 	}
 
 	_sync_part_prio();
@@ -1200,10 +1227,12 @@ int read_slurm_conf(int recover, bool reconfig)
 		fatal("failed to initialize node selection plugin state, "
 		      "Clean start required.");
 	}
+	_phase_time(&phase_tv, "select_init", &phase_str);
 
 	xfree(state_save_dir);
 	_gres_reconfig(reconfig);
 	reset_job_bitmaps();		/* must follow select_g_job_init() */
+	_phase_time(&phase_tv, "job_bitmaps", &phase_str);
 
 	(void) _sync_nodes_to_jobs(reconfig);
 	(void) sync_job_files();
@@ -1245,19 +1274,25 @@ int read_slurm_conf(int recover, bool reconfig)
 	_validate_pack_jobs();
 	(void) _sync_nodes_to_comp_job();/* must follow select_g_node_init() */
 	load_part_uid_allow_list(1);
+	_phase_time(&phase_tv, "node_sync", &phase_str);
 
 	if (reconfig) {
 		load_all_resv_state(0);
+		_phase_time(&phase_tv, "resv_state", &phase_str);
 	} else {
 		load_all_resv_state(recover);
+		_phase_time(&phase_tv, "resv_state", &phase_str);
 		if (recover >= 1) {
 			trigger_state_restore();
+			_phase_time(&phase_tv, "trigger_state", &phase_str);
 			(void) slurm_sched_g_reconfig();
+			_phase_time(&phase_tv, "sched_reconfig", &phase_str);
 		}
 	}
 
 	/* NOTE: Run load_all_resv_state() before _restore_job_dependencies */
 	_restore_job_dependencies();
+	_phase_time(&phase_tv, "job_depend", &phase_str);
 
 	/* sort config_list by weight for scheduling */
 	list_sort(config_list, &list_compare_config);
@@ -1310,6 +1345,12 @@ int read_slurm_conf(int recover, bool reconfig)
 	}
 
 	slurmctld_conf.last_update = time(NULL);
+	_phase_time(&phase_tv, "plugins", &phase_str);
+	if (reconfig)
+		debug("%s: phase times (usec) %s", __func__, phase_str);
+	else
+		info("%s: phase times (usec) %s", __func__, phase_str);
+	xfree(phase_str);
 	END_TIMER2("read_slurm_conf");
 	return error_code;
 }
@@ -0,0 +1,630 @@
+/*****************************************************************************\
+ *  rpc_queue.c - event driven RPC front end for slurmctld
+ *****************************************************************************
+ *  Copyright (C) 2018 SchedMD LLC.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+
+#include "config.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#if HAVE_SYS_PRCTL_H
+#  include <sys/prctl.h>
+#endif
+
+#include "src/common/fd.h"
+#include "src/common/list.h"
+#include "src/common/log.h"
+#include "src/common/macros.h"
+#include "src/common/pack.h"
+#include "src/common/read_config.h"
+#include "src/common/slurm_protocol_api.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+
+#include "src/slurmctld/proc_req.h"
+#include "src/slurmctld/rpc_queue.h"
+#include "src/slurmctld/slurmctld.h"
+
+#define DEFAULT_QUERY_THREADS	8
+#define DEFAULT_UPDATE_THREADS	8
+#define MAX_EPOLL_EVENTS	128
+#define MAX_OPEN_CONN		8192
+#define MAX_MSG_SIZE		(1024*1024*1024)
+#define ACCEPT_RETRY_DELAY	1	/* seconds, after EMFILE or ENFILE */
+
+/* Connection which is still receiving its message */
+typedef struct rpc_conn {
+	int fd;
+	slurm_addr_t cli_addr;
+	uint32_t msg_len;	/* body length, host order once complete */
+	uint32_t len_read;	/* bytes of the length prefix received */
+	char *data;		/* message body */
+	uint32_t data_read;	/* bytes of the body received */
+	time_t start_time;
+	struct rpc_conn *next;
+	struct rpc_conn *prev;
+} rpc_conn_t;
+
+/* Complete message waiting for a worker thread */
+typedef struct {
+	connection_arg_t *conn_arg;
+	Buf buffer;
+} rpc_work_t;
+
+typedef struct {
+	char *name;		/* worker thread name */
+	List work_list;		/* rpc_work_t records */
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	int thread_cnt;
+	pthread_t *thread_id;
+} rpc_queue_t;
+
+static bool queue_shutdown = false;
+static rpc_queue_t query_queue = {
+	"rpcq_query", NULL, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER,
+	0, NULL
+};
+static rpc_queue_t update_queue = {
+	"rpcq_update", NULL, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER,
+	0, NULL
+};
+
+static rpc_conn_t *conn_head = NULL;
+static int conn_cnt = 0;		/* connections receiving a message */
+
+/* Connections queued or being serviced, their file descriptors are open */
+static pthread_mutex_t work_cnt_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int work_cnt = 0;
+
+extern bool rpc_queue_enabled(void)
+{
+	char *sched_params = slurm_get_sched_params();
+	bool rc = false;
+
+	if (sched_params && strstr(sched_params, "enable_rpc_queue"))
+		rc = true;
+	xfree(sched_params);
+
+	return rc;
+}
+
+static int _get_thread_cnt(char *sched_params, char *key, int def_cnt)
+{
+	char *tmp_ptr;
+	int cnt;
+
+	if (!sched_params || !(tmp_ptr = strstr(sched_params, key)))
+		return def_cnt;
+
+	cnt = atoi(tmp_ptr + strlen(key));
+	if ((cnt < 1) || (cnt > MAX_SERVER_THREADS)) {
+		error("Invalid SchedulerParameters %s%d", key, cnt);
+		cnt = def_cnt;
+	}
+
+	return cnt;
+}
+
+/*
+ * Classify a message by type without verifying its credential. Only the
+ * fixed leading fields of the header are read, the buffer offset is restored.
+ * RET true if the RPC only reads slurmctld state
+ */
+static bool _is_query_rpc(Buf buffer)
+{
+	uint16_t version = 0, flags, msg_index, msg_type = 0;
+
+	if ((unpack16(&version, buffer) != SLURM_SUCCESS) ||
+	    (version < SLURM_MIN_PROTOCOL_VERSION) ||
+	    (unpack16(&flags, buffer) != SLURM_SUCCESS) ||
+	    (unpack16(&msg_index, buffer) != SLURM_SUCCESS) ||
+	    (unpack16(&msg_type, buffer) != SLURM_SUCCESS))
+		msg_type = 0;
+	set_buf_offset(buffer, 0);
+
+	switch (msg_type) {
+	case REQUEST_ASSOC_MGR_INFO:
+	case REQUEST_BUILD_INFO:
+	case REQUEST_BURST_BUFFER_INFO:
+	case REQUEST_FED_INFO:
+	case REQUEST_FRONT_END_INFO:
+	case REQUEST_JOB_ALLOCATION_INFO:
+	case REQUEST_JOB_INFO:
+	case REQUEST_JOB_INFO_SINGLE:
+	case REQUEST_JOB_PACK_ALLOC_INFO:
+	case REQUEST_JOB_READY:
+	case REQUEST_JOB_STEP_INFO:
+	case REQUEST_JOB_USER_INFO:
+	case REQUEST_LAYOUT_INFO:
+	case REQUEST_LICENSE_INFO:
+	case REQUEST_NODE_INFO:
+	case REQUEST_NODE_INFO_SINGLE:
+	case REQUEST_PARTITION_INFO:
+	case REQUEST_PING:
+	case REQUEST_POWERCAP_INFO:
+	case REQUEST_PRIORITY_FACTORS:
+	case REQUEST_RESERVATION_INFO:
+	case REQUEST_SHARE_INFO:
+	case REQUEST_STATS_INFO:
+	case REQUEST_TOPO_INFO:
+	case REQUEST_TRIGGER_GET:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/* Decode one message and process it, this is what _service_connection()
+ * does for the thread per connection model */
+static void _service_work(rpc_work_t *work)
+{
+	connection_arg_t *conn = work->conn_arg;
+	slurm_msg_t msg;
+
+	slurm_msg_t_init(&msg);
+	msg.flags |= SLURM_MSG_KEEP_BUFFER;
+	msg.conn_fd = conn->newsockfd;
+
+	if (slurm_unpack_received_msg(&msg, conn->newsockfd,
+				      work->buffer) != 0) {
+		char addr_buf[32];
+		slurm_print_slurm_addr(&conn->cli_addr, addr_buf,
+				       sizeof(addr_buf));
+		error("%s: [%s]: %m", __func__, addr_buf);
+		if (errno == SLURM_PROTOCOL_VERSION_ERROR)
+			slurm_send_rc_msg(&msg, SLURM_PROTOCOL_VERSION_ERROR);
+		free_buf(work->buffer);
+	} else {
+		msg.buffer = work->buffer;
+		slurmctld_req(&msg, conn);
+	}
+
+	if ((conn->newsockfd >= 0) && (close(conn->newsockfd) < 0))
+		error("close(%d): %m", conn->newsockfd);
+	slurm_mutex_lock(&work_cnt_mutex);
+	work_cnt--;
+	slurm_mutex_unlock(&work_cnt_mutex);
+
+	slurm_free_msg_members(&msg);
+	xfree(conn);
+	xfree(work);
+	server_thread_decr();
+}
+
+static void *_rpc_worker(void *arg)
+{
+	rpc_queue_t *queue = (rpc_queue_t *) arg;
+	rpc_work_t *work;
+
+#if HAVE_SYS_PRCTL_H
+	if (prctl(PR_SET_NAME, queue->name, NULL, NULL, NULL) < 0) {
+		error("%s: cannot set my name to %s %m", __func__, queue->name);
+	}
+#endif
+
+	while (1) {
+		slurm_mutex_lock(&queue->mutex);
+		while (!queue_shutdown && !list_count(queue->work_list))
+			slurm_cond_wait(&queue->cond, &queue->mutex);
+		work = list_dequeue(queue->work_list);
+		slurm_mutex_unlock(&queue->mutex);
+
+		if (!work)	/* shutdown and queue drained */
+			break;
+		_service_work(work);
+	}
+
+	return NULL;
+}
+
+static void _queue_start(rpc_queue_t *queue, int thread_cnt)
+{
+	int i;
+
+	queue->work_list = list_create(NULL);
+	queue->thread_cnt = thread_cnt;
+	queue->thread_id = xmalloc(sizeof(pthread_t) * thread_cnt);
+	for (i = 0; i < thread_cnt; i++)
+		slurm_thread_create(&queue->thread_id[i], _rpc_worker, queue);
+	debug("%s: started %d %s threads", __func__, thread_cnt, queue->name);
+}
+
+/* Workers finish any queued work before exiting */
+static void _queue_stop(rpc_queue_t *queue)
+{
+	int i;
+
+	slurm_mutex_lock(&queue->mutex);
+	slurm_cond_broadcast(&queue->cond);
+	slurm_mutex_unlock(&queue->mutex);
+
+	for (i = 0; i < queue->thread_cnt; i++)
+		pthread_join(queue->thread_id[i], NULL);
+	xfree(queue->thread_id);
+	queue->thread_cnt = 0;
+	FREE_NULL_LIST(queue->work_list);
+}
+
+static void _queue_work(rpc_conn_t *conn)
+{
+	rpc_work_t *work = xmalloc(sizeof(rpc_work_t));
+	rpc_queue_t *queue;
+
+	work->conn_arg = xmalloc(sizeof(connection_arg_t));
+	work->conn_arg->newsockfd = conn->fd;
+	memcpy(&work->conn_arg->cli_addr, &conn->cli_addr,
+	       sizeof(slurm_addr_t));
+	work->buffer = create_buf(conn->data, conn->msg_len);
+	conn->data = NULL;	/* now owned by buffer */
+
+	if (_is_query_rpc(work->buffer))
+		queue = &query_queue;
+	else
+		queue = &update_queue;
+
+	/* Counted as an active RPC (see max_rpc_cnt) until serviced */
+	server_thread_incr();
+	slurm_mutex_lock(&work_cnt_mutex);
+	work_cnt++;
+	slurm_mutex_unlock(&work_cnt_mutex);
+	slurm_mutex_lock(&queue->mutex);
+	list_enqueue(queue->work_list, work);
+	slurm_cond_signal(&queue->cond);
+	slurm_mutex_unlock(&queue->mutex);
+}
+
+/* RET count of open connection file descriptors */
+static int _open_conn_cnt(void)
+{
+	int cnt;
+
+	slurm_mutex_lock(&work_cnt_mutex);
+	cnt = conn_cnt + work_cnt;
+	slurm_mutex_unlock(&work_cnt_mutex);
+
+	return cnt;
+}
+
+static void _conn_link(rpc_conn_t *conn)
+{
+	conn->prev = NULL;
+	conn->next = conn_head;
+	if (conn_head)
+		conn_head->prev = conn;
+	conn_head = conn;
+	conn_cnt++;
+}
+
+static void _conn_unlink(int epoll_fd, rpc_conn_t *conn)
+{
+	if (conn->prev)
+		conn->prev->next = conn->next;
+	else
+		conn_head = conn->next;
+	if (conn->next)
+		conn->next->prev = conn->prev;
+	conn_cnt--;
+
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL) < 0)
+		error("%s: epoll_ctl(DEL, %d): %m", __func__, conn->fd);
+}
+
+static void _conn_free(rpc_conn_t *conn, bool close_fd)
+{
+	if (close_fd && (close(conn->fd) < 0))
+		error("close(%d): %m", conn->fd);
+	xfree(conn->data);
+	xfree(conn);
+}
+
+/*
+ * Read whatever is available on a non-blocking connection.
+ * RET 1 if the message is complete, 0 if more data is needed,
+ *     -1 on error or EOF
+ */
+static int _conn_read(rpc_conn_t *conn)
+{
+	ssize_t len;
+
+	while (conn->len_read < sizeof(conn->msg_len)) {
+		len = read(conn->fd, ((char *) &conn->msg_len) + conn->len_read,
+			   sizeof(conn->msg_len) - conn->len_read);
+		if (len == 0)
+			return -1;
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+				return 0;
+			return -1;
+		}
+		conn->len_read += len;
+		if (conn->len_read < sizeof(conn->msg_len))
+			continue;
+
+		conn->msg_len = ntohl(conn->msg_len);
+		if ((conn->msg_len == 0) || (conn->msg_len > MAX_MSG_SIZE)) {
+			slurm_seterrno(SLURM_PROTOCOL_INSANE_MSG_LENGTH);
+			return -1;
+		}
+		conn->data = xmalloc_nz(conn->msg_len);
+	}
+
+	while (conn->data_read < conn->msg_len) {
+		len = read(conn->fd, conn->data + conn->data_read,
+			   conn->msg_len - conn->data_read);
+		if (len == 0)
+			return -1;
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+				return 0;
+			return -1;
+		}
+		conn->data_read += len;
+	}
+
+	return 1;
+}
+
+static void _conn_error(int epoll_fd, rpc_conn_t *conn, char *reason)
+{
+	char addr_buf[32];
+
+	slurm_print_slurm_addr(&conn->cli_addr, addr_buf, sizeof(addr_buf));
+	error("%s: [%s]: %s", __func__, addr_buf, reason);
+	_conn_unlink(epoll_fd, conn);
+	_conn_free(conn, true);
+}
+
+static void _conn_ready(int epoll_fd, rpc_conn_t *conn)
+{
+	int rc = _conn_read(conn);
+
+	if (rc == 0)
+		return;
+	if (rc < 0) {
+		_conn_error(epoll_fd, conn, slurm_strerror(errno));
+		return;
+	}
+
+	/* Workers send the reply with blocking I/O */
+	_conn_unlink(epoll_fd, conn);
+	fd_set_blocking(conn->fd);
+	_queue_work(conn);
+	_conn_free(conn, false);
+}
+
+/* Drop connections which have not sent a complete message in MessageTimeout */
+static void _conn_expire(int epoll_fd)
+{
+	time_t cutoff = time(NULL) - slurm_get_msg_timeout();
+	rpc_conn_t *conn = conn_head, *next;
+
+	while (conn) {
+		next = conn->next;
+		if (conn->start_time < cutoff)
+			_conn_error(epoll_fd, conn, "message receive timeout");
+		conn = next;
+	}
+}
+
+/*
+ * RET false if no more connections can be accepted for now, either because
+ * max_conn are open or because we ran out of file descriptors (fd_errno set
+ * to EMFILE or ENFILE)
+ */
+static bool _conn_accept(int epoll_fd, int listen_fd, int max_conn,
+			 int *fd_errno)
+{
+	struct epoll_event ev;
+	slurm_addr_t cli_addr;
+	rpc_conn_t *conn;
+	int newsockfd;
+
+	while (_open_conn_cnt() < max_conn) {
+		if ((newsockfd = slurm_accept_msg_conn(listen_fd, &cli_addr)) ==
+		    SLURM_SOCKET_ERROR) {
+			if ((errno == EMFILE) || (errno == ENFILE)) {
+				*fd_errno = errno;
+				return false;
+			}
+			if ((errno != EAGAIN) && (errno != EWOULDBLOCK) &&
+			    (errno != EINTR))
+				error("slurm_accept_msg_conn: %m");
+			return true;
+		}
+		fd_set_close_on_exec(newsockfd);
+		fd_set_nonblocking(newsockfd);
+
+		if (slurmctld_conf.debug_flags & DEBUG_FLAG_PROTOCOL) {
+			char inetbuf[64];
+
+			slurm_print_slurm_addr(&cli_addr, inetbuf,
+					       sizeof(inetbuf));
+			info("%s: accept() connection from %s",
+			     __func__, inetbuf);
+		}
+
+		conn = xmalloc(sizeof(rpc_conn_t));
+		conn->fd = newsockfd;
+		memcpy(&conn->cli_addr, &cli_addr, sizeof(slurm_addr_t));
+		conn->start_time = time(NULL);
+
+		memset(&ev, 0, sizeof(ev));
+		ev.events = EPOLLIN;
+		ev.data.ptr = conn;
+		if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, newsockfd, &ev) < 0) {
+			error("%s: epoll_ctl(ADD, %d): %m", __func__, newsockfd);
+			_conn_free(conn, true);
+			continue;
+		}
+		_conn_link(conn);
+	}
+
+	return false;
+}
+
+/* Stop or resume polling of the listening sockets */
+static void _listen_poll(int epoll_fd, int *sockfd, int nports, bool enable)
+{
+	struct epoll_event ev;
+	int i;
+
+	for (i = 0; i < nports; i++) {
+		memset(&ev, 0, sizeof(ev));
+		ev.events = enable ? EPOLLIN : 0;
+		ev.data.ptr = &sockfd[i];
+		if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, sockfd[i], &ev) < 0)
+			error("%s: epoll_ctl(MOD, %d): %m", __func__, sockfd[i]);
+	}
+}
+
+static int _get_max_conn(void)
+{
+	struct rlimit rlim;
+
+	/* Leave file descriptors for state files, agents, plugins, etc. */
+	if (getrlimit(RLIMIT_NOFILE, &rlim) == 0)
+		return MAX(MIN(MAX_OPEN_CONN, (int) (rlim.rlim_cur / 2)),
+			   MAX_SERVER_THREADS);
+	return MAX_SERVER_THREADS;
+}
+
+extern void rpc_queue_mgr(int *sockfd, int nports)
+{
+	struct epoll_event ev, events[MAX_EPOLL_EVENTS];
+	char *sched_params = slurm_get_sched_params();
+	int epoll_fd, i, nfds, max_conn, paused_cnt = 0, fd_errno;
+	bool listening = true;
+	time_t resume_time = 0;
+	rpc_conn_t *conn;
+
+	queue_shutdown = false;
+	_queue_start(&query_queue,
+		     _get_thread_cnt(sched_params, "rpc_queue_query_threads=",
+				     DEFAULT_QUERY_THREADS));
+	_queue_start(&update_queue,
+		     _get_thread_cnt(sched_params, "rpc_queue_update_threads=",
+				     DEFAULT_UPDATE_THREADS));
+	xfree(sched_params);
+
+	max_conn = _get_max_conn();
+	if ((epoll_fd = epoll_create1(EPOLL_CLOEXEC)) < 0)
+		fatal("%s: epoll_create1: %m", __func__);
+	for (i = 0; i < nports; i++) {
+		fd_set_nonblocking(sockfd[i]);
+		memset(&ev, 0, sizeof(ev));
+		ev.events = EPOLLIN;
+		ev.data.ptr = &sockfd[i];
+		if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, sockfd[i], &ev) < 0)
+			fatal("%s: epoll_ctl(ADD, %d): %m", __func__, sockfd[i]);
+	}
+	debug("%s: servicing RPCs with up to %d open connections",
+	      __func__, max_conn);
+
+	while (!slurmctld_config.shutdown_time) {
+		/* Wake periodically to expire stalled connections */
+		nfds = epoll_wait(epoll_fd, events, MAX_EPOLL_EVENTS, 1000);
+		if (nfds < 0) {
+			if (errno != EINTR)
+				error("%s: epoll_wait: %m", __func__);
+			continue;
+		}
+
+		for (i = 0; i < nfds; i++) {
+			int *fd_ptr = events[i].data.ptr;
+
+			if ((fd_ptr >= sockfd) && (fd_ptr < (sockfd + nports))) {
+				fd_errno = 0;
+				if (!listening ||
+				    _conn_accept(epoll_fd, *fd_ptr, max_conn,
+						 &fd_errno))
+					continue;
+				/*
+				 * The listening sockets are level triggered,
+				 * stop polling them until connections close
+				 */
+				paused_cnt = _open_conn_cnt();
+				if (fd_errno) {
+					error("%s: accept: %s with %d connections open, waiting",
+					      __func__, slurm_strerror(fd_errno),
+					      paused_cnt);
+					resume_time = time(NULL) +
+						      ACCEPT_RETRY_DELAY;
+				} else {
+					verbose("%s: open connection count "
+						"over limit (%d), waiting",
+						__func__, max_conn);
+					resume_time = 0;
+				}
+				_listen_poll(epoll_fd, sockfd, nports, false);
+				listening = false;
+				continue;
+			}
+			_conn_ready(epoll_fd, events[i].data.ptr);
+		}
+
+		_conn_expire(epoll_fd);
+
+		/*
+		 * Resume once a connection closed, or after a delay if out of
+		 * file descriptors for some other reason
+		 */
+		if (!listening &&
+		    ((_open_conn_cnt() < paused_cnt) ||
+		     (resume_time && (time(NULL) >= resume_time)))) {
+			_listen_poll(epoll_fd, sockfd, nports, true);
+			listening = true;
+		}
+	}
+
+	debug3("%s: shutting down", __func__);
+	while ((conn = conn_head)) {
+		_conn_unlink(epoll_fd, conn);
+		_conn_free(conn, true);
+	}
+	(void) close(epoll_fd);
+
+	queue_shutdown = true;
+	_queue_stop(&query_queue);
+	_queue_stop(&update_queue);
+}
@@ -0,0 +1,59 @@
+/*****************************************************************************\
+ *  rpc_queue.h - event driven RPC front end for slurmctld
+ *****************************************************************************
+ *  Copyright (C) 2018 SchedMD LLC.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _SLURM_RPC_QUEUE_H
+#define _SLURM_RPC_QUEUE_H
+
+#include <stdbool.h>
+
+/*
+ * Return true if SchedulerParameters=enable_rpc_queue is configured, in
+ * which case rpc_queue_mgr() replaces the thread per connection model.
+ */
+extern bool rpc_queue_enabled(void);
+
+/*
+ * Service incoming RPCs on the listening sockets until slurmctld shuts down.
+ * Connections are accepted and read with epoll from the calling thread.
+ * Complete messages are handed to a fixed pool of worker threads which
+ * decode them and call slurmctld_req(). Query RPCs and RPCs which modify
+ * state are serviced from separate queues and worker pools so a flood of
+ * one can not starve the other.
+ * IN sockfd - array of listening sockets
+ * IN nports - size of sockfd
+ */
+extern void rpc_queue_mgr(int *sockfd, int nports);
+
+#endif /* !_SLURM_RPC_QUEUE_H */
@@ -675,9 +675,7 @@ struct job_record {
 					 * to be passed to slurmdbd */
 	uint32_t group_id;		/* group submitted under */
 	uint32_t job_id;		/* job ID */
-	struct job_record *job_next;	/* next entry with same hash index */
-	struct job_record *job_array_next_j; /* job array linked list by job_id */
-	struct job_record *job_array_next_t; /* job array linked list by task_id */
+	struct job_record *job_array_next_j; /* next task of same job array */
 	job_resources_t *job_resrcs;	/* details of allocated cores */
 	uint32_t job_state;		/* state of the job */
 	uint16_t kill_on_node_fail;	/* 1 if job should be killed on
@@ -723,6 +721,8 @@ struct job_record {
 	char *origin_cluster;		/* cluster name that the job was
 					 * submitted from */
 	uint16_t other_port;		/* port for client communications */
+	struct job_pack_cache *pack_cache; /* cached pack_job() output of a
+					 * pending job, see job_mgr.c */
 	uint32_t pack_job_id;		/* lead job ID of pack job leader */
 	char *pack_job_id_set;		/* job IDs for all components */
 	uint32_t pack_job_offset;	/* pack job index */
@@ -780,6 +780,8 @@ struct job_record {
 					 * return valid job information during
 					 * scheduling cycle (state_reason is
 					 * cleared at start of cycle) */
+	uint64_t state_save_hash;	/* hash of state last saved to job
+					 * state journal, 0 if none */
 	List step_list;			/* list of job's steps */
 	time_t suspend_time;		/* time job last suspended or resumed */
 	char *system_comment;		/* slurmctld's arbitrary comment */
@@ -1997,6 +1999,13 @@ extern void pack_one_node (char **buffer_ptr, int *buffer_size,
 /* part_is_visible - should user be able to see this partition */
 extern bool part_is_visible(struct part_record *part_ptr, uid_t uid);
 
+/*
+ * part_visibility_restricted - are any partitions hidden from some users
+ *	(Hidden flag or AllowGroups), making partition filtering user dependent
+ * NOTE: READ lock_slurmctld partition before entry
+ */
+extern bool part_visibility_restricted(void);
+
 /* part_fini - free all memory associated with partition records */
 extern void part_fini (void);
 
@@ -2086,6 +2095,12 @@ extern void queue_job_scheduler(void);
  */
 extern void rehash_jobs(void);
 
+/* Pack job hash table statistics into buffer for sdiag */
+extern void pack_job_hash_stats(Buf buffer);
+
+/* Clear job hash table lookup statistics */
+extern void reset_job_hash_stats(void);
+
 /*
  * Rebuild a job step's core_bitmap_job after a job has just changed size
  * job_ptr IN - job that was just re-sized
@@ -39,6 +39,7 @@
 #include <stdio.h>
 
 #include "src/slurmctld/agent.h"
+#include "src/slurmctld/locks.h"
 #include "src/slurmctld/slurmctld.h"
 #include "src/common/list.h"
 #include "src/common/pack.h"
@@ -54,6 +55,8 @@ extern void pack_all_stat(int resp, char **buffer_ptr, int *buffer_size,
 	Buf buffer;
 	int parts_packed;
 	int agent_queue_size;
+	slurm_cred_sign_stats_t sign_stats;
+	slurmdbd_agent_stats_t dbd_stats;
 	time_t now = time(NULL);
 	uint32_t uint32_tmp;
 
@@ -120,6 +123,28 @@ extern void pack_all_stat(int resp, char **buffer_ptr, int *buffer_size,
 			pack32(slurmctld_diag_stats.bf_active, buffer);
 			pack32(slurmctld_diag_stats.backfilled_pack_jobs,
 			       buffer);
+
+			pack_job_hash_stats(buffer);
+			pack_lock_stats(buffer);
+
+			slurm_cred_get_sign_stats(slurmctld_config.cred_ctx,
+						  &sign_stats);
+			pack64(sign_stats.sign_cnt, buffer);
+			pack64(sign_stats.batch_cnt, buffer);
+			pack64(sign_stats.fail_cnt, buffer);
+			pack64(sign_stats.sign_time, buffer);
+			pack64(sign_stats.sign_max, buffer);
+			pack32(sign_list_size(), buffer);
+
+			slurmdbd_agent_get_stats(&dbd_stats);
+			pack32(dbd_stats.queue_max, buffer);
+			pack64(dbd_stats.sent_cnt, buffer);
+			pack64(dbd_stats.batch_cnt, buffer);
+			pack64(dbd_stats.coalesced_cnt, buffer);
+			pack64(dbd_stats.latency_time, buffer);
+			pack64(dbd_stats.latency_max, buffer);
+			pack32_array(dbd_stats.latency_hist,
+				     DBD_AGENT_HIST_CNT, buffer);
 		}
 	} else if (protocol_version >= SLURM_17_11_PROTOCOL_VERSION) {
 		parts_packed = resp;
@@ -276,5 +301,10 @@ extern void reset_stats(int level)
 	slurmctld_diag_stats.bf_last_depth_try = 0;
 	slurmctld_diag_stats.bf_active = 0;
 
+	reset_job_hash_stats();
+	reset_lock_stats();
+	slurm_cred_reset_sign_stats(slurmctld_config.cred_ctx);
+	slurmdbd_agent_reset_stats();
+
 	last_proc_req_start = time(NULL);
 }
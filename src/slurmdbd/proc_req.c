@@ -62,10 +62,34 @@
 #include "src/slurmdbd/slurmdbd.h"
 #include "src/slurmctld/slurmctld.h"
 
+/* A message of a DBD_SEND_MULT_MSG */
+typedef struct {
+	persist_msg_t msg;
+	bool unpacked;		/* msg must be freed */
+	int rc;
+	Buf ret_buf;
+} mult_msg_t;
+
+/* Job messages of a DBD_SEND_MULT_MSG processed by one thread in order */
+typedef struct {
+	slurmdbd_conn_t conn;	/* with the database connection of the lane */
+	mult_msg_t **msgs;
+	int msg_cnt;
+	uint32_t uid;
+} job_lane_t;
+
+/* Long running queries being processed, see _get_query_slot() */
+static pthread_mutex_t query_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  query_cond  = PTHREAD_COND_INITIALIZER;
+static int query_cnt = 0;
+
 /* Local functions */
 static bool  _validate_slurm_user(uint32_t uid);
 static bool  _validate_super_user(uint32_t uid, slurmdbd_conn_t *slurmdbd_conn);
 static bool  _validate_operator(uint32_t uid, slurmdbd_conn_t *slurmdbd_conn);
+static bool  _get_query_slot(void);
+static bool  _is_long_query(uint16_t msg_type);
+static void  _put_query_slot(void);
 static int   _unpack_persist_init(slurmdbd_conn_t *slurmdbd_conn,
 				  persist_msg_t *msg, Buf *out_buffer,
 				  uint32_t *uid);
@@ -264,8 +288,14 @@ proc_req(void *conn, persist_msg_t *msg,
 	int rc = SLURM_SUCCESS;
 	char *comment = NULL;
 	int i, rpc_type_index = -1, rpc_user_index = -1;
+	bool query_slot = false;
 
 	DEF_TIMERS;
+
+	/* Messages from a slurmctld never wait behind user queries */
+	if (!slurmdbd_conn->conn->rem_port && _is_long_query(msg->msg_type))
+		query_slot = _get_query_slot();
+
 	START_TIMER;
 
 	switch (msg->msg_type) {
@@ -556,6 +586,9 @@ proc_req(void *conn, persist_msg_t *msg,
 		break;
 	}
 
+	if (query_slot)
+		_put_query_slot();
+
 	if (rc == ESLURM_ACCESS_DENIED)
 		error("CONN:%u Security violation, %s",
 		      slurmdbd_conn->conn->fd,
@@ -654,6 +687,53 @@ static bool _validate_operator(uint32_t uid, slurmdbd_conn_t *dbd_conn)
 	return false;
 }
 
+/* Queries which may scan many job or usage records */
+static bool _is_long_query(uint16_t msg_type)
+{
+	switch (msg_type) {
+	case DBD_GET_ASSOC_USAGE:
+	case DBD_GET_CLUSTER_USAGE:
+	case DBD_GET_EVENTS:
+	case DBD_GET_JOBS_COND:
+	case DBD_GET_TXN:
+	case DBD_GET_WCKEY_USAGE:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/*
+ * Wait until fewer than MaxQueryThreads long running queries are being
+ * processed, so they can not keep the database from storing the records
+ * sent by the slurmctlds.
+ * RET true if a slot was taken, release it with _put_query_slot()
+ */
+static bool _get_query_slot(void)
+{
+	if (!slurmdbd_conf->max_query_threads)
+		return false;
+
+	slurm_mutex_lock(&query_mutex);
+	while (query_cnt >= slurmdbd_conf->max_query_threads) {
+		debug2("%s: waiting for one of %u running queries", __func__,
+		       query_cnt);
+		slurm_cond_wait(&query_cond, &query_mutex);
+	}
+	query_cnt++;
+	slurm_mutex_unlock(&query_mutex);
+
+	return true;
+}
+
+static void _put_query_slot(void)
+{
+	slurm_mutex_lock(&query_mutex);
+	query_cnt--;
+	slurm_cond_signal(&query_cond);
+	slurm_mutex_unlock(&query_mutex);
+}
+
 static void _add_registered_cluster(slurmdbd_conn_t *db_conn)
 {
 	ListIterator itr;
@@ -3339,6 +3419,204 @@ static int   _send_mult_job_start(slurmdbd_conn_t *slurmdbd_conn,
 	return SLURM_SUCCESS;
 }
 
+/*
+ * Get the ID of the job a job or step message is about
+ * RET false if the message is about something else
+ */
+static bool _job_msg_id(persist_msg_t *msg, uint32_t *job_id)
+{
+	switch (msg->msg_type) {
+	case DBD_JOB_COMPLETE:
+		*job_id = ((dbd_job_comp_msg_t *) msg->data)->job_id;
+		break;
+	case DBD_JOB_START:
+		*job_id = ((dbd_job_start_msg_t *) msg->data)->job_id;
+		break;
+	case DBD_JOB_SUSPEND:
+		*job_id = ((dbd_job_suspend_msg_t *) msg->data)->job_id;
+		break;
+	case DBD_STEP_COMPLETE:
+		*job_id = ((dbd_step_comp_msg_t *) msg->data)->job_id;
+		break;
+	case DBD_STEP_START:
+		*job_id = ((dbd_step_start_msg_t *) msg->data)->job_id;
+		break;
+	default:
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Open the database connections of the job lanes other than the first one,
+ * which uses the connection of the slurmctld itself.
+ */
+static int _get_job_lane_conns(slurmdbd_conn_t *slurmdbd_conn)
+{
+	int i, conn_cnt = slurmdbd_conf->job_ingest_threads - 1;
+
+	if (slurmdbd_conn->job_lane_cnt >= conn_cnt)
+		return SLURM_SUCCESS;
+
+	xrealloc(slurmdbd_conn->job_lane_db_conn, sizeof(void *) * conn_cnt);
+	for (i = slurmdbd_conn->job_lane_cnt; i < conn_cnt; i++) {
+		errno = 0;
+		slurmdbd_conn->job_lane_db_conn[i] =
+			acct_storage_g_get_connection(
+				false, slurmdbd_conn->conn->fd, true,
+				slurmdbd_conn->conn->cluster_name);
+		if (errno) {
+			error("CONN:%u unable to open database connection for job message thread: %m",
+			      slurmdbd_conn->conn->fd);
+			acct_storage_g_close_connection(
+				&slurmdbd_conn->job_lane_db_conn[i]);
+			return SLURM_ERROR;
+		}
+		slurmdbd_conn->job_lane_cnt++;
+	}
+
+	return SLURM_SUCCESS;
+}
+
+/* Process the messages of a job lane in order, stop at the first failure */
+static void *_job_lane(void *arg)
+{
+	job_lane_t *lane = arg;
+	mult_msg_t *mult_msg;
+	int i;
+
+	for (i = 0; i < lane->msg_cnt; i++) {
+		mult_msg = lane->msgs[i];
+		mult_msg->rc = proc_req(&lane->conn, &mult_msg->msg,
+					&mult_msg->ret_buf, &lane->uid);
+		/*
+		 * Lanes may deadlock each other in the database. Keep their
+		 * transactions short so a rollback loses no other message.
+		 */
+		if (slurmdbd_conf->commit_delay)
+			acct_storage_g_commit(lane->conn.db_conn, 1);
+		if (mult_msg->rc != SLURM_SUCCESS)
+			break;
+	}
+
+	return NULL;
+}
+
+/*
+ * Process the messages of a DBD_SEND_MULT_MSG, spreading runs of job and step
+ * messages over JobIngestThreads threads by job ID. Messages of one job stay
+ * in order, any other message is processed alone once all before it are done.
+ * The replies up to the first failure are added to ret_list, the slurmctld
+ * sends the rest again.
+ */
+static void _proc_mult_msg_parallel(slurmdbd_conn_t *slurmdbd_conn,
+				    List req_list, List ret_list, uint32_t uid)
+{
+	/* JobIngestThreads may have changed since the connections were opened */
+	int lane_cnt = MAX(1, MIN(slurmdbd_conf->job_ingest_threads,
+				  slurmdbd_conn->job_lane_cnt + 1));
+	int msg_cnt = list_count(req_list);
+	mult_msg_t *mult_msgs = xmalloc(sizeof(mult_msg_t) * msg_cnt);
+	job_lane_t *lanes = xmalloc(sizeof(job_lane_t) * lane_cnt);
+	pthread_t *tids = xmalloc(sizeof(pthread_t) * lane_cnt);
+	ListIterator itr;
+	Buf req_buf;
+	uint32_t job_id;
+	int i = 0, j, k;
+
+	/* Unpack everything first, up to the first message that fails */
+	itr = list_iterator_create(req_list);
+	while ((req_buf = list_next(itr))) {
+		mult_msg_t *mult_msg = &mult_msgs[i++];
+
+		mult_msg->rc = slurm_persist_conn_process_msg(
+			slurmdbd_conn->conn, &mult_msg->msg,
+			get_buf_data(req_buf), size_buf(req_buf),
+			&mult_msg->ret_buf, 0);
+		if (mult_msg->rc != SLURM_SUCCESS)
+			break;
+		mult_msg->unpacked = true;
+		/* Not processed yet */
+		mult_msg->rc = SLURM_ERROR;
+	}
+	list_iterator_destroy(itr);
+	msg_cnt = i;
+
+	for (k = 0; k < lane_cnt; k++) {
+		lanes[k].conn = *slurmdbd_conn;
+		if (k)
+			lanes[k].conn.db_conn =
+				slurmdbd_conn->job_lane_db_conn[k - 1];
+		lanes[k].msgs = xmalloc(sizeof(mult_msg_t *) * msg_cnt);
+		lanes[k].uid = uid;
+	}
+
+	i = 0;
+	while ((i < msg_cnt) && mult_msgs[i].unpacked) {
+		if (!_job_msg_id(&mult_msgs[i].msg, &job_id)) {
+			mult_msgs[i].rc = proc_req(slurmdbd_conn,
+						   &mult_msgs[i].msg,
+						   &mult_msgs[i].ret_buf, &uid);
+			if (mult_msgs[i].rc != SLURM_SUCCESS)
+				break;
+			i++;
+			continue;
+		}
+
+		/* Let the lanes see everything done before them */
+		if (slurmdbd_conf->commit_delay)
+			acct_storage_g_commit(slurmdbd_conn->db_conn, 1);
+
+		for (k = 0; k < lane_cnt; k++)
+			lanes[k].msg_cnt = 0;
+		for (j = i; (j < msg_cnt) && mult_msgs[j].unpacked &&
+			     _job_msg_id(&mult_msgs[j].msg, &job_id); j++) {
+			job_lane_t *lane = &lanes[job_id % lane_cnt];
+			lane->msgs[lane->msg_cnt++] = &mult_msgs[j];
+		}
+
+		for (k = 1; k < lane_cnt; k++) {
+			if (lanes[k].msg_cnt)
+				slurm_thread_create(&tids[k], _job_lane,
+						    &lanes[k]);
+		}
+		_job_lane(&lanes[0]);
+		for (k = 1; k < lane_cnt; k++) {
+			if (lanes[k].msg_cnt)
+				pthread_join(tids[k], NULL);
+		}
+
+		for ( ; i < j; i++) {
+			if (mult_msgs[i].rc != SLURM_SUCCESS)
+				break;
+		}
+		if (i < j)
+			break;
+	}
+
+	for (i = 0; i < msg_cnt; i++) {
+		if (mult_msgs[i].ret_buf) {
+			list_append(ret_list, mult_msgs[i].ret_buf);
+			mult_msgs[i].ret_buf = NULL;
+		}
+		if (mult_msgs[i].rc != SLURM_SUCCESS)
+			break;
+	}
+
+	for (i = 0; i < msg_cnt; i++) {
+		if (mult_msgs[i].unpacked)
+			slurmdbd_free_msg((slurmdbd_msg_t *) &mult_msgs[i].msg);
+		if (mult_msgs[i].ret_buf)
+			free_buf(mult_msgs[i].ret_buf);
+	}
+	for (k = 0; k < lane_cnt; k++)
+		xfree(lanes[k].msgs);
+	xfree(lanes);
+	xfree(mult_msgs);
+	xfree(tids);
+}
+
 static int   _send_mult_msg(slurmdbd_conn_t *slurmdbd_conn,
 			    persist_msg_t *msg, Buf *out_buffer,
 			    uint32_t *uid)
@@ -3363,6 +3641,15 @@ static int   _send_mult_msg(slurmdbd_conn_t *slurmdbd_conn,
 
 	list_msg.my_list = list_create(slurmdbd_free_buffer);
 	/* START_TIMER; */
+	if ((slurmdbd_conf->job_ingest_threads > 1) &&
+	    slurmdbd_conn->conn->rem_port &&
+	    (list_count(get_msg->my_list) > 1) &&
+	    (_get_job_lane_conns(slurmdbd_conn) == SLURM_SUCCESS)) {
+		_proc_mult_msg_parallel(slurmdbd_conn, get_msg->my_list,
+					list_msg.my_list, *uid);
+		goto end_it;
+	}
+
 	itr = list_iterator_create(get_msg->my_list);
 	while ((req_buf = list_next(itr))) {
 		persist_msg_t sub_msg;
@@ -3385,6 +3672,8 @@ static int   _send_mult_msg(slurmdbd_conn_t *slurmdbd_conn,
 			break;
 	}
 	list_iterator_destroy(itr);
+
+end_it:
 	/* END_TIMER; */
 	/* info("%d multi took %s", list_count(get_msg->my_list), TIME_STR); */
 
@@ -46,6 +46,9 @@
 typedef struct {
 	slurm_persist_conn_t *conn;
 	void *db_conn; /* database connection */
+	void **job_lane_db_conn; /* database connections of the job lanes
+				  * other than the first, see JobIngestThreads */
+	int job_lane_cnt;
 	char *tres_str;
 } slurmdbd_conn_t;
 
@@ -98,8 +98,10 @@ static void _clear_slurmdbd_conf(void)
 		slurmdbd_conf->debug_flags = 0;
 		slurmdbd_conf->debug_level = LOG_LEVEL_QUIET;
 		xfree(slurmdbd_conf->default_qos);
+		slurmdbd_conf->job_ingest_threads = 0;
 		xfree(slurmdbd_conf->log_file);
 		slurmdbd_conf->syslog_debug = LOG_LEVEL_QUIET;
+		slurmdbd_conf->max_query_threads = 0;
 		xfree(slurmdbd_conf->pid_file);
 		xfree(slurmdbd_conf->plugindir);
 		slurmdbd_conf->private_data = 0;
@@ -153,9 +155,11 @@ extern int read_slurmdbd_conf(void)
 		{"DebugLevel", S_P_STRING},
 		{"DebugLevelSyslog", S_P_STRING},
 		{"DefaultQOS", S_P_STRING},
+		{"JobIngestThreads", S_P_UINT16},
 		{"JobPurge", S_P_UINT32},
 		{"LogFile", S_P_STRING},
 		{"LogTimeFormat", S_P_STRING},
+		{"MaxQueryThreads", S_P_UINT16},
 		{"MaxQueryTimeRange", S_P_STRING},
 		{"MessageTimeout", S_P_UINT16},
 		{"PidFile", S_P_STRING},
@@ -295,6 +299,11 @@ extern int read_slurmdbd_conf(void)
 		} else
 			slurmdbd_conf->log_fmt = LOG_FMT_ISO8601_MS;
 
+		s_p_get_uint16(&slurmdbd_conf->job_ingest_threads,
+			       "JobIngestThreads", tbl);
+		s_p_get_uint16(&slurmdbd_conf->max_query_threads,
+			       "MaxQueryThreads", tbl);
+
 		if (s_p_get_string(&temp_str, "MaxQueryTimeRange", tbl)) {
 			slurmdbd_conf->max_time_range = time_str2mins(temp_str);
 			xfree(temp_str);
@@ -641,8 +650,10 @@ extern void log_config(void)
 	debug2("DebugLevel        = %u", slurmdbd_conf->debug_level);
 	debug2("DebugLevelSyslog  = %u", slurmdbd_conf->syslog_debug);
 	debug2("DefaultQOS        = %s", slurmdbd_conf->default_qos);
+	debug2("JobIngestThreads  = %u", slurmdbd_conf->job_ingest_threads);
 
 	debug2("LogFile           = %s", slurmdbd_conf->log_file);
+	debug2("MaxQueryThreads   = %u", slurmdbd_conf->max_query_threads);
 	debug2("MessageTimeout    = %u", slurmdbd_conf->msg_timeout);
 	debug2("PidFile           = %s", slurmdbd_conf->pid_file);
 	debug2("PluginDir         = %s", slurmdbd_conf->plugindir);
@@ -845,11 +856,23 @@ extern List dump_config(void)
 	key_pair->value = xstrdup(slurmdbd_conf->default_qos);
 	list_append(my_list, key_pair);
 
+	key_pair = xmalloc(sizeof(config_key_pair_t));
+	key_pair->name = xstrdup("JobIngestThreads");
+	key_pair->value = xstrdup_printf("%u",
+					 slurmdbd_conf->job_ingest_threads);
+	list_append(my_list, key_pair);
+
 	key_pair = xmalloc(sizeof(config_key_pair_t));
 	key_pair->name = xstrdup("LogFile");
 	key_pair->value = xstrdup(slurmdbd_conf->log_file);
 	list_append(my_list, key_pair);
 
+	key_pair = xmalloc(sizeof(config_key_pair_t));
+	key_pair->name = xstrdup("MaxQueryThreads");
+	key_pair->value = xstrdup_printf("%u",
+					 slurmdbd_conf->max_query_threads);
+	list_append(my_list, key_pair);
+
 	key_pair = xmalloc(sizeof(config_key_pair_t));
 	key_pair->name = xstrdup("MessageTimeout");
 	key_pair->value = xstrdup_printf("%u secs", slurmdbd_conf->msg_timeout);
@@ -72,9 +72,13 @@ typedef struct slurm_dbd_conf {
 	uint16_t	debug_level;	/* Debug level, default=3	*/
 	char *	 	default_qos;	/* default qos setting when
 					 * adding clusters              */
+	uint16_t	job_ingest_threads; /* threads to process the job
+					 * records of one slurmctld	*/
 	char *		log_file;	/* Log file			*/
 	uint16_t	syslog_debug;	/* output to both logfile and syslog*/
 	uint16_t        log_fmt;        /* Log file timestamt format    */
+	uint16_t	max_query_threads; /* max long running queries
+					 * processed at once, 0 no limit */
 	uint32_t	max_time_range;	/* max time range for user queries */
 	uint16_t        msg_timeout;    /* message timeout		*/
 	char *		pid_file;	/* where to store current PID	*/
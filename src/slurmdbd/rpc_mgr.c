@@ -144,6 +144,7 @@ extern void rpc_mgr_wake(void)
 static void _connection_fini_callback(void *arg)
 {
 	slurmdbd_conn_t *conn = (slurmdbd_conn_t *) arg;
+	int i;
 
 	if (conn->conn->rem_port) {
 		if (!shutdown_time) {
@@ -178,6 +179,9 @@ static void _connection_fini_callback(void *arg)
 	}
 
 	acct_storage_g_close_connection(&conn->db_conn);
+	for (i = 0; i < conn->job_lane_cnt; i++)
+		acct_storage_g_close_connection(&conn->job_lane_db_conn[i]);
+	xfree(conn->job_lane_db_conn);
 	/* handled directly in the internal persist_conn code */
 	//slurm_persist_conn_members_destroy(&conn->conn);
 	xfree(conn->tres_str);
@@ -0,0 +1,138 @@
+/* Stress test and benchmark of src/common/list.c from many threads
+ *
+ * Usage: list-test [threads] [iterations]
+ */
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include <src/common/list.h>
+
+#include <testsuite/dejagnu.h>
+
+#define TEST(_tst, _msg) do {		\
+	if (! (_tst))			\
+		fail( _msg );		\
+	else				\
+		pass( _msg );		\
+} while (0)
+
+#define ITEMS_PER_LIST 64
+
+static int iterations = 2000;
+static List shared_list = NULL;
+
+typedef struct {
+	long id;
+	int errors;
+	uint64_t ops;
+} worker_arg_t;
+
+static uint64_t _usec(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return ((uint64_t) tv.tv_sec * 1000000) + tv.tv_usec;
+}
+
+/* Build, walk and empty private lists, and pass items through a shared one */
+static void *_worker(void *arg)
+{
+	worker_arg_t *worker = arg;
+	ListIterator iter;
+	List list;
+	long i, j, sum, *item;
+
+	for (i = 0; i < iterations; i++) {
+		list = list_create(NULL);
+		for (j = 0; j < ITEMS_PER_LIST; j++)
+			list_append(list, (void *) (j + 1));
+		worker->ops += ITEMS_PER_LIST;
+
+		sum = 0;
+		iter = list_iterator_create(list);
+		while ((item = list_next(iter)))
+			sum += (long) item;
+		list_iterator_destroy(iter);
+		if (sum != (ITEMS_PER_LIST * (ITEMS_PER_LIST + 1) / 2))
+			worker->errors++;
+		worker->ops += ITEMS_PER_LIST;
+
+		for (j = 0; j < ITEMS_PER_LIST / 2; j++) {
+			if (!list_pop(list))
+				worker->errors++;
+		}
+		worker->ops += ITEMS_PER_LIST / 2;
+		list_destroy(list);
+
+		list_enqueue(shared_list, (void *) (worker->id + 1));
+		if (!list_dequeue(shared_list))
+			worker->errors++;
+		worker->ops += 2;
+	}
+
+	return NULL;
+}
+
+static int _run(int thread_cnt, char *name)
+{
+	pthread_t *threads = calloc(thread_cnt, sizeof(pthread_t));
+	worker_arg_t *workers = calloc(thread_cnt, sizeof(worker_arg_t));
+	uint64_t start, usec, ops = 0;
+	int i, errors = 0;
+
+	start = _usec();
+	for (i = 0; i < thread_cnt; i++) {
+		workers[i].id = i;
+		pthread_create(&threads[i], NULL, _worker, &workers[i]);
+	}
+	for (i = 0; i < thread_cnt; i++) {
+		pthread_join(threads[i], NULL);
+		errors += workers[i].errors;
+		ops += workers[i].ops;
+	}
+	usec = _usec() - start;
+
+	note("%s: %d threads, %"PRIu64" list operations in %"PRIu64
+	     " usec (%.1f per usec)", name, thread_cnt, ops, usec,
+	     usec ? ((double) ops / usec) : 0.0);
+
+	free(threads);
+	free(workers);
+	return errors;
+}
+
+int main(int argc, char *argv[])
+{
+	int thread_cnt = 16, i;
+
+	if (argc > 1)
+		thread_cnt = atoi(argv[1]);
+	if (argc > 2)
+		iterations = atoi(argv[2]);
+	if ((thread_cnt < 1) || (iterations < 1)) {
+		fprintf(stderr, "Usage: %s [threads] [iterations]\n", argv[0]);
+		return 1;
+	}
+
+	shared_list = list_create(NULL);
+
+	TEST(_run(1, "single thread") == 0, "list operations in one thread");
+	TEST(_run(thread_cnt, "concurrent") == 0,
+	     "list operations in concurrent threads");
+
+	/* Each run starts new threads, the old ones returned their caches */
+	for (i = 0; i < 4; i++) {
+		TEST(_run(thread_cnt, "new threads") == 0,
+		     "list operations in replacement threads");
+	}
+	TEST(list_count(shared_list) == 0, "shared list empty");
+
+	list_destroy(shared_list);
+
+	totals();
+	return failed;
+}
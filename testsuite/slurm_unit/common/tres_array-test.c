@@ -0,0 +1,170 @@
+/* Test and benchmark of src/common/tres_array.h
+ *
+ * Usage: tres_array-test [iterations]
+ */
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <slurm/slurm.h>
+#include <src/common/tres_array.h>
+
+#include <testsuite/dejagnu.h>
+
+#define TEST(_tst, _msg) do {		\
+	if (! (_tst))			\
+		fail( _msg );		\
+	else				\
+		pass( _msg );		\
+} while (0)
+
+#define MAX_TRES 64
+
+static int iterations = 1000000;
+
+static uint64_t _usec(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return ((uint64_t) tv.tv_sec * 1000000) + tv.tv_usec;
+}
+
+/* The per element loops the kernels replace, kept for comparison */
+static void _naive_add(uint64_t *dst, uint64_t *src, int cnt)
+{
+	int i;
+
+	for (i = 0; i < cnt; i++)
+		dst[i] += src[i];
+}
+
+static void _naive_sub(uint64_t *dst, uint64_t *src, int cnt)
+{
+	int i;
+
+	for (i = 0; i < cnt; i++) {
+		if (src[i] > dst[i])
+			dst[i] = 0;
+		else
+			dst[i] -= src[i];
+	}
+}
+
+static int _naive_exceeds(uint64_t *val, uint64_t *add, uint64_t *limit,
+			  int cnt)
+{
+	int i;
+
+	for (i = 0; i < cnt; i++) {
+		if (limit[i] == INFINITE64)
+			continue;
+		if (val[i] + add[i] > limit[i])
+			return i;
+	}
+	return -1;
+}
+
+static void _test_results(void)
+{
+	uint64_t dst[MAX_TRES], src[MAX_TRES], limit[MAX_TRES];
+	int i;
+
+	for (i = 0; i < MAX_TRES; i++) {
+		dst[i] = i * 10;
+		src[i] = i;
+	}
+	tres_array_add(dst, src, MAX_TRES);
+	TEST((dst[0] == 0) && (dst[5] == 55) && (dst[63] == 693),
+	     "tres_array_add");
+
+	memset(dst, 0, sizeof(dst));
+	tres_array_add_scaled(dst, src, 60, MAX_TRES);
+	TEST((dst[1] == 60) && (dst[63] == 3780), "tres_array_add_scaled");
+
+	for (i = 0; i < MAX_TRES; i++)
+		dst[i] = 5;
+	TEST(!tres_array_sub(dst, src, 6), "tres_array_sub no underflow");
+	TEST((dst[0] == 5) && (dst[5] == 0), "tres_array_sub result");
+	for (i = 0; i < MAX_TRES; i++)
+		dst[i] = 5;
+	TEST(tres_array_sub(dst, src, MAX_TRES), "tres_array_sub underflow");
+	TEST((dst[4] == 1) && (dst[6] == 0) && (dst[63] == 0),
+	     "tres_array_sub saturates at zero");
+
+	for (i = 0; i < MAX_TRES; i++)
+		limit[i] = INFINITE64;
+	TEST(tres_array_first_limit(limit, MAX_TRES) == -1,
+	     "tres_array_first_limit none set");
+	TEST(tres_array_exceeds(src, src, limit, MAX_TRES) == -1,
+	     "tres_array_exceeds no limits");
+	limit[40] = 79;
+	limit[50] = 10;
+	TEST(tres_array_first_limit(limit, MAX_TRES) == 40,
+	     "tres_array_first_limit");
+	TEST(tres_array_exceeds(src, NULL, limit, MAX_TRES) == 50,
+	     "tres_array_exceeds without add");
+	TEST(tres_array_exceeds(src, src, limit, MAX_TRES) == 40,
+	     "tres_array_exceeds with add");
+	limit[40] = 80;
+	TEST(tres_array_exceeds(src, src, limit, 50) == -1,
+	     "tres_array_exceeds at limit");
+	TEST(tres_array_exceeds(src, src, limit, 0) == -1,
+	     "tres_array_exceeds empty");
+}
+
+static void _bench(int cnt)
+{
+	uint64_t dst[MAX_TRES], src[MAX_TRES], limit[MAX_TRES];
+	uint64_t start, naive_usec, usec;
+	int i, found = 0;
+
+	for (i = 0; i < cnt; i++) {
+		dst[i] = 1000000;
+		src[i] = i;
+		limit[i] = (i % 4) ? INFINITE64 : 1ULL << 40;
+	}
+
+	start = _usec();
+	for (i = 0; i < iterations; i++) {
+		_naive_add(dst, src, cnt);
+		_naive_sub(dst, src, cnt);
+		found += _naive_exceeds(dst, src, limit, cnt);
+	}
+	naive_usec = _usec() - start;
+
+	start = _usec();
+	for (i = 0; i < iterations; i++) {
+		tres_array_add(dst, src, cnt);
+		tres_array_sub(dst, src, cnt);
+		found += tres_array_exceeds(dst, src, limit, cnt);
+	}
+	usec = _usec() - start;
+
+	note("%d TRES: %d add/sub/limit checks, per element loops %"PRIu64
+	     " usec, tres_array %"PRIu64" usec", cnt, iterations, naive_usec,
+	     usec);
+	TEST((found == -2 * iterations) && (dst[cnt - 1] == 1000000),
+	     "benchmark results match");
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc > 1)
+		iterations = atoi(argv[1]);
+	if (iterations < 1) {
+		fprintf(stderr, "Usage: %s [iterations]\n", argv[0]);
+		return 1;
+	}
+
+	_test_results();
+
+	_bench(8);
+	_bench(32);
+	_bench(64);
+
+	totals();
+	return failed;
+}
@@ -0,0 +1,135 @@
+/* Test of src/common/vector.c
+ */
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <src/common/vector.h>
+
+#include <testsuite/dejagnu.h>
+
+#define TEST(_tst, _msg) do {		\
+	if (! (_tst))			\
+		fail( _msg );		\
+	else				\
+		pass( _msg );		\
+} while (0)
+
+#define ELEM_CNT 100000
+
+typedef struct {
+	uint32_t key;
+	uint32_t value;
+} elem_t;
+
+static int _cmp_key(const void *x, const void *y)
+{
+	const elem_t *e1 = x, *e2 = y;
+
+	if (e1->key < e2->key)
+		return -1;
+	if (e1->key > e2->key)
+		return 1;
+	return 0;
+}
+
+static int _is_odd(void *x, void *key)
+{
+	return (((elem_t *) x)->key & 1);
+}
+
+static int _sum(void *x, void *arg)
+{
+	*(uint64_t *) arg += ((elem_t *) x)->key;
+	return 0;
+}
+
+static int _stop_at(void *x, void *arg)
+{
+	if (((elem_t *) x)->key == *(uint32_t *) arg)
+		return -1;
+	return 0;
+}
+
+static int _set_value(void *x, void *arg)
+{
+	elem_t *elem = x;
+
+	elem->value = elem->key * 2;
+	return 0;
+}
+
+static int _clear_value(void *x, void *arg)
+{
+	((elem_t *) x)->value = 0;
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	vector_t *vec;
+	elem_t *elem;
+	uint64_t sum = 0;
+	uint32_t i, stop = 10;
+	int ordered = 1, set = 1;
+
+	vec = vector_create(sizeof(elem_t), 0);
+	TEST(vector_count(vec) == 0, "new vector empty");
+
+	/* Append in reverse order, growing from zero */
+	for (i = 0; i < ELEM_CNT; i++) {
+		elem = vector_append(vec);
+		elem->key = ELEM_CNT - 1 - i;
+	}
+	TEST(vector_count(vec) == ELEM_CNT, "vector count after append");
+	TEST(((elem_t *) vector_get(vec, 0))->key == ELEM_CNT - 1,
+	     "first element");
+
+	vector_sort(vec, _cmp_key);
+	for (i = 0; i < ELEM_CNT; i++) {
+		if (((elem_t *) vector_get(vec, i))->key != i)
+			ordered = 0;
+	}
+	TEST(ordered, "vector sorted");
+
+	TEST(vector_for_each(vec, _sum, &sum) == ELEM_CNT,
+	     "for_each visits all elements");
+	TEST(sum == ((uint64_t) ELEM_CNT * (ELEM_CNT - 1) / 2),
+	     "for_each sum");
+	TEST(vector_for_each(vec, _stop_at, &stop) == -(int) (stop + 1),
+	     "for_each stopped");
+
+	vector_for_each_parallel(vec, _set_value, NULL, 4);
+	for (i = 0; i < ELEM_CNT; i++) {
+		elem = vector_get(vec, i);
+		if (elem->value != elem->key * 2)
+			set = 0;
+	}
+	TEST(set, "for_each_parallel visits all elements");
+
+	vector_for_each_balanced(vec, _clear_value, NULL, 4);
+	for (i = 0; i < ELEM_CNT; i++) {
+		if (((elem_t *) vector_get(vec, i))->value)
+			set = 0;
+	}
+	TEST(set, "for_each_balanced visits all elements");
+
+	TEST(vector_delete_all(vec, _is_odd, NULL) == ELEM_CNT / 2,
+	     "delete_all removed count");
+	TEST(vector_count(vec) == ELEM_CNT / 2,
+	     "vector count after delete_all");
+	ordered = 1;
+	for (i = 0; i < vector_count(vec); i++) {
+		if (((elem_t *) vector_get(vec, i))->key != i * 2)
+			ordered = 0;
+	}
+	TEST(ordered, "delete_all keeps order");
+
+	elem = vector_append(vec);
+	TEST(elem->key == 0 && elem->value == 0, "appended element zeroed");
+
+	FREE_NULL_VECTOR(vec);
+	TEST(vec == NULL, "vector freed");
+
+	totals();
+	return failed;
+}